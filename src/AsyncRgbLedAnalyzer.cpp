@@ -4,8 +4,301 @@
 
 #include <AnalyzerChannelData.h>
 
-#include <iostream>
-#include <algorithm> // for std::max/max()
+#include <algorithm> // for std::max/max(), std::stable_sort
+#include <string>
+
+namespace
+{
+    // in live mode, the longest a decoded pixel waits before it is shown
+    const std::chrono::milliseconds LIVE_COMMIT_INTERVAL( 50 );
+
+    // the span of capture each "ber" record covers
+    const double BIT_ERROR_INTERVAL_SEC = 1.0;
+
+    // LEDs listed in the summary's ber_worst_leds
+    const U32 BIT_ERROR_WORST_LED_COUNT = 5;
+
+    // transitions from the start of the capture that key a results sidecar
+    const U64 SIDECAR_KEY_TRANSITIONS = 65536;
+
+    /// the channel hash of a sidecar key from the start of a trace, the same
+    /// as AnalyzerChannelEdgeSource::HashAhead gives
+    U64 HashTraceStart( const PulseTrace& trace, U64 transitionCount )
+    {
+        PulseTraceEdgeSource source;
+        source.Open( trace );
+
+        Fnv1aHash transitions;
+        transitions.Add( U64( trace.InitialState() ) );
+        transitions.Add( trace.BeginSample() );
+
+        for( U64 i = 0; i < transitionCount; ++i )
+        {
+            source.AdvanceToNextEdge();
+            transitions.Add( source.GetSampleNumber() );
+        }
+
+        return transitions.Value();
+    }
+}
+
+void AnalyzerChannelEdgeSource::SetChannelData( AnalyzerChannelData* channelData, PulseTrace* trace, double sampleRateHz )
+{
+    mChannelData = channelData;
+    mTrace = trace;
+    mIsReplaying = false;
+
+    if( !mTrace )
+    {
+        return;
+    }
+
+    if( !mTrace->IsEmpty() && ( mTrace->BeginSample() == mChannelData->GetSampleNumber() ) &&
+        ( mTrace->InitialState() == mChannelData->GetBitState() ) && ( mTrace->SampleRateHz() == sampleRateHz ) )
+    {
+        mReplay.Open( *mTrace );
+        mReplayEndSample = mTrace->EndSample();
+        mNextBoundary = 0;
+        mIsReplaying = true;
+        return;
+    }
+
+    mTrace->Start( mChannelData->GetBitState(), mChannelData->GetSampleNumber(), sampleRateHz );
+}
+
+U64 AnalyzerChannelEdgeSource::GetSampleNumber()
+{
+    return mIsReplaying ? mReplay.GetSampleNumber() : mChannelData->GetSampleNumber();
+}
+
+BitState AnalyzerChannelEdgeSource::GetBitState()
+{
+    return mIsReplaying ? mReplay.GetBitState() : mChannelData->GetBitState();
+}
+
+void AnalyzerChannelEdgeSource::Advance( U32 numSamples )
+{
+    AdvanceToAbsPosition( GetSampleNumber() + numSamples );
+}
+
+void AnalyzerChannelEdgeSource::AdvanceToAbsPosition( U64 sampleNumber )
+{
+    if( mIsReplaying )
+    {
+        if( sampleNumber <= mReplayEndSample )
+        {
+            mReplay.AdvanceToAbsPosition( sampleNumber );
+            CheckReplay();
+            return;
+        }
+
+        mReplay.AdvanceToAbsPosition( mReplayEndSample );
+        StopReplay();
+    }
+
+    AdvanceChannel( sampleNumber );
+}
+
+void AnalyzerChannelEdgeSource::AdvanceToNextEdge()
+{
+    if( mIsReplaying )
+    {
+        if( mReplay.HasNextTransition() )
+        {
+            mReplay.AdvanceToNextEdge();
+            CheckReplay();
+            return;
+        }
+
+        StopReplay();
+    }
+
+    mChannelData->AdvanceToNextEdge();
+
+    if( mTrace )
+    {
+        mTrace->AddTransition( mChannelData->GetSampleNumber() );
+    }
+}
+
+U64 AnalyzerChannelEdgeSource::GetSampleOfNextEdge()
+{
+    if( mIsReplaying )
+    {
+        if( mReplay.HasNextTransition() )
+        {
+            return mReplay.GetSampleOfNextEdge();
+        }
+
+        StopReplay();
+    }
+
+    return mChannelData->GetSampleOfNextEdge();
+}
+
+bool AnalyzerChannelEdgeSource::WouldAdvancingCauseTransition( U32 numSamples )
+{
+    if( mIsReplaying )
+    {
+        if( mReplay.WouldAdvancingCauseTransition( numSamples ) )
+        {
+            return true;
+        }
+
+        const U64 target = mReplay.GetSampleNumber() + numSamples;
+
+        if( target <= mReplayEndSample )
+        {
+            return false;
+        }
+
+        if( mChannelData->GetSampleNumber() > mReplay.GetSampleNumber() )
+        {
+            // after HashAhead, the channel data waits at the end of the trace
+            return mChannelData->WouldAdvancingToAbsPositionCauseTransition( target );
+        }
+
+        StopReplay();
+    }
+
+    return mChannelData->WouldAdvancingCauseTransition( numSamples );
+}
+
+bool AnalyzerChannelEdgeSource::IsAtCaptureHead()
+{
+    // the channel data lags behind while replaying
+    return !mIsReplaying && !mChannelData->DoMoreTransitionsExistInCurrentData();
+}
+
+bool AnalyzerChannelEdgeSource::DoMoreTransitionsExistInCurrentData()
+{
+    if( mIsReplaying && mReplay.HasNextTransition() )
+    {
+        return true;
+    }
+
+    return mChannelData->DoMoreTransitionsExistInCurrentData();
+}
+
+bool AnalyzerChannelEdgeSource::HashAhead( U64 maxTransitions, U64& hash, U64& transitionCount )
+{
+    if( !mTrace || ( mTrace->BeginSample() != GetSampleNumber() ) )
+    {
+        return false;
+    }
+
+    Fnv1aHash transitions;
+    transitions.Add( U64( GetBitState() ) );
+    transitions.Add( GetSampleNumber() );
+
+    for( transitionCount = 0; ( transitionCount < maxTransitions ) && DoMoreTransitionsExistInCurrentData(); ++transitionCount )
+    {
+        AdvanceToNextEdge();
+        transitions.Add( GetSampleNumber() );
+    }
+
+    hash = transitions.Value();
+
+    // the trace may have been dropped on the way, or filled up
+    if( !mTrace || ( !mIsReplaying && mTrace->IsFull() ) )
+    {
+        return false;
+    }
+
+    if( !mIsReplaying )
+    {
+        // every boundary so far was recorded from the channel data
+        mNextBoundary = mTrace->ResetBoundaries().size();
+    }
+
+    mReplay.Open( *mTrace );
+    mReplayEndSample = mTrace->EndSample();
+    mIsReplaying = true;
+    return true;
+}
+
+void AnalyzerChannelEdgeSource::SkipTo( U64 sampleNumber )
+{
+    if( mIsReplaying && ( sampleNumber <= mReplayEndSample ) )
+    {
+        mReplay.AdvanceToAbsPosition( sampleNumber );
+        CheckReplay();
+        return;
+    }
+
+    // the trace stays valid up to its end for the next run
+    mIsReplaying = false;
+    mTrace = nullptr;
+    mChannelData->AdvanceToAbsPosition( sampleNumber );
+}
+
+void AnalyzerChannelEdgeSource::AdvanceChannel( U64 sampleNumber )
+{
+    // note every edge on the way, so the trace stays complete
+    while( mTrace && ( mChannelData->GetSampleNumber() < sampleNumber ) &&
+           mChannelData->WouldAdvancingToAbsPositionCauseTransition( sampleNumber ) )
+    {
+        mChannelData->AdvanceToNextEdge();
+        mTrace->AddTransition( mChannelData->GetSampleNumber() );
+    }
+
+    mChannelData->AdvanceToAbsPosition( sampleNumber );
+
+    if( mTrace )
+    {
+        mTrace->Extend( mChannelData->GetSampleNumber() );
+    }
+}
+
+void AnalyzerChannelEdgeSource::CheckReplay()
+{
+    // the trace may be of an earlier capture on the same channel. At each
+    // reset boundary the replay passes, the channel data jumps to it and must
+    // show the same rising edge and first pulse; otherwise the trace is
+    // dropped and decoding carries on from the channel data.
+    const std::vector<ResetBoundary>& boundaries = mTrace->ResetBoundaries();
+
+    while( ( mNextBoundary < boundaries.size() ) && ( boundaries[ mNextBoundary ].mSample <= mReplay.GetSampleNumber() ) )
+    {
+        const ResetBoundary& boundary = boundaries[ mNextBoundary++ ];
+        mChannelData->AdvanceToAbsPosition( boundary.mSample );
+
+        bool isMatch = ( mChannelData->GetBitState() == BIT_HIGH );
+
+        if( isMatch && ( boundary.mTransition + 1 < mTrace->TransitionCount() ) )
+        {
+            U64 byteOffset = boundary.mByteOffset;
+            isMatch = ( mChannelData->GetSampleOfNextEdge() == boundary.mSample + mTrace->ReadDelta( byteOffset ) );
+        }
+
+        if( !isMatch )
+        {
+            DropTrace();
+            return;
+        }
+    }
+}
+
+void AnalyzerChannelEdgeSource::StopReplay()
+{
+    // carry on recording from the end of the trace
+    mChannelData->AdvanceToAbsPosition( mReplay.GetSampleNumber() );
+    mIsReplaying = false;
+
+    if( mChannelData->GetBitState() != mReplay.GetBitState() )
+    {
+        mTrace->Clear();
+        mTrace = nullptr;
+    }
+}
+
+void AnalyzerChannelEdgeSource::DropTrace()
+{
+    mChannelData->AdvanceToAbsPosition( mReplay.GetSampleNumber() );
+    mIsReplaying = false;
+    mTrace->Clear();
+    mTrace = nullptr;
+}
 
 AsyncRgbLedAnalyzer::AsyncRgbLedAnalyzer() : Analyzer2(), mSettings( new AsyncRgbLedAnalyzerSettings )
 {
@@ -30,61 +323,138 @@ void AsyncRgbLedAnalyzer::WorkerThread()
     mSampleRateHz = GetSampleRate();
     mChannelData = GetAnalyzerChannelData( mSettings->mInputChannel );
 
-    // cache this value here to avoid recomputing this every bit-read
-    if( mSettings->IsHighSpeedSupported() )
+    // a trace from an earlier run lets us decode again without walking the
+    // channel data, as long as it is of the same channel and sample rate
+    if( ( mPulseTraceChannel != mSettings->mInputChannel ) || ( mPulseTraceSampleRateHz != mSampleRateHz ) )
     {
-        mMinimumLowDurationSec = std::min( mSettings->DataTiming( BIT_LOW, true ).mNegativeTiming.mMinimumSec,
-                                           mSettings->DataTiming( BIT_HIGH, true ).mNegativeTiming.mMinimumSec );
+        mPulseTrace.Clear();
+        mPulseTraceChannel = mSettings->mInputChannel;
+        mPulseTraceSampleRateHz = mSampleRateHz;
     }
-    else
+
+    mChannelSource.SetChannelData( mChannelData, &mPulseTrace, mSampleRateHz );
+
+    // convert the controller timing to samples once, rather than every bit-read
+    const ControllerTimingTable timing = mSettings->BuildTimingTable( mSampleRateHz );
+    mDecoder.Configure( timing, mSettings->BitSize(), mSettings->GetColorLayout(), mSampleRateHz );
+    mDecoder.SetSource( &mChannelSource );
+
+    // DOUT is decoded with the same controller profile, from the channel data
+    // alone; its transitions aren't traced
+    mHasOutputChannel = mSettings->mOutputChannel != UNDEFINED_CHANNEL;
+    mHasOutputPacket = false;
+    mInputPixels.clear();
+    mForwardingErrorCount = 0;
+
+    if( mHasOutputChannel )
+    {
+        mOutputSource.SetChannelData( GetAnalyzerChannelData( mSettings->mOutputChannel ), nullptr, mSampleRateHz );
+        mOutputDecoder.Configure( timing, mSettings->BitSize(), mSettings->GetColorLayout(), mSampleRateHz );
+        mOutputDecoder.SetSource( &mOutputSource );
+        mOutputDecoder.SetPulseWidths( &mOutputPulseWidths );
+    }
+
+    mDecoder.SetPulseWidths( mHasOutputChannel ? &mInputPulseWidths : nullptr );
+
+    // the rules were checked when the settings were set
+    std::string badRule;
+    mEventRules.Parse( mSettings->mEventRules, badRule );
+    mEventRules.Reset( mSettings->BitSize() );
+    mEvents.clear();
+    mEventCount = 0;
+
+    mStatistics.Reset( mSampleRateHz );
+    mSummaryPacketCount = 0;
+    mColorSummary.Configure( mSampleRateHz, mSettings->BitSize() );
+    mDroppedColorSummaryCount = 0;
+    mResultsBudget.Configure( U64( mSettings->mResultsBudgetMB ) * 1024 * 1024 );
+    mChangeIndex.Clear();
+    mUnindexedPixelCount = 0;
+    mEstimateBitErrors = mSettings->mEstimateBitErrors;
+    mBitErrors.Configure( mSettings->BitSize() );
+    mBitErrorInterval = BitErrorCount();
+    mHasBitErrorInterval = false;
+    mStripLength.Configure( mSettings->mStripLength );
+    mTruncatedPacketCount = 0;
+    mOverlongPacketCount = 0;
+    mLineSpans.clear();
+    mHasLastLineSpan = false;
+    mFirstFreeSample = 0;
+
+    mMeasureTimingMargins = mSettings->mMeasureTimingMargins;
+
+    if( mMeasureTimingMargins )
     {
-        mMinimumLowDurationSec = std::min( mSettings->DataTiming( BIT_LOW ).mNegativeTiming.mMinimumSec,
-                                           mSettings->DataTiming( BIT_HIGH ).mNegativeTiming.mMinimumSec );
+        const bool hasHighSpeed = mSettings->IsHighSpeedSupported();
+        const BitTiming lowSpeed[ 2 ] = { mSettings->DataTiming( BIT_LOW ), mSettings->DataTiming( BIT_HIGH ) };
+        BitTiming highSpeed[ 2 ];
+
+        if( hasHighSpeed )
+        {
+            highSpeed[ BIT_LOW ] = mSettings->DataTiming( BIT_LOW, true );
+            highSpeed[ BIT_HIGH ] = mSettings->DataTiming( BIT_HIGH, true );
+        }
+
+        mTimingMargins.Configure( lowSpeed, highSpeed, hasHighSpeed, mSampleRateHz );
     }
 
+    PublishTimingMargins();
+
+    mDecoder.SetTimingMargins( mMeasureTimingMargins ? &mTimingMargins : nullptr );
+    mDecoder.SetLineSpans( &mLineSpans );
+    mDecoder.SetLineSpanSink( this );
+
+    mLiveDecoding = mSettings->mLiveDecoding;
+    mDecoder.SetProvisionalPixelSink( mLiveDecoding ? this : nullptr );
+    mLastCommitTime = std::chrono::steady_clock::now();
+    mPacketDecodeLag = 0;
+    mMaximumDecodeLag = 0;
+
     bool isResyncNeeded = true;
+    mIsAfterError = false;
+    ReplaySidecar( isResyncNeeded );
+
+    if( mStripLength.IsKnown() )
+    {
+        ReservePacketStorage( mStripLength.ExpectedPixels() );
+    }
 
     for( ;; )
     {
         if( isResyncNeeded )
         {
-            SynchronizeToReset();
+            mDecoder.SynchronizeToReset();
             isResyncNeeded = false;
+            AddLineSpanFrames();
         }
 
-        mFirstBitAfterReset = true;
-        U32 frameInPacketIndex = 0;
-        mResults->CommitPacketAndStartNewPacket();
+        mDecoder.StartPacket();
+        StartPacket();
 
         // data word reading loop
         for( ;; )
         {
-            auto result = ReadRGBTriple();
+            auto result = mDecoder.ReadRGBTriple();
 
             if( result.mValid )
             {
-                Frame frame;
-                frame.mFlags = 0;
-                frame.mStartingSampleInclusive = result.mValueBeginSample;
-                frame.mEndingSampleInclusive = result.mValueEndSample;
-                frame.mData1 = result.mRGB.ConvertToU64();
-                frame.mData2 = frameInPacketIndex++;
-                mResults->AddFrame( frame );
-
-                FrameV2 frame_v2;
-                frame_v2.AddInteger( "index", frame.mData2 );
-                frame_v2.AddInteger( "red", result.mRGB.red );
-                frame_v2.AddInteger( "green", result.mRGB.green );
-                frame_v2.AddInteger( "blue", result.mRGB.blue );
-                mResults->AddFrameV2( frame_v2, "pixel", frame.mStartingSampleInclusive, frame.mEndingSampleInclusive );
-
-                mResults->CommitResults();
+                // the line idled before this pixel
+                AddLineSpanFrames();
+
+                mPacket.mHighSpeed = mDecoder.IsHighSpeed();
+                AddDecodedPixel( result.mRGB, result.mValueBeginSample, result.mValueEndSample, result.mIsProvisional );
             }
-            else
+            else if( !result.mIsReset )
             {
+                if( result.mIsProvisional )
+                {
+                    // the pixel already shown turned out invalid
+                    mResults->AddMarker( result.mValueBeginSample, AnalyzerResults::ErrorDot, mSettings->mInputChannel );
+                }
+
                 // something error occurred, let's resynchronise
                 isResyncNeeded = true;
-            }
+            } // a pixel cut short by a reset is dropped, the next packet follows
 
             if( isResyncNeeded || result.mIsReset )
             {
@@ -92,248 +462,849 @@ void AsyncRgbLedAnalyzer::WorkerThread()
             }
         }
 
-        mResults->CommitResults();
-        ReportProgress( mChannelData->GetSampleNumber() );
+        FinishPass( isResyncNeeded, mChannelSource.GetSampleNumber() );
     }
 }
 
-void AsyncRgbLedAnalyzer::SynchronizeToReset()
+void AsyncRgbLedAnalyzer::ReplaySidecar( bool& isResyncNeeded )
 {
-    if( mChannelData->GetBitState() == BIT_HIGH )
+    mSidecarWriter.Close();
+    mSidecarKey = SidecarKey();
+    mSidecarStep.Clear();
+
+    // timing margins need every pulse, which the sidecar doesn't keep
+    if( mSettings->mResultsSidecarPath.empty() || mMeasureTimingMargins )
     {
-        mChannelData->AdvanceToNextEdge();
+        return;
     }
 
-    for( ;; )
+    const ControllerTimingTable timing = mSettings->BuildTimingTable( mSampleRateHz );
+    SidecarKey key;
+    key.mSettingsHash = HashDecoderSettings( timing, mSettings->BitSize(), mSettings->GetColorLayout() );
+    key.mSampleRateHz = mSampleRateHz;
+    key.mBitSize = mSettings->BitSize();
+
+    // a sidecar written while capturing hashed fewer transitions than we
+    // would now, so hash as many as it did
+    ResultsSidecarReader reader;
+    const bool isSidecar = reader.Open( mSettings->mResultsSidecarPath );
+    const U64 keyTransitions = isSidecar ? std::min( reader.Key().mChannelTransitions, SIDECAR_KEY_TRANSITIONS ) : SIDECAR_KEY_TRANSITIONS;
+
+    if( !mChannelSource.HashAhead( keyTransitions, key.mChannelHash, key.mChannelTransitions ) )
     {
-        const U64 lowTransition = mChannelData->GetSampleNumber();
-        const U64 highTransition = mChannelData->GetSampleOfNextEdge();
-        double lowTimeSec = ( highTransition - lowTransition ) / mSampleRateHz;
+        return;
+    }
 
-        if( lowTimeSec > mSettings->ResetTiming().mMinimumSec )
+    if( !isSidecar || !reader.Key().Matches( key ) )
+    {
+        reader.Close();
+
+        if( ( keyTransitions != SIDECAR_KEY_TRANSITIONS ) &&
+            !mChannelSource.HashAhead( SIDECAR_KEY_TRANSITIONS, key.mChannelHash, key.mChannelTransitions ) )
         {
-            // it's a reset, we are done
-            // advance to the end of the reset, ready for the first
-            // ReadRGB / ReadBit
-            mChannelData->AdvanceToAbsPosition( highTransition );
             return;
         }
 
-        // advance past the rising edge, to the next falling edge,
-        // which is our next candidate for the beginning of a RESET
-        mChannelData->AdvanceToAbsPosition( highTransition );
-        mChannelData->AdvanceToNextEdge();
+        mSidecarKey = key;
+        mSidecarWriter.Open( mSettings->mResultsSidecarPath, key );
+        return;
     }
+
+    // the same records as decoding would add, pass by pass
+    SidecarStep step;
+    SidecarCodecState matchedState = reader.State();
+    U64 matchedBytes = reader.IntactBytes();
+    bool isMismatch = false;
+
+    while( reader.Read( step ) )
+    {
+        // the key only covers the start of the channel, a capture which
+        // starts the same may go on differently. Once the packets part, the
+        // rest is decoded, and the sidecar cut short to be carried on.
+        if( !isResyncNeeded && !step.mPixels.empty() && !IsSidecarPacketOnChannel( matchedState.mEndSample, step, timing ) )
+        {
+            isMismatch = true;
+            break;
+        }
+
+        const auto spansAfterPacket = step.mSpans.begin() + step.mSpansBeforePacket;
+
+        mLineSpans.assign( step.mSpans.begin(), spansAfterPacket );
+        AddLineSpanFrames();
+
+        StartPacket();
+        mPacket.mHighSpeed = step.mHighSpeed;
+
+        for( const DecodedPixel& pixel : step.mPixels )
+        {
+            AddDecodedPixel( pixel.mRGB, pixel.mBeginSample, pixel.mEndSample, false );
+        }
+
+        mLineSpans.assign( spansAfterPacket, step.mSpans.end() );
+        FinishPass( step.mIsResyncNeeded, step.mEndSample );
+        isResyncNeeded = step.mIsResyncNeeded;
+
+        matchedState = reader.State();
+        matchedBytes = reader.IntactBytes();
+    }
+
+    reader.Close();
+
+    if( isMismatch )
+    {
+        // the channel is at the packet which didn't match, or just before it
+        AddSummaryIfCaughtUp( isResyncNeeded );
+        mResults->CommitResults();
+        mSidecarKey = key;
+        mSidecarWriter.Truncate( mSettings->mResultsSidecarPath, key, matchedState, matchedBytes );
+        return;
+    }
+
+    // decoding carries on where the sidecar ends
+    if( reader.State().mEndSample > mChannelSource.GetSampleNumber() )
+    {
+        mChannelSource.SkipTo( reader.State().mEndSample );
+        AddSummaryIfCaughtUp( isResyncNeeded );
+        mResults->CommitResults();
+    }
+
+    // new passes are added to an intact sidecar. A damaged one stays as it
+    // is, and decoding goes on from its last complete pass.
+    if( reader.IsIntact() )
+    {
+        mSidecarKey = key;
+        mSidecarWriter.Append( mSettings->mResultsSidecarPath, key, reader.State() );
+    }
+}
+
+bool AsyncRgbLedAnalyzer::IsSidecarPacketOnChannel( U64 fromSample, const SidecarStep& step, const ControllerTimingTable& timing )
+{
+    // the pass before ended in the reset gap, so the line must stay low up
+    // to the rising edge the first pixel starts on, as in CheckReplay
+    const DecodedPixel& first = step.mPixels.front();
+    mChannelSource.SkipTo( fromSample );
+
+    if( ( mChannelSource.GetBitState() != BIT_LOW ) || ( mChannelSource.GetSampleOfNextEdge() != first.mBeginSample ) )
+    {
+        return false;
+    }
+
+    // and the first pulse must be that of the pixel's first bit
+    U16 values[ 3 ];
+    first.mRGB.ConvertToControllerOrder( mSettings->GetColorLayout(), values );
+    const BitState firstBit = ( ( values[ 0 ] >> ( mSettings->BitSize() - 1 ) ) & 1 ) ? BIT_HIGH : BIT_LOW;
+
+    mChannelSource.AdvanceToNextEdge();
+    return timing.Data( firstBit, step.mHighSpeed ).mPositive.Contains( mChannelSource.GetSampleOfNextEdge() - first.mBeginSample );
 }
 
-auto AsyncRgbLedAnalyzer::ReadRGBTriple() -> RGBResult
+void AsyncRgbLedAnalyzer::StartPacket()
 {
-    const U8 bitSize = mSettings->BitSize();
-    U16 channels[ 3 ] = { 0, 0, 0 };
-    RGBResult result;
+    mFrameData = PixelFrameData();
+    mFrameData.mPacketIndex = mStatistics.PacketCount();
+    mResults->CommitPacketAndStartNewPacket();
 
-    DataBuilder builder;
-    int channel = 0;
+    mPacket = PacketSummary();
+    mArePixelsKept = true;
+    mPacketDecodeLag = 0;
 
-    for( ; channel < 3; )
+    mInputPixels.clear();
+    mInputPulseWidths.Clear();
+}
+
+void AsyncRgbLedAnalyzer::AddDecodedPixel( const RGBValue& rgb, U64 beginSample, U64 endSample, bool isShown )
+{
+    if( mPacket.mPixelCount == 0 )
     {
-        U64 value = 0;
-        builder.Reset( &value, AnalyzerEnums::MsbFirst, bitSize );
-        int i = 0;
+        mPacket.mBeginSample = beginSample;
+        mColorSummary.AddPacket( mPacket.mBeginSample );
+
+        const bool wasDecimating = mResultsBudget.HasDecimationStarted();
+        mArePixelsKept = mResultsBudget.KeepNextPacket();
 
-        for( ; i < bitSize; ++i )
+        if( !wasDecimating && mResultsBudget.HasDecimationStarted() )
         {
-            auto bitResult = ReadBit();
+            // show where the pixels start to be thinned out
+            mResults->AddMarker( mPacket.mBeginSample, AnalyzerResults::Stop, mSettings->mInputChannel );
+        }
 
-            if( !bitResult.mValid )
-            {
-                break;
-            }
+        mSidecarStep.mSpansBeforePacket = mSidecarStep.mSpans.size();
+    }
 
-            // for the first bit of channel 0, record the beginning time
-            // for accurate frame positions in the results
-            if( ( i == 0 ) && ( channel == 0 ) )
-            {
-                result.mValueBeginSample = bitResult.mBeginSample;
-            }
+    // a provisional pixel was shown already
+    if( mArePixelsKept && !isShown )
+    {
+        AddPixelFrame( rgb, beginSample, endSample, false );
+    }
+
+    mColorSummary.AddPixel( mFrameData.mLedIndex, rgb );
+    // the index shares the budget with the pixel frames, and isn't added to
+    // once it is used up
+    if( mResultsBudget.IsUsedUp() )
+    {
+        ++mUnindexedPixelCount;
+    }
+    else if( mChangeIndex.Add( mFrameData.mLedIndex, beginSample, rgb ) )
+    {
+        mResultsBudget.AddBytes( PixelChangeIndex::CHANGE_BYTES );
+    }
+
+    if( !mEventRules.IsEmpty() )
+    {
+        mEventRules.CheckPixel( mFrameData.mLedIndex, rgb, beginSample, mEvents );
+    }
+
+    if( mEstimateBitErrors )
+    {
+        mBitErrors.AddPixel( rgb );
+    }
+
+    mPacket.mEndSample = endSample;
+    ++mPacket.mPixelCount;
+    ++mFrameData.mLedIndex;
+
+    DecodedPixel pixel;
+    pixel.mRGB = rgb;
+    pixel.mBeginSample = beginSample;
+    pixel.mEndSample = endSample;
+
+    if( mHasOutputChannel )
+    {
+        mInputPixels.push_back( pixel );
+    }
+
+    if( mSidecarWriter.IsOpen() )
+    {
+        mSidecarStep.mPixels.push_back( pixel );
+    }
+}
+
+void AsyncRgbLedAnalyzer::FinishPass( bool isResyncNeeded, U64 position )
+{
+    if( mPacket.mPixelCount > 0 )
+    {
+        // the gap ends early when the line got stuck after the packet
+        const U64 endOfGapSample = mLineSpans.empty() ? position : mLineSpans.front().mBeginSample;
+
+        mPacket.mBitCount = mPacket.mPixelCount * 3 * mSettings->BitSize();
+        AddPacketFrame( mPacket, mArePixelsKept, endOfGapSample );
+        mIsAfterError = false;
+    }
+    else
+    {
+        mSidecarStep.mSpansBeforePacket = mSidecarStep.mSpans.size();
+    }
+
+    AddLineSpanFrames();
+
+    // flag the pixels of the next packet, since some before it were lost
+    mIsAfterError = mIsAfterError || isResyncNeeded;
+
+    AddSummaryIfCaughtUp( isResyncNeeded );
 
-            result.mValueEndSample = bitResult.mEndSample;
-            builder.AddBit( bitResult.mBitValue );
-            result.mIsReset = bitResult.mIsReset;
+    if( mMeasureTimingMargins )
+    {
+        PublishTimingMargins();
+    }
+
+    if( mSidecarWriter.IsOpen() )
+    {
+        mSidecarStep.mHighSpeed = mPacket.mHighSpeed;
+        mSidecarStep.mIsResyncNeeded = isResyncNeeded;
+        mSidecarStep.mEndSample = position;
+
+        if( !mSidecarStep.IsEmpty() )
+        {
+            mSidecarWriter.Write( mSidecarStep );
         }
 
-        if( i == bitSize )
+        mSidecarStep.Clear();
+
+        // a key made early in a live capture covers few transitions, until
+        // the trace holds enough for a full one
+        if( ( mSidecarKey.mChannelTransitions < SIDECAR_KEY_TRANSITIONS ) && ( mPulseTrace.TransitionCount() >= SIDECAR_KEY_TRANSITIONS ) )
         {
-            // we saw a complete channel, save it
-            channels[ channel++ ] = value;
+            mSidecarKey.mChannelHash = HashTraceStart( mPulseTrace, SIDECAR_KEY_TRANSITIONS );
+            mSidecarKey.mChannelTransitions = SIDECAR_KEY_TRANSITIONS;
+            mSidecarWriter.UpdateKey( mSidecarKey );
         }
-        else
+    }
+
+    mResults->CommitResults();
+    mLastCommitTime = std::chrono::steady_clock::now();
+    ReportProgress( position );
+}
+
+void AsyncRgbLedAnalyzer::PublishTimingMargins()
+{
+    std::lock_guard<std::mutex> lock( mPublishedTimingMarginsMutex );
+    mPublishedTimingMargins = mTimingMargins;
+}
+
+TimingMargins AsyncRgbLedAnalyzer::GetTimingMargins() const
+{
+    std::lock_guard<std::mutex> lock( mPublishedTimingMarginsMutex );
+    return mPublishedTimingMargins;
+}
+
+void AsyncRgbLedAnalyzer::AddSummaryIfCaughtUp( bool isResyncNeeded )
+{
+    // once we caught up with the captured data, publish the capture-wide
+    // summary so far. More data may still arrive in a live capture, in
+    // which case a later summary supersedes this one.
+    if( !isResyncNeeded && ( mStatistics.PacketCount() != mSummaryPacketCount ) && !mChannelSource.DoMoreTransitionsExistInCurrentData() )
+    {
+        AddSummaryFrame( std::max( mChannelSource.GetSampleNumber(), mFirstFreeSample ) );
+
+        if( mMeasureTimingMargins )
         {
-            // partial data due to reset or invalid timing, discard
-            break;
+            AddTimingMarginFrame( mFirstFreeSample );
         }
     }
+}
+
+void AsyncRgbLedAnalyzer::AddPixelFrame( const RGBValue& rgb, U64 beginSample, U64 endSample, bool isProvisional )
+{
+    Frame frame;
+    frame.mFlags = 0;
+    frame.mStartingSampleInclusive = beginSample;
+    frame.mEndingSampleInclusive = endSample;
+    frame.mData1 = rgb.ConvertToU64();
+    mFrameData.mFlags = static_cast<U8>( ( mPacket.mHighSpeed ? PIXEL_FRAME_HIGH_SPEED : 0 ) |
+                                         ( mIsAfterError ? PIXEL_FRAME_AFTER_ERROR : 0 ) | ( isProvisional ? PIXEL_FRAME_PROVISIONAL : 0 ) );
+    frame.mData2 = mFrameData.ConvertToU64();
+    mResults->AddFrame( frame );
 
-    if( channel == 3 )
+    FrameV2 frame_v2;
+    frame_v2.AddInteger( "index", mFrameData.mLedIndex );
+    frame_v2.AddInteger( "packet", mFrameData.mPacketIndex );
+    frame_v2.AddInteger( "red", rgb.red );
+    frame_v2.AddInteger( "green", rgb.green );
+    frame_v2.AddInteger( "blue", rgb.blue );
+
+    if( mLiveDecoding )
+    {
+        frame_v2.AddBoolean( "provisional", isProvisional );
+    }
+
+    mResults->AddFrameV2( frame_v2, "pixel", beginSample, endSample );
+    mResultsBudget.AddPixel();
+
+    if( !mLiveDecoding )
     {
-        // we saw three complete channels, we can use this
-        result.mRGB = RGBValue::CreateFromControllerOrder( mSettings->GetColorLayout(), channels );
-        result.mValid = true;
-    } // in all other cases, mValid stays false - no RGB data was written
+        return; // committed with the packet
+    }
+
+    // how far decoding had to get past the pixel before it could be shown
+    const U64 position = mChannelSource.GetSampleNumber();
+    mPacketDecodeLag = std::max( mPacketDecodeLag, position > endSample ? position - endSample : 0 );
+    mMaximumDecodeLag = std::max( mMaximumDecodeLag, mPacketDecodeLag );
+
+    // in the middle of a packet, show the pixels so far on a timer, or when
+    // decoding is about to wait for more data
+    const auto now = std::chrono::steady_clock::now();
 
-    return result;
+    if( isProvisional || ( now - mLastCommitTime >= LIVE_COMMIT_INTERVAL ) || mChannelSource.IsAtCaptureHead() )
+    {
+        mResults->CommitResults();
+        mLastCommitTime = now;
+    }
 }
 
-auto AsyncRgbLedAnalyzer::ReadBit() -> ReadResult
+bool AsyncRgbLedAnalyzer::AddProvisionalPixel( const RGBValue& rgb, U64 beginSample, U64 endSample )
 {
-    ReadResult result;
-    result.mValid = false;
+    // the first pixel of a packet decides whether the packet is kept, so it
+    // always goes the usual way
+    if( ( mPacket.mPixelCount == 0 ) || !mArePixelsKept )
+    {
+        return false;
+    }
+
+    AddPixelFrame( rgb, beginSample, endSample, true );
+    return true;
+}
 
-    if( mChannelData->GetBitState() == BIT_LOW )
+void AsyncRgbLedAnalyzer::AddPacketFrame( const PacketSummary& packet, bool arePixelsKept, U64 endOfGapSample )
+{
+    const PacketMetrics metrics = mStatistics.AddPacket( packet );
+
+    FrameV2 frame_v2;
+    frame_v2.AddInteger( "index", mStatistics.PacketCount() - 1 );
+    frame_v2.AddInteger( "pixels", packet.mPixelCount );
+    frame_v2.AddDouble( "duration", metrics.mDurationSec );
+    frame_v2.AddDouble( "bitrate", metrics.mBitrate );
+    frame_v2.AddBoolean( "high_speed", packet.mHighSpeed );
+    frame_v2.AddBoolean( "pixels_kept", arePixelsKept );
+
+    if( mResultsBudget.HasDecimationStarted() )
     {
-        mChannelData->AdvanceToNextEdge();
+        frame_v2.AddInteger( "decimation", mResultsBudget.DecimationFactor() );
     }
 
-    result.mBeginSample = mChannelData->GetSampleNumber();
-    mChannelData->AdvanceToNextEdge();
-    const U64 fallingEdgeSample = mChannelData->GetSampleNumber();
-    const double highTimeSec = ( fallingEdgeSample - result.mBeginSample ) / mSampleRateHz;
+    if( mLiveDecoding )
+    {
+        frame_v2.AddDouble( "decode_lag", mPacketDecodeLag / mSampleRateHz );
+    }
 
-    if( mFirstBitAfterReset )
+    if( metrics.mHasPrevious )
     {
-        // we can't classify yet, need to wait until we have the low pulse timing
+        frame_v2.AddDouble( "gap", metrics.mGapSec );
+        frame_v2.AddDouble( "refresh_rate", ( metrics.mRefreshIntervalSec > 0.0 ) ? 1.0 / metrics.mRefreshIntervalSec : 0.0 );
+        frame_v2.AddBoolean( "speed_changed", metrics.mSpeedModeChanged );
     }
-    else
+
+    // the record sits in the reset gap following the packet, so it never
+    // overlaps the pixel frames. The last sample is left free for a summary.
+    U64 begin = packet.mEndSample + 1;
+
+    // no later packet can fall into a bucket which ends before the next one
+    // starts. Their records take a sample each at the start of the gap, as
+    // many as it has room for. The rest are only counted.
+    mCompletedBuckets.clear();
+    mColorSummary.CompleteBucketsBefore( endOfGapSample, mCompletedBuckets );
+
+    for( const ColorSummaryBucket& bucket : mCompletedBuckets )
     {
-        // clasify based on existing value
-        // ensure consistency with previously detected speed setting
-        if( mSettings->DataTiming( BIT_LOW, mDidDetectHighSpeed ).mPositiveTiming.WithinTolerance( highTimeSec ) )
+        if( begin + 1 < endOfGapSample )
         {
-            result.mBitValue = BIT_LOW;
+            AddColorSummaryFrame( bucket, begin++ );
         }
-        else if( mSettings->DataTiming( BIT_HIGH, mDidDetectHighSpeed ).mPositiveTiming.WithinTolerance( highTimeSec ) )
+        else
         {
-            result.mBitValue = BIT_HIGH;
+            ++mDroppedColorSummaryCount;
         }
-        else
+    }
+
+    if( mHasOutputChannel )
+    {
+        AddForwardingFrame( begin, endOfGapSample );
+    }
+
+    // events take a sample each as well, as many as the gap has room for
+    // ahead of the packet record. The rest are only counted.
+    if( !mEventRules.IsEmpty() )
+    {
+        mEventRules.CheckPacket( packet, metrics, mEvents );
+        std::stable_sort( mEvents.begin(), mEvents.end(), []( const RuleEvent& a, const RuleEvent& b ) { return a.mSample < b.mSample; } );
+
+        for( const RuleEvent& event : mEvents )
         {
-            std::cerr << "positive pulse timing doesn't match detected speed mode" << std::endl;
-            mChannelData->AdvanceToAbsPosition( fallingEdgeSample );
-            return result; // invalid result, reset required
+            mResults->AddMarker( event.mSample, AnalyzerResults::Dot, mSettings->mInputChannel );
+
+            if( begin + 1 < endOfGapSample )
+            {
+                AddEventFrame( event, begin++ );
+            }
         }
+
+        mEventCount += mEvents.size();
+        mEvents.clear();
     }
 
-    // check for a too-short low timing
-    if( mChannelData->WouldAdvancingCauseTransition( mMinimumLowDurationSec * mSampleRateHz ) )
+    if( mEstimateBitErrors )
     {
-        mChannelData->AdvanceToNextEdge();
-        std::cerr << "too show low pulse, invalid bit" << std::endl;
-        return result; // invalid result, reset required
+        AddBitErrorFrames( packet, begin, endOfGapSample );
+    }
+
+    CheckStripLength( packet, begin, endOfGapSample );
+
+    // a gap cut short by a stuck line may not even have room for the
+    // packet record, which then takes the gap's last sample regardless
+    const U64 end = endOfGapSample - 1;
+    mResults->AddFrameV2( frame_v2, "packet", std::min( begin, end ), end );
+    mFirstFreeSample = end + 1;
+}
+
+void AsyncRgbLedAnalyzer::AddColorSummaryFrame( const ColorSummaryBucket& bucket, U64 sample )
+{
+    FrameV2 frame_v2;
+    frame_v2.AddInteger( "level", bucket.mLevel );
+    frame_v2.AddInteger( "begin_sample", bucket.mBeginSample );
+    frame_v2.AddInteger( "end_sample", bucket.mEndSample );
+    frame_v2.AddDouble( "duration", bucket.mDurationSec );
+    frame_v2.AddInteger( "packets", bucket.mPackets );
+    frame_v2.AddInteger( "pixels", bucket.mPixels );
+    frame_v2.AddInteger( "leds_per_range", bucket.mLedsPerRange );
+    frame_v2.AddByteArray( "colors", &bucket.mColors[ 0 ][ 0 ], bucket.mRangeCount * 3 );
+    mResults->AddFrameV2( frame_v2, "color_summary", sample, sample );
+}
+
+void AsyncRgbLedAnalyzer::AddForwardingFrame( U64& begin, U64 endOfGapSample )
+{
+    const U64 inputBegin = mInputPixels.front().mBeginSample;
+    const U64 inputEnd = mInputPixels.back().mEndSample;
+
+    // the DOUT packet forwarding this one starts while this one is being
+    // sent. Only decode DOUT when it has an edge by then, so that a quiet or
+    // broken DOUT line never holds up decoding DIN. DOUT packets starting
+    // before this one were forwarded from nothing on DIN, and are dropped.
+    while( ( !mHasOutputPacket || ( mOutputPacket.mSummary.mBeginSample < inputBegin ) ) &&
+           mOutputSource.DoMoreTransitionsExistInCurrentData() && ( mOutputSource.GetSampleOfNextEdge() <= inputEnd ) )
+    {
+        mOutputPulseWidths.Clear();
+        mHasOutputPacket = mOutputDecoder.DecodePacket( mOutputPacket );
     }
 
-    // check for a low period exceeding the minimum reset time
-    // if we exceed that, this is a reset
-    const int minResetSamples = static_cast<int>( mSettings->ResetTiming().mMinimumSec * mSampleRateHz );
+    const bool isForwarded =
+        mHasOutputPacket && ( mOutputPacket.mSummary.mBeginSample >= inputBegin ) && ( mOutputPacket.mSummary.mBeginSample <= inputEnd );
+    static const std::vector<DecodedPixel> noPixels;
+    const std::vector<DecodedPixel>& output = isForwarded ? mOutputPacket.mPixels : noPixels;
+
+    const U32 consumed = mSettings->mConsumedPixels;
+    const ForwardingMetrics metrics = CompareForwardedPixels( mInputPixels, consumed, output );
 
-    if( !mChannelData->WouldAdvancingCauseTransition( minResetSamples ) )
+    FrameV2 frame_v2;
+    frame_v2.AddInteger( "packet", mStatistics.PacketCount() - 1 );
+    frame_v2.AddInteger( "pixels_in", mInputPixels.size() );
+    frame_v2.AddInteger( "pixels_out", output.size() );
+    frame_v2.AddInteger( "expected_out", metrics.mExpectedPixels );
+    frame_v2.AddInteger( "mismatches", metrics.mMismatches );
+
+    if( metrics.mMismatches > 0 )
     {
-        // if we see a single bit in between resets, we can't decode the speed,
-        // but this is meaningless anyway, so return an error
-        if( mFirstBitAfterReset )
+        frame_v2.AddInteger( "first_mismatch", metrics.mFirstMismatch );
+        ++mForwardingErrorCount;
+
+        if( metrics.mFirstMismatch < output.size() )
         {
-            std::cerr << "No complete bit between resets, can't decode" << std::endl;
-            return result; // return invalid
+            mResults->AddMarker( output[ metrics.mFirstMismatch ].mBeginSample, AnalyzerResults::ErrorX, mSettings->mOutputChannel );
         }
+    }
 
-        mChannelData->Advance( minResetSamples );
-        result.mIsReset = true;
+    if( metrics.mHasShift )
+    {
+        frame_v2.AddInteger( "shift", metrics.mShift );
+    }
+
+    // from the first pixel DIN passes on to the first pixel on DOUT
+    if( !output.empty() && ( consumed < mInputPixels.size() ) )
+    {
+        const S64 delay = S64( output.front().mBeginSample ) - S64( mInputPixels[ consumed ].mBeginSample );
+        frame_v2.AddDouble( "delay", delay / mSampleRateHz );
+    }
+
+    // mean high widths, to see how the LEDs reshape the pulses. DIN widths
+    // are missing for packets read back from a results sidecar.
+    const char* const names[ 2 ][ 2 ] = { { "t0h_in", "t0h_out" }, { "t1h_in", "t1h_out" } };
+
+    for( const auto b : { BIT_LOW, BIT_HIGH } )
+    {
+        if( mInputPulseWidths.HasBits( b ) )
+        {
+            frame_v2.AddDouble( names[ b ][ 0 ], mInputPulseWidths.MeanHighSamples( b ) / mSampleRateHz );
+        }
+
+        if( isForwarded && mOutputPulseWidths.HasBits( b ) )
+        {
+            frame_v2.AddDouble( names[ b ][ 1 ], mOutputPulseWidths.MeanHighSamples( b ) / mSampleRateHz );
+        }
+    }
+
+    // a gap without room still counts the mismatches and marks them
+    if( begin + 1 < endOfGapSample )
+    {
+        mResults->AddFrameV2( frame_v2, "forwarding", begin, begin );
+        ++begin;
+    }
+
+    if( isForwarded )
+    {
+        mHasOutputPacket = false;
+    }
+}
+
+void AsyncRgbLedAnalyzer::AddEventFrame( const RuleEvent& event, U64 sample )
+{
+    const EventRule& rule = mEventRules.Rule( event.mRule );
+
+    FrameV2 frame_v2;
+    frame_v2.AddString( "rule", rule.mText.c_str() );
+    frame_v2.AddInteger( "rule_index", event.mRule );
+    frame_v2.AddInteger( "packet", mStatistics.PacketCount() - 1 );
+    frame_v2.AddInteger( "sample", event.mSample );
+
+    if( rule.mSubject == EventRule::RULE_LED )
+    {
+        frame_v2.AddInteger( "index", event.mLedIndex );
+        frame_v2.AddInteger( "red", event.mRGB.red );
+        frame_v2.AddInteger( "green", event.mRGB.green );
+        frame_v2.AddInteger( "blue", event.mRGB.blue );
     }
     else
     {
-        // we saw a transition, let's see the timing
-        mChannelData->AdvanceToNextEdge();
+        frame_v2.AddDouble( "value", event.mValue );
+    }
+
+    mResults->AddFrameV2( frame_v2, "event", sample, sample );
+}
 
-        // the -1 is so the end of this frame, and start of the next, don't
-        // overlap.
-        result.mEndSample = mChannelData->GetSampleNumber() - 1;
+void AsyncRgbLedAnalyzer::AddBitErrorFrames( const PacketSummary& packet, U64& begin, U64 endOfGapSample )
+{
+    // the packet before this one is judged now that this one is complete
+    const PacketBitErrors errors = mBitErrors.EndPacket( packet.mBeginSample );
+
+    if( !errors.mIsJudged )
+    {
+        return;
+    }
+
+    // an interval ends with the first packet judged after it
+    if( !mHasBitErrorInterval )
+    {
+        mBitErrorIntervalBegin = errors.mPacketBeginSample;
+        mHasBitErrorInterval = true;
+    }
+    else if( ( errors.mPacketBeginSample - mBitErrorIntervalBegin >= BIT_ERROR_INTERVAL_SEC * mSampleRateHz ) &&
+             ( begin + 1 < endOfGapSample ) )
+    {
+        FrameV2 frame_v2;
+        frame_v2.AddInteger( "begin_sample", mBitErrorIntervalBegin );
+        frame_v2.AddInteger( "end_sample", errors.mPacketBeginSample - 1 );
+        frame_v2.AddInteger( "bits_compared", mBitErrorInterval.mComparedBits );
+        frame_v2.AddInteger( "bits_flipped", mBitErrorInterval.mFlippedBits );
+        frame_v2.AddDouble( "bit_error_rate", mBitErrorInterval.Rate() );
+        mResults->AddFrameV2( frame_v2, "ber", begin, begin );
+        ++begin;
+
+        mBitErrorIntervalBegin = errors.mPacketBeginSample;
+        mBitErrorInterval = BitErrorCount();
     }
 
-    if( result.mIsReset )
+    mBitErrorInterval.mComparedBits += errors.mComparedBits;
+    mBitErrorInterval.mFlippedBits += errors.mFlippedBits;
+
+    if( ( errors.mFlippedBits > 0 ) && ( begin + 1 < endOfGapSample ) )
     {
-        // if this bit is also a reset, we can't check the low time since it
-        // will exceed the maximums, but we still want to accept that case
-        // as valid
-        result.mValid = true;
+        FrameV2 frame_v2;
+        frame_v2.AddInteger( "packet", mStatistics.PacketCount() - 2 );
+        frame_v2.AddInteger( "bits_compared", errors.mComparedBits );
+        frame_v2.AddInteger( "bits_flipped", errors.mFlippedBits );
+        frame_v2.AddInteger( "leds", errors.mFlippedLeds );
+        frame_v2.AddInteger( "first_led", errors.mFirstFlippedLed );
+        mResults->AddFrameV2( frame_v2, "bit_errors", begin, begin );
+        ++begin;
+    }
+}
+
+void AsyncRgbLedAnalyzer::CheckStripLength( const PacketSummary& packet, U64& begin, U64 endOfGapSample )
+{
+    const StripLengthModel::Verdict verdict = mStripLength.AddPacket( packet.mPixelCount );
 
-        // use the nominal negative pulse timing for the frame ending.
-        double nominalNegativeSec = mSettings->DataTiming( result.mBitValue, mDidDetectHighSpeed ).mNegativeTiming.mNominalSec;
-        result.mEndSample = fallingEdgeSample + ( nominalNegativeSec * mSampleRateHz );
+    if( verdict == StripLengthModel::STRIP_LEARNED )
+    {
+        ReservePacketStorage( mStripLength.ExpectedPixels() );
+        return;
     }
-    else if( mFirstBitAfterReset )
+
+    if( ( verdict != StripLengthModel::STRIP_TRUNCATED ) && ( verdict != StripLengthModel::STRIP_OVERLONG ) )
     {
-        const double lowTimeSec = ( result.mEndSample - fallingEdgeSample ) / mSampleRateHz;
-        // two-way classification. This is necessary because the the 0-data
-        // positive pulse of low-speed mode can match the 1-data positive pulse
-        // in high speed mode, for some controllers. Hence we need to correlate
-        // the high and low times to detect the speed mode
+        return;
+    }
 
-        // this also sets mBitValue correct as a side-effect of the detection
-        result.mValid = DetectSpeedMode( highTimeSec, lowTimeSec, result.mBitValue );
+    const bool isTruncated = verdict == StripLengthModel::STRIP_TRUNCATED;
+    if( isTruncated )
+    {
+        ++mTruncatedPacketCount;
     }
     else
     {
-        // already detected the speed mode, ensure consistency
-        const double lowTimeSec = ( result.mEndSample - fallingEdgeSample ) / mSampleRateHz;
+        ++mOverlongPacketCount;
+    }
 
-        if( mSettings->DataTiming( result.mBitValue, mDidDetectHighSpeed ).mNegativeTiming.WithinTolerance( lowTimeSec ) )
-        {
-            // we are good
-            result.mValid = true;
-        }
-        else
-        {
-            // we could do further classification here on the error, eg speed mismatch,
-            // or bit value mismatch
-            std::cerr << "negative pulse timing doesn't match positive pulse" << std::endl;
-            result.mValid = false;
-        }
+    mResults->AddMarker( packet.mEndSample, AnalyzerResults::ErrorSquare, mSettings->mInputChannel );
+
+    if( begin + 1 < endOfGapSample )
+    {
+        FrameV2 frame_v2;
+        frame_v2.AddInteger( "packet", mStatistics.PacketCount() - 1 );
+        frame_v2.AddString( "kind", isTruncated ? "truncated" : "overlong" );
+        frame_v2.AddInteger( "pixels", packet.mPixelCount );
+        frame_v2.AddInteger( "expected", mStripLength.ExpectedPixels() );
+        frame_v2.AddBoolean( "learned", !mStripLength.IsFixed() );
+        mResults->AddFrameV2( frame_v2, "strip_length", begin, begin );
+        ++begin;
+    }
+}
+
+void AsyncRgbLedAnalyzer::ReservePacketStorage( U32 pixels )
+{
+    // room for a whole strip up front, so that no buffer of a packet's pixels
+    // grows pixel by pixel while it is decoded. Longer packets still fit.
+    if( mHasOutputChannel )
+    {
+        mInputPixels.reserve( pixels );
+        mOutputPacket.mPixels.reserve( pixels );
+    }
+
+    if( mSidecarWriter.IsOpen() )
+    {
+        mSidecarStep.mPixels.reserve( pixels );
     }
 
-    return result;
+    if( mEstimateBitErrors )
+    {
+        mBitErrors.Reserve( pixels );
+    }
 }
 
-bool AsyncRgbLedAnalyzer::DetectSpeedMode( double positiveTimeSec, double negativeTimeSec, BitState& value )
+void AsyncRgbLedAnalyzer::AddSummaryFrame( U64 sample )
 {
-    mDidDetectHighSpeed = false;
+    const RunningStatistic& interval = mStatistics.RefreshInterval();
+    const RunningStatistic& gap = mStatistics.Gap();
+    const RunningStatistic& duration = mStatistics.Duration();
+    const RunningStatistic& pixels = mStatistics.PixelsPerPacket();
 
-    // low speed bits
-    for( const auto b : { BIT_LOW, BIT_HIGH } )
+    FrameV2 frame_v2;
+    frame_v2.AddInteger( "packets", mStatistics.PacketCount() );
+    frame_v2.AddDouble( "refresh_rate", ( interval.Mean() > 0.0 ) ? 1.0 / interval.Mean() : 0.0 );
+    frame_v2.AddDouble( "refresh_interval_min", interval.Minimum() );
+    frame_v2.AddDouble( "refresh_interval_max", interval.Maximum() );
+    frame_v2.AddDouble( "refresh_interval_median", interval.Median() );
+    frame_v2.AddDouble( "refresh_interval_p99", interval.Percentile99() );
+    frame_v2.AddDouble( "gap_min", gap.Minimum() );
+    frame_v2.AddDouble( "gap_max", gap.Maximum() );
+    frame_v2.AddDouble( "gap_mean", gap.Mean() );
+    frame_v2.AddDouble( "gap_jitter", gap.StandardDeviation() );
+    frame_v2.AddDouble( "duration_min", duration.Minimum() );
+    frame_v2.AddDouble( "duration_max", duration.Maximum() );
+    frame_v2.AddDouble( "duration_mean", duration.Mean() );
+    frame_v2.AddDouble( "bitrate_mean", mStatistics.Bitrate().Mean() );
+    frame_v2.AddInteger( "pixels_min", static_cast<S64>( pixels.Minimum() ) );
+    frame_v2.AddInteger( "pixels_max", static_cast<S64>( pixels.Maximum() ) );
+    frame_v2.AddDouble( "pixels_mean", pixels.Mean() );
+    frame_v2.AddInteger( "speed_changes", mStatistics.SpeedModeChanges() );
+    frame_v2.AddInteger( "dropped_color_summaries", mDroppedColorSummaryCount );
+    frame_v2.AddInteger( "unindexed_pixels", mUnindexedPixelCount );
+
+    if( mStripLength.IsKnown() )
     {
-        if( mSettings->DataTiming( b ).WithinTolerance( positiveTimeSec, negativeTimeSec ) )
+        frame_v2.AddInteger( "expected_pixels", mStripLength.ExpectedPixels() );
+        frame_v2.AddInteger( "truncated_packets", mTruncatedPacketCount );
+        frame_v2.AddInteger( "overlong_packets", mOverlongPacketCount );
+    }
+
+    if( mHasOutputChannel )
+    {
+        frame_v2.AddInteger( "forwarding_errors", mForwardingErrorCount );
+    }
+
+    if( !mEventRules.IsEmpty() )
+    {
+        frame_v2.AddInteger( "events", mEventCount );
+    }
+
+    if( mEstimateBitErrors )
+    {
+        const BitErrorCount total = mBitErrors.Total();
+        frame_v2.AddInteger( "bits_compared", total.mComparedBits );
+        frame_v2.AddInteger( "bits_flipped", total.mFlippedBits );
+        frame_v2.AddDouble( "bit_error_rate", total.Rate() );
+
+        // "index:flipped bits" of the worst LEDs
+        std::vector<U32> worstLeds;
+        mBitErrors.WorstLeds( BIT_ERROR_WORST_LED_COUNT, worstLeds );
+        std::string worst;
+
+        for( const U32 led : worstLeds )
         {
-            value = b;
-            mFirstBitAfterReset = false;
-            return true;
+            worst += ( worst.empty() ? "" : " " ) + std::to_string( led ) + ":" + std::to_string( mBitErrors.Led( led ).mFlippedBits );
         }
+
+        frame_v2.AddString( "ber_worst_leds", worst.c_str() );
     }
 
-    if( mSettings->IsHighSpeedSupported() )
+    if( mLiveDecoding )
+    {
+        frame_v2.AddDouble( "decode_lag_max", mMaximumDecodeLag / mSampleRateHz );
+    }
+
+    mResults->AddFrameV2( frame_v2, "summary", sample, sample );
+    mFirstFreeSample = sample + 1;
+
+    mSummaryPacketCount = mStatistics.PacketCount();
+}
+
+void AsyncRgbLedAnalyzer::AddTimingMarginFrame( U64 sample )
+{
+    bool isHighSpeed = false;
+    BitState value = BIT_LOW;
+    PulsePhase phase = PULSE_HIGH;
+    const TimingMarginHistogram* worst = mTimingMargins.Worst( isHighSpeed, value, phase );
+
+    if( !worst )
+    {
+        return;
+    }
+
+    FrameV2 frame_v2;
+    frame_v2.AddDouble( "worst_margin", worst->WorstMarginSec() );
+    frame_v2.AddInteger( "worst_sample", worst->WorstSample() );
+    frame_v2.AddInteger( "worst_bit", value == BIT_HIGH ? 1 : 0 );
+    frame_v2.AddString( "worst_phase", phase == PULSE_HIGH ? "high" : "low" );
+    frame_v2.AddBoolean( "worst_high_speed", isHighSpeed );
+
+    U64 outOfTolerance = 0;
+
+    for( const bool speed : { false, true } )
     {
-        // high speed bits
         for( const auto b : { BIT_LOW, BIT_HIGH } )
         {
-            if( mSettings->DataTiming( b, true ).WithinTolerance( positiveTimeSec, negativeTimeSec ) )
+            for( const auto p : { PULSE_HIGH, PULSE_LOW } )
             {
-                mDidDetectHighSpeed = true;
-                value = b;
-                mFirstBitAfterReset = false;
-                return true;
+                const TimingMarginHistogram& h = mTimingMargins.Histogram( speed, b, p );
+                outOfTolerance += h.Underflow() + h.Overflow();
             }
         }
-    } // of high-speed mode tests
+    }
 
-    std::cerr << "failed to classify: " << positiveTimeSec << "/" << negativeTimeSec << std::endl;
-    return false;
+    frame_v2.AddInteger( "out_of_tolerance", outOfTolerance );
+    mResults->AddFrameV2( frame_v2, "timing_margin", sample, sample );
+    mFirstFreeSample = sample + 1;
+}
+
+void AsyncRgbLedAnalyzer::AddLineSpanFrames()
+{
+    if( mSidecarWriter.IsOpen() )
+    {
+        mSidecarStep.mSpans.insert( mSidecarStep.mSpans.end(), mLineSpans.begin(), mLineSpans.end() );
+    }
+
+    for( const LineSpan& span : mLineSpans )
+    {
+        // the start of an idle span can be taken by the records of the gap
+        const U64 begin = std::max( span.mBeginSample, mFirstFreeSample );
+        const U64 end = std::max( begin, span.mEndSample );
+
+        // a span still going on at the head of a live capture comes in pieces
+        const bool isContinued =
+            mHasLastLineSpan && ( mLastLineSpan.mLevel == span.mLevel ) && ( mLastLineSpan.mEndSample + 1 == span.mBeginSample );
+        mHasLastLineSpan = true;
+        mLastLineSpan = span;
+
+        FrameV2 frame_v2;
+        frame_v2.AddDouble( "duration", ( span.mEndSample + 1 - span.mBeginSample ) / mSampleRateHz );
+        frame_v2.AddBoolean( "continued", isContinued );
+        mResults->AddFrameV2( frame_v2, span.mLevel == BIT_HIGH ? "stuck" : "idle", begin, end );
+        mFirstFreeSample = end + 1;
+
+        if( ( span.mLevel == BIT_HIGH ) && !isContinued )
+        {
+            mResults->AddMarker( span.mBeginSample, AnalyzerResults::ErrorX, mSettings->mInputChannel );
+        }
+
+        // the gap was crossed in one step, show the progress right away
+        mResults->CommitResults();
+        ReportProgress( span.mEndSample );
+    }
+
+    mLineSpans.clear();
+}
+
+void AsyncRgbLedAnalyzer::UpdateLineSpans()
+{
+    // only called between packets, so the span can't overlap a packet's
+    // records
+    AddLineSpanFrames();
 }
 
 bool AsyncRgbLedAnalyzer::NeedsRerun()
@@ -3,14 +3,83 @@
 
 #include <Analyzer.h>
 
+#include <chrono>
+#include <mutex>
+
 #include "AsyncRgbLedSimulationDataGenerator.h"
+#include "AsyncRgbLedBitErrors.h"
+#include "AsyncRgbLedChangeIndex.h"
+#include "AsyncRgbLedColorSummary.h"
+#include "AsyncRgbLedDecoder.h"
+#include "AsyncRgbLedEventRules.h"
+#include "AsyncRgbLedForwarding.h"
 #include "AsyncRgbLedHelpers.h"
+#include "AsyncRgbLedPulseTrace.h"
+#include "AsyncRgbLedResultsBudget.h"
+#include "AsyncRgbLedResultsSidecar.h"
+#include "AsyncRgbLedStatistics.h"
+#include "AsyncRgbLedStripLength.h"
+#include "AsyncRgbLedTimingMargins.h"
 
 // forward decls
 class AsyncRgbLedAnalyzerSettings;
 class AsyncRgbLedAnalyzerResults;
 
-class AsyncRgbLedAnalyzer : public Analyzer2
+/**
+ * @brief AnalyzerChannelEdgeSource - feeds the decoder from the SDK channel
+ * data, and records its transitions into a PulseTrace on the way.
+ *
+ * A trace left by an earlier run is replayed instead of reading the channel
+ * data, which is only read again past the end of the trace, extending it.
+ */
+class AnalyzerChannelEdgeSource : public EdgeSource
+{
+  public:
+    /// the trace may be nullptr, to read the channel data only
+    void SetChannelData( AnalyzerChannelData* channelData, PulseTrace* trace, double sampleRateHz );
+
+    U64 GetSampleNumber() override;
+    BitState GetBitState() override;
+    void Advance( U32 numSamples ) override;
+    void AdvanceToAbsPosition( U64 sampleNumber ) override;
+    void AdvanceToNextEdge() override;
+    U64 GetSampleOfNextEdge() override;
+    bool WouldAdvancingCauseTransition( U32 numSamples ) override;
+
+    bool IsAtCaptureHead() override;
+    bool DoMoreTransitionsExistInCurrentData();
+
+    /// hashes the level and up to maxTransitions transitions from the start
+    /// of the trace, as many as the channel data has so far, then goes back
+    /// there by replaying the trace. Returns false if the trace could not
+    /// cover them, in which case the position is wherever hashing stopped.
+    bool HashAhead( U64 maxTransitions, U64& hash, U64& transitionCount );
+
+    /// moves ahead without reading the edges on the way. Past the end of the
+    /// trace, it stops being extended, since it can't have a gap.
+    void SkipTo( U64 sampleNumber );
+
+    bool IsReplaying() const
+    {
+        return mIsReplaying;
+    }
+
+  private:
+    void AdvanceChannel( U64 sampleNumber );
+    void CheckReplay();
+    void StopReplay();
+    void DropTrace();
+
+    AnalyzerChannelData* mChannelData = nullptr;
+    PulseTrace* mTrace = nullptr;
+
+    PulseTraceEdgeSource mReplay;
+    bool mIsReplaying = false;
+    U64 mReplayEndSample = 0;
+    size_t mNextBoundary = 0; // the next reset boundary to check
+};
+
+class AsyncRgbLedAnalyzer : public Analyzer2, private ProvisionalPixelSink, private LineSpanSink
 {
   public:
     AsyncRgbLedAnalyzer();
@@ -25,6 +94,21 @@ class AsyncRgbLedAnalyzer : public Analyzer2
     const char* GetAnalyzerName() const override;
     bool NeedsRerun() override;
 
+    /// a copy of the margins as of the last decoding pass, safe to take
+    /// while decoding goes on
+    TimingMargins GetTimingMargins() const;
+
+    /// value changes of each LED, for per-LED timelines and color searches
+    const PixelChangeIndex& GetPixelChangeIndex() const
+    {
+        return mChangeIndex;
+    }
+
+    const BitErrorEstimator& GetBitErrors() const
+    {
+        return mBitErrors;
+    }
+
   protected: // vars
     std::unique_ptr<AsyncRgbLedAnalyzerSettings> mSettings;
     std::unique_ptr<AsyncRgbLedAnalyzerResults> mResults;
@@ -36,38 +120,118 @@ class AsyncRgbLedAnalyzer : public Analyzer2
     // analysis vars:
     double mSampleRateHz = 0;
 
-    // minimum valid low time for a data bit, in either speed mode supported
-    // by the controller.
-    double mMinimumLowDurationSec = 0.0;
-
-    bool mFirstBitAfterReset = false;
-    bool mDidDetectHighSpeed = false;
+    AnalyzerChannelEdgeSource mChannelSource;
+
+    // transitions of the input channel, kept from run to run
+    PulseTrace mPulseTrace;
+    Channel mPulseTraceChannel;
+    double mPulseTraceSampleRateHz = 0;
+    AsyncRgbLedDecoder mDecoder;
+
+    CaptureStatistics mStatistics;
+
+    // packet count at the time of the last "summary" record, so we only
+    // emit a new summary once something changed
+    U64 mSummaryPacketCount = 0;
+
+    // the decoder adds to mTimingMargins without locking, and each pass
+    // publishes a copy for exports to read
+    bool mMeasureTimingMargins = false;
+    TimingMargins mTimingMargins;
+    mutable std::mutex mPublishedTimingMarginsMutex;
+    TimingMargins mPublishedTimingMargins;
+
+    ColorSummaryPyramid mColorSummary;
+    U64 mDroppedColorSummaryCount = 0; // records which didn't fit in their reset gap
+    std::vector<ColorSummaryBucket> mCompletedBuckets;
+
+    ResultsBudget mResultsBudget;
+    PixelChangeIndex mChangeIndex;
+    U64 mUnindexedPixelCount = 0; // pixels left out of mChangeIndex once the results budget was used up
+
+    // idle and stuck spans found by the decoder, not yet added as records,
+    // and the last one added, which a span still going on continues
+    std::vector<LineSpan> mLineSpans;
+    bool mHasLastLineSpan = false;
+    LineSpan mLastLineSpan;
+
+    // records placed in reset gaps start no earlier than this, so they never
+    // overlap each other
+    U64 mFirstFreeSample = 0;
+
+    // the results of a run with the same settings and channel data, see
+    // ResultsSidecarReader
+    ResultsSidecarWriter mSidecarWriter;
+    SidecarKey mSidecarKey;
+    SidecarStep mSidecarStep;
+
+    // the DOUT channel, decoded alongside to check what the LEDs forward. A
+    // decoded DOUT packet is kept until the DIN packet it belongs to is done.
+    bool mHasOutputChannel = false;
+    AnalyzerChannelEdgeSource mOutputSource;
+    AsyncRgbLedDecoder mOutputDecoder;
+    DecodedPacket mOutputPacket;
+    bool mHasOutputPacket = false;
+    std::vector<DecodedPixel> mInputPixels; // of the current DIN packet
+    PulseWidthTotals mInputPulseWidths;
+    PulseWidthTotals mOutputPulseWidths;
+    U64 mForwardingErrorCount = 0; // DIN packets not forwarded as expected
+
+    // rules checked against every pixel and packet, and what fired during
+    // the current packet
+    EventRuleSet mEventRules;
+    std::vector<RuleEvent> mEvents;
+    U64 mEventCount = 0;
+
+    // flipped bits in static content, totalled over intervals of the capture
+    // for the "ber" records
+    bool mEstimateBitErrors = false;
+    BitErrorEstimator mBitErrors;
+    BitErrorCount mBitErrorInterval;
+    U64 mBitErrorIntervalBegin = 0;
+    bool mHasBitErrorInterval = false;
+
+    // the pixels every packet should carry, and the packets which didn't
+    StripLengthModel mStripLength;
+    U64 mTruncatedPacketCount = 0;
+    U64 mOverlongPacketCount = 0;
+
+    // the packet being decoded, shared with AddProvisionalPixel
+    PacketSummary mPacket;
+    PixelFrameData mFrameData;
+    bool mArePixelsKept = true;
+    bool mIsAfterError = false;
+
+    bool mLiveDecoding = false;
+    std::chrono::steady_clock::time_point mLastCommitTime;
+
+    // samples decoding went past the end of a pixel before it was shown,
+    // the largest in the current packet and overall
+    U64 mPacketDecodeLag = 0;
+    U64 mMaximumDecodeLag = 0;
 
   private:
-    struct RGBResult
-    {
-        bool mValid = false;
-        bool mIsReset = false;
-        RGBValue mRGB;
-        U64 mValueBeginSample = 0;
-        U64 mValueEndSample = 0;
-    };
-
-    RGBResult ReadRGBTriple();
-
-    struct ReadResult
-    {
-        bool mValid = false;
-        bool mIsReset = false;
-        BitState mBitValue = BIT_LOW;
-        U64 mBeginSample = 0;
-        U64 mEndSample = 0;
-    };
-
-    ReadResult ReadBit();
-    void SynchronizeToReset();
-
-    bool DetectSpeedMode( double positiveTimeSec, double negativeTimeSec, BitState& value );
+    void ReplaySidecar( bool& isResyncNeeded );
+    bool IsSidecarPacketOnChannel( U64 fromSample, const SidecarStep& step, const ControllerTimingTable& timing );
+    void StartPacket();
+    void AddDecodedPixel( const RGBValue& rgb, U64 beginSample, U64 endSample, bool isShown );
+    void FinishPass( bool isResyncNeeded, U64 position );
+    void AddSummaryIfCaughtUp( bool isResyncNeeded );
+    void PublishTimingMargins();
+
+    void AddPixelFrame( const RGBValue& rgb, U64 beginSample, U64 endSample, bool isProvisional );
+    bool AddProvisionalPixel( const RGBValue& rgb, U64 beginSample, U64 endSample ) override;
+    void AddPacketFrame( const PacketSummary& packet, bool arePixelsKept, U64 endOfGapSample );
+    void AddColorSummaryFrame( const ColorSummaryBucket& bucket, U64 sample );
+    void AddForwardingFrame( U64& begin, U64 endOfGapSample );
+    void AddEventFrame( const RuleEvent& event, U64 sample );
+    void AddBitErrorFrames( const PacketSummary& packet, U64& begin, U64 endOfGapSample );
+    void CheckStripLength( const PacketSummary& packet, U64& begin, U64 endOfGapSample );
+    void ReservePacketStorage( U32 pixels );
+    void AddSummaryFrame( U64 sample );
+    void AddTimingMarginFrame( U64 sample );
+    void AddLineSpanFrames();
+    void UpdateLineSpans() override;
 };
 
 extern "C"
@@ -2,26 +2,48 @@
 #include <AnalyzerHelpers.h>
 #include "AsyncRgbLedAnalyzer.h"
 #include "AsyncRgbLedAnalyzerSettings.h"
-#include <iostream>
-#include <fstream>
+#include "AsyncRgbLedResultsText.h"
 
-AsyncRgbLedAnalyzerResults::AsyncRgbLedAnalyzerResults( AsyncRgbLedAnalyzer* analyzer, AsyncRgbLedAnalyzerSettings* settings )
-    : AnalyzerResults(), mSettings( settings ), mAnalyzer( analyzer )
+#include <algorithm> // for std::max
+#include <cmath>     // for llround
+
+namespace
 {
+    /// the analyzer's own frames, for the shared export code
+    class ResultsFrameStore : public PixelFrameStore
+    {
+      public:
+        explicit ResultsFrameStore( AnalyzerResults& results ) : mResults( results )
+        {
+        }
+
+        U64 FrameCount() override
+        {
+            return mResults.GetNumFrames();
+        }
+
+        Frame PixelFrame( U64 frameIndex ) override
+        {
+            return mResults.GetFrame( frameIndex );
+        }
+
+        bool UpdateProgressAndCheckForCancel( U64 completedFrames, U64 totalFrames ) override
+        {
+            return mResults.UpdateExportProgressAndCheckForCancel( completedFrames, totalFrames );
+        }
+
+      private:
+        AnalyzerResults& mResults;
+    };
 }
 
-AsyncRgbLedAnalyzerResults::~AsyncRgbLedAnalyzerResults()
+AsyncRgbLedAnalyzerResults::AsyncRgbLedAnalyzerResults( AsyncRgbLedAnalyzer* analyzer, AsyncRgbLedAnalyzerSettings* settings )
+    : AnalyzerResults(), mSettings( settings ), mAnalyzer( analyzer )
 {
 }
 
-void AsyncRgbLedAnalyzerResults::GenerateRGBStrings( const RGBValue& rgb, DisplayBase base, size_t bufSize, char* redBuf, char* greenBuff,
-                                                     char* blueBuf )
+AsyncRgbLedAnalyzerResults::~AsyncRgbLedAnalyzerResults()
 {
-    // generate a numerical representation of each color channel,
-    // respecting the display-base setting
-    AnalyzerHelpers::GetNumberString( rgb.red, base, mSettings->BitSize(), redBuf, bufSize );
-    AnalyzerHelpers::GetNumberString( rgb.green, base, mSettings->BitSize(), greenBuff, bufSize );
-    AnalyzerHelpers::GetNumberString( rgb.blue, base, mSettings->BitSize(), blueBuf, bufSize );
 }
 
 void AsyncRgbLedAnalyzerResults::GenerateBubbleText( U64 frame_index, Channel& channel, DisplayBase display_base )
@@ -29,88 +51,75 @@ void AsyncRgbLedAnalyzerResults::GenerateBubbleText( U64 frame_index, Channel& c
     ClearResultStrings();
     Frame frame = GetFrame( frame_index );
 
-    U32 ledIndex = frame.mData2;
-    RGBValue rgb = RGBValue::CreateFromU64( frame.mData1 );
-
-    // generate a Web/CSS representation of the color value
-    U8 webColor[ 3 ];
-    rgb.ConvertTo8Bit( mSettings->BitSize(), webColor );
-    char webBuf[ 8 ];
-    ::snprintf( webBuf, sizeof( webBuf ), "#%02x%02x%02x", webColor[ 0 ], webColor[ 1 ], webColor[ 2 ] );
-
-    const int colorNumericBufferLength = 16;
-    char redString[ colorNumericBufferLength ], greenString[ colorNumericBufferLength ], blueString[ colorNumericBufferLength ];
-
-    GenerateRGBStrings( rgb, display_base, colorNumericBufferLength, redString, greenString, blueString );
-
-    // generate four different string variants of varying length, starting with
-    // the longest and decreasing in size
-    char buf[ 256 ];
-
-    // example: LED: 13 Red: 0x1A Green: 0x2B Blue: 0x3C #1A2B3C
-    ::snprintf( buf, sizeof( buf ), "LED %d Red: %s Green: %s Blue: %s %s", ledIndex, redString, greenString, blueString, webBuf );
-    AddResultString( buf );
-
-    // example: 13 R:0x1A G:0x2B B:0x3C #1A2B3C
-    ::snprintf( buf, sizeof( buf ), "%d R: %s G: %s B: %s %s", ledIndex, redString, greenString, blueString, webBuf );
-    AddResultString( buf );
+    PixelBubbleText text;
+    FormatPixelBubbleText( frame, display_base, mSettings->BitSize(), text );
 
-    // example: (13) #1A2B3C
-    ::snprintf( buf, sizeof( buf ), "(%d) %s", ledIndex, webBuf );
-    AddResultString( buf );
-
-    // example: #1A2B3C
-    AddResultString( webBuf );
+    for( const char* variant : text.mVariants )
+    {
+        AddResultString( variant );
+    }
 }
 
 void AsyncRgbLedAnalyzerResults::GenerateExportFile( const char* file, DisplayBase display_base, U32 export_type_user_id )
 {
-    std::ofstream file_stream( file, std::ios::out );
-
-    U64 trigger_sample = mAnalyzer->GetTriggerSample();
-    U32 sample_rate = mAnalyzer->GetSampleRate();
-
-    file_stream << "Time [s], Packet ID, LED Index, Red, Green, Blue, Web-CSS" << std::endl;
-
-    const U64 num_frames = GetNumFrames();
-
-    for( U64 i = 0; i < num_frames; i++ )
+    switch( export_type_user_id )
     {
-        const Frame frame = GetFrame( i );
-        U64 packetId = GetPacketContainingFrameSequential( num_frames );
-
-        if( packetId == INVALID_RESULT_INDEX )
-        {
-            packetId = -1;
-        }
-
-        char time_str[ 128 ];
-        AnalyzerHelpers::GetTimeString( frame.mStartingSampleInclusive, trigger_sample, sample_rate, time_str, 128 );
-
-        RGBValue rgb = RGBValue::CreateFromU64( frame.mData1 );
-
-        // RGB numerical value representation
-        const size_t bufSize = 16;
-        char rs[ bufSize ], gs[ bufSize ], bs[ bufSize ];
-        GenerateRGBStrings( rgb, display_base, bufSize, rs, gs, bs );
-
-        // CSS representation
-        U8 webColor[ 3 ];
-        rgb.ConvertTo8Bit( mSettings->BitSize(), webColor );
-        char webBuf[ 8 ];
-        ::snprintf( webBuf, sizeof( webBuf ), "#%02x%02x%02x", webColor[ 0 ], webColor[ 1 ], webColor[ 2 ] );
+    case AsyncRgbLedAnalyzerSettings::EXPORT_TIMING_MARGINS_CSV:
+        ExportTimingMarginsCsv( file, mAnalyzer->GetTimingMargins() );
+        UpdateExportProgressAndCheckForCancel( 1, 1 );
+        break;
+
+    case AsyncRgbLedAnalyzerSettings::EXPORT_LED_CHANGES_CSV:
+        ExportLedChangesCsv( file, mAnalyzer->GetPixelChangeIndex(), display_base, mSettings->BitSize(), mAnalyzer->GetTriggerSample(),
+                             mAnalyzer->GetSampleRate() );
+        UpdateExportProgressAndCheckForCancel( 1, 1 );
+        break;
+
+    case AsyncRgbLedAnalyzerSettings::EXPORT_BIT_ERRORS_CSV:
+        ExportBitErrorsCsv( file, mAnalyzer->GetBitErrors() );
+        UpdateExportProgressAndCheckForCancel( 1, 1 );
+        break;
+
+    case AsyncRgbLedAnalyzerSettings::EXPORT_PIXELS_WINDOW_CSV:
+    case AsyncRgbLedAnalyzerSettings::EXPORT_PIXELS_PACKETS_CSV:
+    case AsyncRgbLedAnalyzerSettings::EXPORT_PIXELS_CSV:
+    default:
+        ExportPixelRange( file, display_base, export_type_user_id );
+        break;
+    }
+}
 
-        file_stream << time_str << "," << packetId << "," << frame.mData2 << "," << rs << "," << gs << "," << bs << "," << webBuf
-                    << std::endl;
+void AsyncRgbLedAnalyzerResults::ExportPixelRange( const char* file, DisplayBase display_base, U32 export_type_user_id )
+{
+    ResultsFrameStore frames( *this );
+    const U64 triggerSample = mAnalyzer->GetTriggerSample();
+    const U32 sampleRateHz = mAnalyzer->GetSampleRate();
+
+    // the ends of the range are found by binary search, so only the frames
+    // inside it are visited
+    U64 beginFrame = 0;
+    U64 endFrame = frames.FrameCount();
+    double beginSec, endSec;
+    U64 firstPacket, lastPacket;
+
+    if( ( export_type_user_id == AsyncRgbLedAnalyzerSettings::EXPORT_PIXELS_WINDOW_CSV ) &&
+        ParseExportWindow( mSettings->mExportWindow.c_str(), beginSec, endSec ) )
+    {
+        auto toSample = [triggerSample, sampleRateHz]( double sec ) {
+            return static_cast<U64>( std::max<S64>( 0, static_cast<S64>( triggerSample ) + std::llround( sec * sampleRateHz ) ) );
+        };
 
-        if( UpdateExportProgressAndCheckForCancel( i, num_frames ) == true )
-        {
-            file_stream.close();
-            return;
-        }
+        beginFrame = FindFirstFrameAtOrAfterSample( frames, toSample( beginSec ) );
+        endFrame = FindFirstFrameAtOrAfterSample( frames, toSample( endSec ) + 1 );
+    }
+    else if( ( export_type_user_id == AsyncRgbLedAnalyzerSettings::EXPORT_PIXELS_PACKETS_CSV ) &&
+             ParsePacketRange( mSettings->mExportPackets.c_str(), firstPacket, lastPacket ) )
+    {
+        beginFrame = FindFirstFrameOfPacket( frames, firstPacket );
+        endFrame = FindFirstFrameOfPacket( frames, lastPacket + 1 );
     }
 
-    file_stream.close();
+    ExportPixelsCsv( file, frames, display_base, mSettings->BitSize(), triggerSample, sampleRateHz, beginFrame, endFrame );
 }
 
 void AsyncRgbLedAnalyzerResults::GenerateFrameTabularText( U64 frame_index, DisplayBase display_base )
@@ -119,17 +128,8 @@ void AsyncRgbLedAnalyzerResults::GenerateFrameTabularText( U64 frame_index, Disp
     Frame frame = GetFrame( frame_index );
     ClearTabularText();
 
-    const U32 ledIndex = frame.mData2;
-    const RGBValue rgb = RGBValue::CreateFromU64( frame.mData1 );
-
-    const int colorNumericBufferLength = 8;
-    char redString[ colorNumericBufferLength ], greenString[ colorNumericBufferLength ], blueString[ colorNumericBufferLength ];
-
-    GenerateRGBStrings( rgb, display_base, colorNumericBufferLength, redString, greenString, blueString );
-
-    // target content: [13] 0x1A, 0x2B, 0x3C
     char buf[ 64 ];
-    ::snprintf( buf, 64, "[%d] %s, %s, %s", ledIndex, redString, greenString, blueString );
+    FormatPixelTabularText( frame, display_base, mSettings->BitSize(), sizeof( buf ), buf );
     AddTabularText( buf );
 #endif
 }
@@ -3,8 +3,6 @@
 
 #include <AnalyzerResults.h>
 
-#include "AsyncRgbLedHelpers.h" // for RGBValue
-
 class AsyncRgbLedAnalyzer;
 class AsyncRgbLedAnalyzerSettings;
 
@@ -22,12 +20,12 @@ class AsyncRgbLedAnalyzerResults : public AnalyzerResults
     void GenerateTransactionTabularText( U64 transaction_id, DisplayBase display_base ) override;
 
   protected: // functions
+    /// all pixels, or those in the range of the windowed exports
+    void ExportPixelRange( const char* file, DisplayBase display_base, U32 export_type_user_id );
+
   protected: // vars
     AsyncRgbLedAnalyzerSettings* mSettings = nullptr;
     AsyncRgbLedAnalyzer* mAnalyzer = nullptr;
-
-  private:
-    void GenerateRGBStrings( const RGBValue& rgb, DisplayBase base, size_t bufSize, char* redBuf, char* greenBuff, char* blueBuf );
 };
 
 #endif // ASYNCRGBLED_ANALYZER_RESULTS
@@ -1,19 +1,22 @@
 #include "AsyncRgbLedAnalyzerSettings.h"
 
 #include <cassert>
+#include <string>
 
 #include <AnalyzerHelpers.h>
 
-const char* DEFAULT_CHANNEL_NAME = "Addressable LEDs (Async)";
+#include "AsyncRgbLedEventRules.h"
+#include "AsyncRgbLedResultsText.h" // for ParseExportWindow, ParsePacketRange
 
-double operator"" _ns( unsigned long long x )
-{
-    return x * 1e-9;
-}
+const char* DEFAULT_CHANNEL_NAME = "Addressable LEDs (Async)";
+const char* OUTPUT_CHANNEL_NAME = "Addressable LEDs (Async) DOUT";
 
-double operator"" _us( unsigned long long x )
+namespace
 {
-    return x * 1e-6;
+    bool IsBlank( const std::string& text )
+    {
+        return text.find_first_not_of( " \t" ) == std::string::npos;
+    }
 }
 
 AsyncRgbLedAnalyzerSettings::AsyncRgbLedAnalyzerSettings()
@@ -36,15 +39,220 @@ AsyncRgbLedAnalyzerSettings::AsyncRgbLedAnalyzerSettings()
 
     mControllerInterface->SetNumber( mLEDController );
 
+    mCustomBitSizeInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mCustomBitSizeInterface->SetTitleAndTooltip( "Custom: Bits per Channel", "Bits per color channel of the Custom controller." );
+    mCustomBitSizeInterface->SetMin( 8 );
+    mCustomBitSizeInterface->SetMax( 16 );
+
+    mCustomChannelCountInterface.reset( new AnalyzerSettingInterfaceNumberList() );
+    mCustomChannelCountInterface->SetTitleAndTooltip( "Custom: Channels", "LED channels driven by each Custom controller." );
+    mCustomChannelCountInterface->AddNumber( 3, "3 (RGB)", "One RGB output per controller" );
+    mCustomChannelCountInterface->AddNumber( 9, "9 (3 x RGB)", "Three RGB outputs per controller" );
+
+    mCustomLayoutInterface.reset( new AnalyzerSettingInterfaceNumberList() );
+    mCustomLayoutInterface->SetTitleAndTooltip( "Custom: Color Order", "Order in which the Custom controller receives the color channels." );
+    mCustomLayoutInterface->AddNumber( LAYOUT_RGB, "RGB", "Red, green, blue" );
+    mCustomLayoutInterface->AddNumber( LAYOUT_GRB, "GRB", "Green, red, blue" );
+
+    mCustomResetInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mCustomResetInterface->SetTitleAndTooltip( "Custom: Reset Time (us)", "Minimum low time which latches the data, in microseconds." );
+    mCustomResetInterface->SetMin( 1 );
+    mCustomResetInterface->SetMax( 1000000 );
+
+    mCustomTimingInterface.reset( new AnalyzerSettingInterfaceText() );
+    mCustomTimingInterface->SetTitleAndTooltip( "Custom: Bit Timing (ns)",
+                                                "Minimum/nominal/maximum times in ns for: 0-bit high, 0-bit low, 1-bit high, 1-bit low. "
+                                                "Example: 200/400/550, 700/850/1050, 650/800/1050, 200/450/600" );
+
+    mCustomHighSpeedTimingInterface.reset( new AnalyzerSettingInterfaceText() );
+    mCustomHighSpeedTimingInterface->SetTitleAndTooltip( "Custom: High-Speed Bit Timing (ns)",
+                                                         "As the bit timing, for the high-speed mode. Leave empty if not supported." );
+
+    UpdateCustomInterfacesFromSettings();
+
+    mMeasureTimingMarginsInterface.reset( new AnalyzerSettingInterfaceBool() );
+    mMeasureTimingMarginsInterface->SetTitleAndTooltip(
+        "Timing Margins", "Record every pulse width into histograms, to measure how close the timing is to the controller tolerances." );
+    mMeasureTimingMarginsInterface->SetCheckBoxText( "Measure timing margins" );
+    mMeasureTimingMarginsInterface->SetValue( mMeasureTimingMargins );
+
+    mResultsBudgetInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mResultsBudgetInterface->SetTitleAndTooltip( "Results Budget (MB)",
+                                                 "Memory for pixel results and the LED value change index in long captures. Once half "
+                                                 "of it is used, only the pixels of every Nth packet are kept, with N growing as the "
+                                                 "budget runs out. Packet records are always kept. 0 keeps every pixel." );
+    mResultsBudgetInterface->SetMin( 0 );
+    mResultsBudgetInterface->SetMax( 1048576 );
+    mResultsBudgetInterface->SetInteger( mResultsBudgetMB );
+
+    mLiveDecodingInterface.reset( new AnalyzerSettingInterfaceBool() );
+    mLiveDecodingInterface->SetTitleAndTooltip( "Live Decoding",
+                                                "While capturing, show each pixel as soon as its last bit arrives rather than when "
+                                                "the bit is confirmed, and refresh the results on a short timer. Pixels shown early "
+                                                "are marked provisional." );
+    mLiveDecodingInterface->SetCheckBoxText( "Low-latency live decoding" );
+    mLiveDecodingInterface->SetValue( mLiveDecoding );
+
+    mResultsSidecarPathInterface.reset( new AnalyzerSettingInterfaceText() );
+    mResultsSidecarPathInterface->SetTitleAndTooltip( "Results Sidecar File",
+                                                      "Keep the decoded results in this file, for example next to the saved "
+                                                      "capture. Reopening the capture with the same settings then reads them "
+                                                      "back rather than decoding again. Not used while measuring timing "
+                                                      "margins. Leave empty to not keep them." );
+    mResultsSidecarPathInterface->SetTextType( AnalyzerSettingInterfaceText::FilePath );
+
+    mOutputChannelInterface.reset( new AnalyzerSettingInterfaceChannel() );
+    mOutputChannelInterface->SetTitleAndTooltip( "DOUT Channel",
+                                                 "The data output of the LEDs on the LED channel, if captured. Both are "
+                                                 "decoded, and each packet is checked to be forwarded with the consumed "
+                                                 "pixels removed." );
+    mOutputChannelInterface->SetChannel( mOutputChannel );
+    mOutputChannelInterface->SetSelectionOfNoneIsAllowed( true );
+
+    mConsumedPixelsInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mConsumedPixelsInterface->SetTitleAndTooltip( "DOUT: Pixels Consumed",
+                                                  "Pixels kept by the LEDs between the LED channel and the DOUT channel, "
+                                                  "1 for a single LED." );
+    mConsumedPixelsInterface->SetMin( 0 );
+    mConsumedPixelsInterface->SetMax( 65535 );
+    mConsumedPixelsInterface->SetInteger( mConsumedPixels );
+
+    mEventRulesInterface.reset( new AnalyzerSettingInterfaceText() );
+    mEventRulesInterface->SetTitleAndTooltip( "Event Rules",
+                                              "Conditions to mark with an event record while decoding, separated by "
+                                              "semicolons, for example: led 120 = #ffffff; led * != #000000; "
+                                              "pixels != 300; gap > 20ms. Leave empty for none." );
+
+    mEstimateBitErrorsInterface.reset( new AnalyzerSettingInterfaceBool() );
+    mEstimateBitErrorsInterface->SetTitleAndTooltip( "Bit Error Rate",
+                                                     "Compare each packet with the ones before and after it. Where those "
+                                                     "agree on an LED, its content is static, and any bit that differs "
+                                                     "was received wrong." );
+    mEstimateBitErrorsInterface->SetCheckBoxText( "Estimate the bit error rate from repeated refreshes" );
+    mEstimateBitErrorsInterface->SetValue( mEstimateBitErrors );
+
+    mStripLengthInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mStripLengthInterface->SetTitleAndTooltip( "Strip Length (pixels)",
+                                               "Pixels every packet should carry. Shorter and longer packets are marked "
+                                               "as truncated or overlong. 0 learns the length from the packets." );
+    mStripLengthInterface->SetMin( 0 );
+    mStripLengthInterface->SetMax( PixelFrameData::MAX_LED_INDEX );
+    mStripLengthInterface->SetInteger( mStripLength );
+
+    mExportWindowInterface.reset( new AnalyzerSettingInterfaceText() );
+    mExportWindowInterface->SetTitleAndTooltip( "Export: Time Window (s)",
+                                                "Start and end of the \"Export pixels in the time window\" export, in seconds from "
+                                                "the trigger, for example: -0.05, 0.05. Leave empty for the whole capture." );
+
+    mExportPacketsInterface.reset( new AnalyzerSettingInterfaceText() );
+    mExportPacketsInterface->SetTitleAndTooltip( "Export: Packets",
+                                                 "First and last packet of the \"Export pixels of the packet range\" export, for "
+                                                 "example: 100, 199. Leave empty for the whole capture." );
+
+    mSimulationSeedInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mSimulationSeedInterface->SetTitleAndTooltip( "Simulation Seed", "Seed for the random colors and noise of the simulated data. "
+                                                                      "The same seed always produces the same data." );
+    mSimulationSeedInterface->SetMin( 0 );
+    mSimulationSeedInterface->SetMax( 0x7FFFFFFF );
+
+    mSimulationPixelCountInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mSimulationPixelCountInterface->SetTitleAndTooltip( "Simulation: Pixels per Packet", "Length of the simulated strip." );
+    mSimulationPixelCountInterface->SetMin( 1 );
+    mSimulationPixelCountInterface->SetMax( 100000 );
+
+    mSimulationRefreshRateInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mSimulationRefreshRateInterface->SetTitleAndTooltip( "Simulation: Refresh Rate (Hz)",
+                                                         "Simulated packets per second, or 0 to send them back to back." );
+    mSimulationRefreshRateInterface->SetMin( 0 );
+    mSimulationRefreshRateInterface->SetMax( 100000 );
+
+    mSimulationPatternInterface.reset( new AnalyzerSettingInterfaceNumberList() );
+    mSimulationPatternInterface->SetTitleAndTooltip( "Simulation: Pattern", "Colors of the simulated pixels." );
+    mSimulationPatternInterface->AddNumber( PATTERN_RANDOM, "Random", "New random colors in every packet" );
+    mSimulationPatternInterface->AddNumber( PATTERN_STATIC, "Static", "Random colors, the same in every packet" );
+    mSimulationPatternInterface->AddNumber( PATTERN_GRADIENT_CHASE, "Gradient chase", "A color wheel moving along the strip" );
+    mSimulationPatternInterface->AddNumber( PATTERN_REPLAY, "Replay file", "8-bit RGB triples from the replay file, looped" );
+
+    mSimulationReplayPathInterface.reset( new AnalyzerSettingInterfaceText() );
+    mSimulationReplayPathInterface->SetTitleAndTooltip( "Simulation: Replay File", "Raw file of 8-bit red, green, blue values." );
+    mSimulationReplayPathInterface->SetTextType( AnalyzerSettingInterfaceText::FilePath );
+
+    mSimulationJitterInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mSimulationJitterInterface->SetTitleAndTooltip( "Simulation: Jitter (ns)",
+                                                    "Standard deviation of the Gaussian noise added to each edge position." );
+    mSimulationJitterInterface->SetMin( 0 );
+    mSimulationJitterInterface->SetMax( 10000 );
+
+    mSimulationGlitchRateInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mSimulationGlitchRateInterface->SetTitleAndTooltip( "Simulation: Glitches per Million Bits",
+                                                        "Short spikes injected into the low period of random bits." );
+    mSimulationGlitchRateInterface->SetMin( 0 );
+    mSimulationGlitchRateInterface->SetMax( 1000000 );
+
+    mSimulationDroppedBitRateInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mSimulationDroppedBitRateInterface->SetTitleAndTooltip( "Simulation: Dropped Bits per Million", "Random bits left out of the data." );
+    mSimulationDroppedBitRateInterface->SetMin( 0 );
+    mSimulationDroppedBitRateInterface->SetMax( 1000000 );
+
+    mSimulationTruthPathInterface.reset( new AnalyzerSettingInterfaceText() );
+    mSimulationTruthPathInterface->SetTitleAndTooltip( "Simulation: Ground Truth File",
+                                                       "Record the simulated pixels here, in the binary pixel format of the "
+                                                       "command-line decoder. Leave empty to not record them." );
+    mSimulationTruthPathInterface->SetTextType( AnalyzerSettingInterfaceText::FilePath );
+
+    UpdateSimulationInterfacesFromSettings();
+
     AddInterface( mInputChannelInterface.get() );
     AddInterface( mControllerInterface.get() );
-
-    AddExportOption( 0, "Export as text/csv file" );
-    AddExportExtension( 0, "text", "txt" );
-    AddExportExtension( 0, "csv", "csv" );
+    AddInterface( mCustomBitSizeInterface.get() );
+    AddInterface( mCustomChannelCountInterface.get() );
+    AddInterface( mCustomLayoutInterface.get() );
+    AddInterface( mCustomResetInterface.get() );
+    AddInterface( mCustomTimingInterface.get() );
+    AddInterface( mCustomHighSpeedTimingInterface.get() );
+    AddInterface( mMeasureTimingMarginsInterface.get() );
+    AddInterface( mResultsBudgetInterface.get() );
+    AddInterface( mLiveDecodingInterface.get() );
+    AddInterface( mResultsSidecarPathInterface.get() );
+    AddInterface( mOutputChannelInterface.get() );
+    AddInterface( mConsumedPixelsInterface.get() );
+    AddInterface( mEventRulesInterface.get() );
+    AddInterface( mEstimateBitErrorsInterface.get() );
+    AddInterface( mStripLengthInterface.get() );
+    AddInterface( mExportWindowInterface.get() );
+    AddInterface( mExportPacketsInterface.get() );
+    AddInterface( mSimulationSeedInterface.get() );
+    AddInterface( mSimulationPixelCountInterface.get() );
+    AddInterface( mSimulationRefreshRateInterface.get() );
+    AddInterface( mSimulationPatternInterface.get() );
+    AddInterface( mSimulationReplayPathInterface.get() );
+    AddInterface( mSimulationJitterInterface.get() );
+    AddInterface( mSimulationGlitchRateInterface.get() );
+    AddInterface( mSimulationDroppedBitRateInterface.get() );
+    AddInterface( mSimulationTruthPathInterface.get() );
+
+    AddExportOption( EXPORT_PIXELS_CSV, "Export as text/csv file" );
+    AddExportExtension( EXPORT_PIXELS_CSV, "text", "txt" );
+    AddExportExtension( EXPORT_PIXELS_CSV, "csv", "csv" );
+
+    AddExportOption( EXPORT_TIMING_MARGINS_CSV, "Export timing margin histograms" );
+    AddExportExtension( EXPORT_TIMING_MARGINS_CSV, "csv", "csv" );
+
+    AddExportOption( EXPORT_LED_CHANGES_CSV, "Export LED value changes" );
+    AddExportExtension( EXPORT_LED_CHANGES_CSV, "csv", "csv" );
+
+    AddExportOption( EXPORT_PIXELS_WINDOW_CSV, "Export pixels in the time window" );
+    AddExportExtension( EXPORT_PIXELS_WINDOW_CSV, "csv", "csv" );
+
+    AddExportOption( EXPORT_PIXELS_PACKETS_CSV, "Export pixels of the packet range" );
+    AddExportExtension( EXPORT_PIXELS_PACKETS_CSV, "csv", "csv" );
+
+    AddExportOption( EXPORT_BIT_ERRORS_CSV, "Export bit error counts" );
+    AddExportExtension( EXPORT_BIT_ERRORS_CSV, "csv", "csv" );
 
     ClearChannels();
     AddChannel( mInputChannel, DEFAULT_CHANNEL_NAME, false );
+    AddChannel( mOutputChannel, OUTPUT_CHANNEL_NAME, false );
 }
 
 AsyncRgbLedAnalyzerSettings::~AsyncRgbLedAnalyzerSettings()
@@ -54,141 +262,198 @@ AsyncRgbLedAnalyzerSettings::~AsyncRgbLedAnalyzerSettings()
 void AsyncRgbLedAnalyzerSettings::InitControllerData()
 {
     // order of values here must correspond to the Controller enum
-    mControllers = {
-        // name, description, bits per channel, channels per frame, reset time nsec, low-speed data nsec, has high speed, high speed data
-        // nsec, color layout
-
-        // https://cdn-shop.adafruit.com/datasheets/WS2811.pdf
-        { "WS2811",
-          "Worldsemi 24-bit RGB controller",
-          8,
-          3,
-          { 50_us, 50_us, 50_us },
-          {
-              // low-speed times
-              { { 350_ns, 500_ns, 650_ns }, { 1850_ns, 2000_ns, 2150_ns } },    // 0-bit times
-              { { 1050_ns, 1200_ns, 1350_ns }, { 1150_ns, 1300_ns, 1450_ns } }, // 1-bit times
-          },
-          true,
-          {
-              // high-speed times
-              { { 175_ns, 250_ns, 325_ns }, { 925_ns, 1000_ns, 1075_ns } }, // 0-bit times
-              { { 525_ns, 600_ns, 675_ns }, { 1225_ns, 1300_ns, 1375_ns } } // 1-bit times
-          },
-          LAYOUT_RGB },
-        // https://cdn-shop.adafruit.com/datasheets/WS2812B.pdf
-        // http://www.seeedstudio.com/document/pdf/WS2812B%20Datasheet.pdf
-        { "WS2812B",
-          "Worldsemi 24-bit RGB integrated light-source",
-          8,
-          3,
-          { 50_us, 50_us, 50_us },
-          {
-              // low-speed times
-              { { 200_ns, 400_ns, 550_ns }, { 700_ns, 850_ns, 1050_ns } }, // 0-bit times
-              { { 650_ns, 800_ns, 1050_ns }, { 200_ns, 450_ns, 600_ns } }, // 1-bit times
-          },
-          false,
-          { {}, {} },
-          LAYOUT_GRB },
-
-        // http://www.led-color.com/upload/201609/WS2813%20LED.pdf
-        { "WS2813",
-          "Worldsemi 24-bit RGB integrated light-source",
-          8,
-          3,
-          { 50_us, 50_us, 50_us },
-          {
-              // low-speed times
-              { { 300_ns, 375_ns, 450_ns }, { 300_ns, 875_ns, 100_us } },  // 0-bit times
-              { { 750_ns, 875_ns, 1000_ns }, { 300_ns, 375_ns, 100_us } }, // 1-bit times
-          },
-          false,
-          { {}, {} },
-          LAYOUT_GRB },
-
-        // https://www.deskontrol.net/descargas/datasheets/TM1809.pdf
-        { "TM1809",
-          "Titan Micro 9-chanel 24-bit RGB controller",
-          8,
-          9,
-          { 24_us, 24_us, 1.0 },
-          {
-              // low-speed times
-              { { 450_ns, 600_ns, 750_ns }, { 1050_ns, 1200_ns, 1350_ns } }, // 0-bit times
-              { { 1050_ns, 1200_ns, 1350_ns }, { 450_ns, 600_ns, 750_ns } }, // 1-bit times
-          },
-          true,
-          {
-              // high-speed times
-              { { 250_ns, 320_ns, 390_ns }, { 530_ns, 600_ns, 670_ns } }, // 0-bit times
-              { { 530_ns, 600_ns, 670_ns }, { 250_ns, 320_ns, 390_ns } }  // 1-bit times
-          },
-          LAYOUT_RGB },
-
-        // https://www.deskontrol.net/descargas/datasheets/TM1804.pdf
-        { "TM1804",
-          "Titan Micro 24-bit RGB controller",
-          8,
-          3,
-          { 10_us, 10_us, 1.0 },
-          {
-              // low-speed times
-              { { 850_ns, 1_us, 1150_ns }, { 1850_ns, 2_us, 2150_ns } }, // 0-bit times
-              { { 1850_ns, 2_us, 2150_ns }, { 850_ns, 1_us, 1150_ns } }, // 1-bit times
-          },
-          false,
-          { {}, {} },
-          LAYOUT_RGB },
-
-        // http://www.bestlightingbuy.com/pdf/UCS1903%20datasheet.pdf
-        { "UCS1903",
-          "UCS1903 24-bit RGB controller",
-          8,
-          3,
-          { 24_us, 24_us, 1.0 },
-          {
-              // low-speed times
-              { { 350_ns, 500_ns, 650_ns }, { 1850_ns, 2000_ns, 2150_ns } }, // 0-bit times
-              { { 1850_ns, 2000_ns, 2150_ns }, { 350_ns, 500_ns, 650_ns } }, // 1-bit times
-          },
-          true,
-          {
-              // high-speed times
-              { { 175_ns, 250_ns, 325_ns }, { 925_ns, 1000_ns, 1075_ns } }, // 0-bit times
-              { { 925_ns, 1000_ns, 1075_ns }, { 175_ns, 250_ns, 325_ns } }  // 1-bit times
-          },
-          LAYOUT_RGB },
-
-        // https://www.syncrolight.co.uk/datasheets/LPD1886%20datasheet.pdf
-        { "LPD1886 - 24 bit",
-          "LPD1886 RGB controller in 24-bit mode",
-          8,
-          3,
-          { 24_us, 30_us, 1.0 },
-          {
-              // low-speed times
-              { { 150_ns, 200_ns, 280_ns }, { 500_ns, 600_ns, 10_us } }, // 0-bit times
-              { { 450_ns, 600_ns, 9_us }, { 150_ns, 200_ns, 10_us } },   // 1-bit times
-          },
-          false,
-          { {}, {} },
-          LAYOUT_RGB },
-
-        { "LPD1886 - 36 bit",
-          "LPD1886 RGB controller in 36-bit mode",
-          12,
-          3,
-          { 24_us, 30_us, 1.0 },
-          {
-              // low-speed times
-              { { 150_ns, 200_ns, 280_ns }, { 500_ns, 600_ns, 10_us } }, // 0-bit times
-              { { 450_ns, 600_ns, 9_us }, { 150_ns, 200_ns, 10_us } },   // 1-bit times
-          },
-          false,
-          { {}, {} },
-          LAYOUT_RGB },
-    };
+    mControllers = CreateControllerData();
+}
+
+void AsyncRgbLedAnalyzerSettings::UpdateCustomInterfacesFromSettings()
+{
+    const LedControllerData& custom = mControllers.at( LED_CUSTOM );
+    mCustomBitSizeInterface->SetInteger( custom.mBitsPerChannel );
+    mCustomChannelCountInterface->SetNumber( custom.mChannelCount );
+    mCustomLayoutInterface->SetNumber( custom.mLayout );
+    mCustomResetInterface->SetInteger( static_cast<int>( custom.mResetTiming.mMinimumSec * 1e6 + 0.5 ) );
+    mCustomTimingInterface->SetText( FormatBitTimings( custom.mDataTiming ).c_str() );
+    mCustomHighSpeedTimingInterface->SetText( custom.mHasHighSpeed ? FormatBitTimings( custom.mDataTimingHighSpeed ).c_str() : "" );
+}
+
+bool AsyncRgbLedAnalyzerSettings::SetCustomControllerFromInterfaces()
+{
+    LedControllerData custom = mControllers.at( LED_CUSTOM );
+
+    if( !ParseBitTimings( mCustomTimingInterface->GetText(), custom.mDataTiming ) )
+    {
+        SetErrorText( "Custom bit timing must be four min/nominal/max windows in ns, "
+                      "for example: 200/400/550, 700/850/1050, 650/800/1050, 200/450/600" );
+        return false;
+    }
+
+    const std::string highSpeedText = mCustomHighSpeedTimingInterface->GetText();
+    custom.mHasHighSpeed = !IsBlank( highSpeedText );
+
+    if( custom.mHasHighSpeed && !ParseBitTimings( highSpeedText.c_str(), custom.mDataTimingHighSpeed ) )
+    {
+        SetErrorText( "Custom high-speed bit timing must be empty, or four min/nominal/max windows in ns" );
+        return false;
+    }
+
+    const double resetSec = mCustomResetInterface->GetInteger() * 1e-6;
+    custom.mResetTiming = TimingTolerance( resetSec, resetSec, 1.0 );
+    custom.mBitsPerChannel = static_cast<U8>( mCustomBitSizeInterface->GetInteger() );
+    custom.mChannelCount = static_cast<U8>( mCustomChannelCountInterface->GetNumber() );
+    custom.mLayout = static_cast<ColorLayout>( static_cast<int>( mCustomLayoutInterface->GetNumber() ) );
+
+    mControllers.at( LED_CUSTOM ) = custom;
+    return true;
+}
+
+void AsyncRgbLedAnalyzerSettings::SaveCustomController( SimpleArchive& archive ) const
+{
+    const LedControllerData& custom = mControllers.at( LED_CUSTOM );
+    archive << U32( custom.mBitsPerChannel );
+    archive << U32( custom.mChannelCount );
+    archive << U32( custom.mLayout );
+    archive << custom.mResetTiming.mMinimumSec;
+    archive << custom.mHasHighSpeed;
+
+    for( const BitTiming* timing : { custom.mDataTiming, custom.mDataTimingHighSpeed } )
+    {
+        for( const auto b : { BIT_LOW, BIT_HIGH } )
+        {
+            for( const TimingTolerance* t : { &timing[ b ].mPositiveTiming, &timing[ b ].mNegativeTiming } )
+            {
+                archive << t->mMinimumSec;
+                archive << t->mNominalSec;
+                archive << t->mMaximumSec;
+            }
+        }
+    }
+}
+
+bool AsyncRgbLedAnalyzerSettings::LoadCustomController( SimpleArchive& archive )
+{
+    LedControllerData custom = mControllers.at( LED_CUSTOM );
+    U32 bitsPerChannel, channelCount, layout;
+    double resetSec;
+
+    if( !( archive >> bitsPerChannel ) || !( archive >> channelCount ) || !( archive >> layout ) || !( archive >> resetSec ) ||
+        !( archive >> custom.mHasHighSpeed ) )
+    {
+        return false;
+    }
+
+    for( BitTiming* timing : { custom.mDataTiming, custom.mDataTimingHighSpeed } )
+    {
+        for( const auto b : { BIT_LOW, BIT_HIGH } )
+        {
+            for( TimingTolerance* t : { &timing[ b ].mPositiveTiming, &timing[ b ].mNegativeTiming } )
+            {
+                if( !( archive >> t->mMinimumSec ) || !( archive >> t->mNominalSec ) || !( archive >> t->mMaximumSec ) )
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    custom.mBitsPerChannel = static_cast<U8>( bitsPerChannel );
+    custom.mChannelCount = static_cast<U8>( channelCount );
+    custom.mLayout = static_cast<ColorLayout>( layout );
+    custom.mResetTiming = TimingTolerance( resetSec, resetSec, 1.0 );
+
+    mControllers.at( LED_CUSTOM ) = custom;
+    return true;
+}
+
+void AsyncRgbLedAnalyzerSettings::UpdateSimulationInterfacesFromSettings()
+{
+    mSimulationSeedInterface->SetInteger( static_cast<int>( mSimulation.mSeed ) );
+    mSimulationPixelCountInterface->SetInteger( static_cast<int>( mSimulation.mPixelCount ) );
+    mSimulationRefreshRateInterface->SetInteger( static_cast<int>( mSimulation.mRefreshRateHz ) );
+    mSimulationPatternInterface->SetNumber( mSimulation.mPattern );
+    mSimulationReplayPathInterface->SetText( mSimulation.mReplayPath.c_str() );
+    mSimulationJitterInterface->SetInteger( static_cast<int>( mSimulation.mJitterSec * 1e9 + 0.5 ) );
+    mSimulationGlitchRateInterface->SetInteger( static_cast<int>( mSimulation.mGlitchProbability * 1e6 + 0.5 ) );
+    mSimulationDroppedBitRateInterface->SetInteger( static_cast<int>( mSimulation.mDroppedBitProbability * 1e6 + 0.5 ) );
+    mSimulationTruthPathInterface->SetText( mSimulationTruthPath.c_str() );
+}
+
+bool AsyncRgbLedAnalyzerSettings::SetSimulationFromInterfaces()
+{
+    SimulationScenario simulation = mSimulation;
+    simulation.mSeed = static_cast<U32>( mSimulationSeedInterface->GetInteger() );
+    simulation.mPixelCount = static_cast<U32>( mSimulationPixelCountInterface->GetInteger() );
+    simulation.mRefreshRateHz = mSimulationRefreshRateInterface->GetInteger();
+    // explicit cast to keep MSVC happy
+    simulation.mPattern = static_cast<SimulationPattern>( static_cast<int>( mSimulationPatternInterface->GetNumber() ) );
+    simulation.mReplayPath = mSimulationReplayPathInterface->GetText();
+    simulation.mJitterSec = mSimulationJitterInterface->GetInteger() * 1e-9;
+    simulation.mGlitchProbability = mSimulationGlitchRateInterface->GetInteger() * 1e-6;
+    simulation.mDroppedBitProbability = mSimulationDroppedBitRateInterface->GetInteger() * 1e-6;
+
+    if( ( simulation.mPattern == PATTERN_REPLAY ) && simulation.mReplayPath.empty() )
+    {
+        SetErrorText( "Please choose a replay file for the simulation, or another pattern" );
+        return false;
+    }
+
+    mSimulation = simulation;
+    mSimulationTruthPath = mSimulationTruthPathInterface->GetText();
+    return true;
+}
+
+void AsyncRgbLedAnalyzerSettings::SaveSimulation( SimpleArchive& archive ) const
+{
+    archive << mSimulation.mSeed;
+    archive << mSimulation.mPixelCount;
+    archive << mSimulation.mRefreshRateHz;
+    archive << U32( mSimulation.mPattern );
+    archive << mSimulation.mReplayPath.c_str();
+    archive << mSimulation.mJitterSec;
+    archive << mSimulation.mGlitchProbability;
+    archive << mSimulation.mDroppedBitProbability;
+    archive << mSimulationTruthPath.c_str();
+}
+
+bool AsyncRgbLedAnalyzerSettings::LoadSimulation( SimpleArchive& archive )
+{
+    // the seed was the only simulation setting at first
+    if( !( archive >> mSimulation.mSeed ) )
+    {
+        return false;
+    }
+
+    SimulationScenario simulation = mSimulation;
+    U32 pattern;
+    const char* replayPath;
+    const char* truthPath;
+
+    if( !( archive >> simulation.mPixelCount ) || !( archive >> simulation.mRefreshRateHz ) || !( archive >> pattern ) ||
+        !( archive >> replayPath ) || !( archive >> simulation.mJitterSec ) || !( archive >> simulation.mGlitchProbability ) ||
+        !( archive >> simulation.mDroppedBitProbability ) || !( archive >> truthPath ) )
+    {
+        return false;
+    }
+
+    simulation.mPattern = static_cast<SimulationPattern>( pattern );
+    simulation.mReplayPath = replayPath;
+    mSimulation = simulation;
+    mSimulationTruthPath = truthPath;
+    return true;
+}
+
+bool AsyncRgbLedAnalyzerSettings::LoadExportRanges( SimpleArchive& archive )
+{
+    const char* exportWindow;
+    const char* exportPackets;
+
+    if( !( archive >> exportWindow ) || !( archive >> exportPackets ) )
+    {
+        return false;
+    }
+
+    mExportWindow = exportWindow;
+    mExportPackets = exportPackets;
+    return true;
 }
 
 bool AsyncRgbLedAnalyzerSettings::SetSettingsFromInterfaces()
@@ -197,9 +462,70 @@ bool AsyncRgbLedAnalyzerSettings::SetSettingsFromInterfaces()
     // explicit cast to keep MSVC happy
     const int index = static_cast<int>( mControllerInterface->GetNumber() );
     mLEDController = static_cast<Controller>( index );
+    mMeasureTimingMargins = mMeasureTimingMarginsInterface->GetValue();
+    mResultsBudgetMB = static_cast<U32>( mResultsBudgetInterface->GetInteger() );
+    mLiveDecoding = mLiveDecodingInterface->GetValue();
+    mResultsSidecarPath = mResultsSidecarPathInterface->GetText();
 
-    ClearChannels();
-    AddChannel( mInputChannel, DEFAULT_CHANNEL_NAME, true );
+    const Channel outputChannel = mOutputChannelInterface->GetChannel();
+
+    if( ( outputChannel != UNDEFINED_CHANNEL ) && ( outputChannel == mInputChannel ) )
+    {
+        SetErrorText( "The DOUT channel must be another channel than the LED channel" );
+        return false;
+    }
+
+    mOutputChannel = outputChannel;
+    mConsumedPixels = static_cast<U32>( mConsumedPixelsInterface->GetInteger() );
+
+    const std::string eventRules = mEventRulesInterface->GetText();
+    EventRuleSet rules;
+    std::string badRule;
+
+    if( !rules.Parse( eventRules, badRule ) )
+    {
+        const std::string error = "This event rule isn't understood: " + badRule +
+                                  ". Rules look like: led 120 = #ffffff; led * != #000000; pixels != 300; gap > 20ms";
+        SetErrorText( error.c_str() );
+        return false;
+    }
+
+    mEventRules = eventRules;
+    mEstimateBitErrors = mEstimateBitErrorsInterface->GetValue();
+    mStripLength = static_cast<U32>( mStripLengthInterface->GetInteger() );
+
+    const std::string exportWindow = mExportWindowInterface->GetText();
+    const std::string exportPackets = mExportPacketsInterface->GetText();
+    double beginSec, endSec;
+    U64 firstPacket, lastPacket;
+
+    if( !IsBlank( exportWindow ) && !ParseExportWindow( exportWindow.c_str(), beginSec, endSec ) )
+    {
+        SetErrorText( "The export time window must be empty, or a start and end in seconds, for example: -0.05, 0.05" );
+        return false;
+    }
+
+    if( !IsBlank( exportPackets ) && !ParsePacketRange( exportPackets.c_str(), firstPacket, lastPacket ) )
+    {
+        SetErrorText( "The export packets must be empty, or the first and last packet number, for example: 100, 199" );
+        return false;
+    }
+
+    mExportWindow = exportWindow;
+    mExportPackets = exportPackets;
+
+    // only insist on valid custom timing when it's going to be used
+    if( !SetCustomControllerFromInterfaces() && ( mLEDController == LED_CUSTOM ) )
+    {
+        return false;
+    }
+
+    if( !SetSimulationFromInterfaces() )
+    {
+        return false;
+    }
+
+    UpdateChannels();
 
     return true;
 }
@@ -208,6 +534,19 @@ void AsyncRgbLedAnalyzerSettings::UpdateInterfacesFromSettings()
 {
     mInputChannelInterface->SetChannel( mInputChannel );
     mControllerInterface->SetNumber( mLEDController );
+    mMeasureTimingMarginsInterface->SetValue( mMeasureTimingMargins );
+    mResultsBudgetInterface->SetInteger( mResultsBudgetMB );
+    mLiveDecodingInterface->SetValue( mLiveDecoding );
+    mResultsSidecarPathInterface->SetText( mResultsSidecarPath.c_str() );
+    mOutputChannelInterface->SetChannel( mOutputChannel );
+    mConsumedPixelsInterface->SetInteger( mConsumedPixels );
+    mEventRulesInterface->SetText( mEventRules.c_str() );
+    mEstimateBitErrorsInterface->SetValue( mEstimateBitErrors );
+    mStripLengthInterface->SetInteger( mStripLength );
+    mExportWindowInterface->SetText( mExportWindow.c_str() );
+    mExportPacketsInterface->SetText( mExportPackets.c_str() );
+    UpdateCustomInterfacesFromSettings();
+    UpdateSimulationInterfacesFromSettings();
 }
 
 void AsyncRgbLedAnalyzerSettings::LoadSettings( const char* settings )
@@ -220,9 +559,38 @@ void AsyncRgbLedAnalyzerSettings::LoadSettings( const char* settings )
     text_archive >> controllerInt;
     mLEDController = static_cast<Controller>( controllerInt );
 
-    ClearChannels();
-    AddChannel( mInputChannel, DEFAULT_CHANNEL_NAME, true );
+    // settings saved by older versions end early, anything missing keeps
+    // its default value
+    bool more = ( text_archive >> mMeasureTimingMargins );
+    more = more && LoadCustomController( text_archive );
+    more = more && LoadSimulation( text_archive );
+    more = more && ( text_archive >> mResultsBudgetMB );
+    more = more && LoadExportRanges( text_archive );
+    more = more && ( text_archive >> mLiveDecoding );
+
+    const char* sidecarPath;
+    more = more && ( text_archive >> sidecarPath );
+
+    if( more )
+    {
+        mResultsSidecarPath = sidecarPath;
+    }
+
+    more = more && ( text_archive >> mOutputChannel );
+    more = more && ( text_archive >> mConsumedPixels );
+
+    const char* eventRules;
+    more = more && ( text_archive >> eventRules );
 
+    if( more )
+    {
+        mEventRules = eventRules;
+    }
+
+    more = more && ( text_archive >> mEstimateBitErrors );
+    more = more && ( text_archive >> mStripLength );
+
+    UpdateChannels();
     UpdateInterfacesFromSettings();
 }
 
@@ -232,10 +600,30 @@ const char* AsyncRgbLedAnalyzerSettings::SaveSettings()
 
     text_archive << mInputChannel;
     text_archive << mLEDController;
+    text_archive << mMeasureTimingMargins;
+    SaveCustomController( text_archive );
+    SaveSimulation( text_archive );
+    text_archive << mResultsBudgetMB;
+    text_archive << mExportWindow.c_str();
+    text_archive << mExportPackets.c_str();
+    text_archive << mLiveDecoding;
+    text_archive << mResultsSidecarPath.c_str();
+    text_archive << mOutputChannel;
+    text_archive << mConsumedPixels;
+    text_archive << mEventRules.c_str();
+    text_archive << mEstimateBitErrors;
+    text_archive << mStripLength;
 
     return SetReturnString( text_archive.GetString() );
 }
 
+void AsyncRgbLedAnalyzerSettings::UpdateChannels()
+{
+    ClearChannels();
+    AddChannel( mInputChannel, DEFAULT_CHANNEL_NAME, true );
+    AddChannel( mOutputChannel, OUTPUT_CHANNEL_NAME, mOutputChannel != UNDEFINED_CHANNEL );
+}
+
 U8 AsyncRgbLedAnalyzerSettings::BitSize() const
 {
     return mControllers.at( mLEDController ).mBitsPerChannel;
@@ -268,3 +656,13 @@ ColorLayout AsyncRgbLedAnalyzerSettings::GetColorLayout() const
 {
     return mControllers.at( mLEDController ).mLayout;
 }
+
+const LedControllerData& AsyncRgbLedAnalyzerSettings::SelectedController() const
+{
+    return mControllers.at( mLEDController );
+}
+
+ControllerTimingTable AsyncRgbLedAnalyzerSettings::BuildTimingTable( double sampleRateHz ) const
+{
+    return BuildControllerTimingTable( mControllers.at( mLEDController ), sampleRateHz );
+}
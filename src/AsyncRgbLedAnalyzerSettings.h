@@ -6,7 +6,11 @@
 #include <AnalyzerSettings.h>
 #include <AnalyzerTypes.h>
 
+#include "AsyncRgbLedControllers.h"
 #include "AsyncRgbLedHelpers.h"
+#include "AsyncRgbLedSimulationScenario.h"
+
+class SimpleArchive;
 
 class AsyncRgbLedAnalyzerSettings : public AnalyzerSettings
 {
@@ -35,12 +39,65 @@ class AsyncRgbLedAnalyzerSettings : public AnalyzerSettings
         LED_TM1804,
         LED_UCS1903,
         LED_LPD1886_8bit,
-        LED_LPD1886_12bit
+        LED_LPD1886_12bit,
+        LED_CUSTOM // timing entered in the settings, must stay last
     };
 
     Controller mLEDController = LED_WS2811;
     Channel mInputChannel = UNDEFINED_CHANNEL;
 
+    /// record every measured pulse width into margin histograms
+    bool mMeasureTimingMargins = false;
+
+    /// memory for pixel frames before they are decimated, zero for no limit
+    U32 mResultsBudgetMB = 0;
+
+    /// show pixels while a capture is running with as little delay as possible
+    bool mLiveDecoding = false;
+
+    /// where decoded results are kept for reopening the capture, see
+    /// ResultsSidecarReader. Empty for nowhere.
+    std::string mResultsSidecarPath;
+
+    /// the data output of the first LED, decoded alongside the input to check
+    /// what it forwards. UNDEFINED_CHANNEL when not captured.
+    Channel mOutputChannel = UNDEFINED_CHANNEL;
+
+    /// pixels the LEDs between the two channels keep for themselves
+    U32 mConsumedPixels = 1;
+
+    /// conditions marked with an "event" record when met, see EventRuleSet.
+    /// Empty for none.
+    std::string mEventRules;
+
+    /// compare refreshes of static content to estimate the bit error rate
+    bool mEstimateBitErrors = false;
+
+    /// pixels every packet should carry, see StripLengthModel. Zero learns
+    /// the length from the first packets.
+    U32 mStripLength = 0;
+
+    /// what the windowed pixel exports cover, see ParseExportWindow and
+    /// ParsePacketRange. Empty for the whole capture.
+    std::string mExportWindow;
+    std::string mExportPackets;
+
+    /// what the simulation data generator produces
+    SimulationScenario mSimulation;
+
+    /// where the simulation writes the transmitted pixels, empty for nowhere
+    std::string mSimulationTruthPath;
+
+    enum ExportType
+    {
+        EXPORT_PIXELS_CSV = 0,
+        EXPORT_TIMING_MARGINS_CSV,
+        EXPORT_LED_CHANGES_CSV,
+        EXPORT_PIXELS_WINDOW_CSV,
+        EXPORT_PIXELS_PACKETS_CSV,
+        EXPORT_BIT_ERRORS_CSV
+    };
+
     /// bits ber LED channel, either 8 or 12 at present
     U8 BitSize() const;
 
@@ -55,29 +112,53 @@ class AsyncRgbLedAnalyzerSettings : public AnalyzerSettings
 
     ColorLayout GetColorLayout() const;
 
+    const LedControllerData& SelectedController() const;
+
+    /// timing of the selected controller in whole samples at the given rate
+    ControllerTimingTable BuildTimingTable( double sampleRateHz ) const;
+
   protected:
     void InitControllerData();
+    void UpdateCustomInterfacesFromSettings();
+    bool SetCustomControllerFromInterfaces();
+    void SaveCustomController( SimpleArchive& archive ) const;
+    bool LoadCustomController( SimpleArchive& archive );
+    void UpdateSimulationInterfacesFromSettings();
+    bool SetSimulationFromInterfaces();
+    void SaveSimulation( SimpleArchive& archive ) const;
+    bool LoadSimulation( SimpleArchive& archive );
+    bool LoadExportRanges( SimpleArchive& archive );
+    void UpdateChannels();
 
     std::unique_ptr<AnalyzerSettingInterfaceChannel> mInputChannelInterface;
     std::unique_ptr<AnalyzerSettingInterfaceNumberList> mControllerInterface;
-
-    // we can't do direct defualt initialisation here, since according to C++11
-    // that makes this type non-POD and hence unsuitable for direct initialisation.
-    // C++14 fixes this.
-    struct LedControllerData
-    {
-        std::string mName;
-        std::string mDescription;
-        U8 mBitsPerChannel; // = 8;
-        U8 mChannelCount;   // = 3;
-        TimingTolerance mResetTiming;
-        BitTiming mDataTiming[ 2 ]; // BIT_HIGH and BIT_LOW
-
-        bool mHasHighSpeed;                  // = true
-        BitTiming mDataTimingHighSpeed[ 2 ]; // BIT_HIGH and BIT_LOW
-
-        ColorLayout mLayout; // = LAYOUT_RGB
-    };
+    std::unique_ptr<AnalyzerSettingInterfaceBool> mMeasureTimingMarginsInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceInteger> mResultsBudgetInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceBool> mLiveDecodingInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceText> mResultsSidecarPathInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceChannel> mOutputChannelInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceInteger> mConsumedPixelsInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceText> mEventRulesInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceBool> mEstimateBitErrorsInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceInteger> mStripLengthInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceText> mExportWindowInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceText> mExportPacketsInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceInteger> mSimulationSeedInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceInteger> mSimulationPixelCountInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceInteger> mSimulationRefreshRateInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceNumberList> mSimulationPatternInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceText> mSimulationReplayPathInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceInteger> mSimulationJitterInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceInteger> mSimulationGlitchRateInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceInteger> mSimulationDroppedBitRateInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceText> mSimulationTruthPathInterface;
+
+    std::unique_ptr<AnalyzerSettingInterfaceInteger> mCustomBitSizeInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceNumberList> mCustomChannelCountInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceNumberList> mCustomLayoutInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceInteger> mCustomResetInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceText> mCustomTimingInterface;
+    std::unique_ptr<AnalyzerSettingInterfaceText> mCustomHighSpeedTimingInterface;
 
     std::vector<LedControllerData> mControllers;
 };
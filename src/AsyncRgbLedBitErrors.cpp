@@ -0,0 +1,187 @@
+#include "AsyncRgbLedBitErrors.h"
+
+#include <algorithm> // for std::min, std::fill, std::partial_sort
+
+namespace
+{
+    U32 PopCount( U64 x )
+    {
+#if defined( __GNUC__ )
+        return static_cast<U32>( __builtin_popcountll( x ) );
+#else
+        // the usual SWAR count, which doesn't need the POPCNT instruction
+        x = x - ( ( x >> 1 ) & 0x5555555555555555ull );
+        x = ( x & 0x3333333333333333ull ) + ( ( x >> 2 ) & 0x3333333333333333ull );
+        x = ( x + ( x >> 4 ) ) & 0x0F0F0F0F0F0F0F0Full;
+        return static_cast<U32>( ( x * 0x0101010101010101ull ) >> 56 );
+#endif
+    }
+}
+
+void BitErrorEstimator::Configure( U8 bitSize )
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    for( PacketWords& packet : mPackets )
+    {
+        packet.mWords.clear();
+        packet.mIsValid = false;
+    }
+
+    const U64 channelMask = ( U64( 1 ) << bitSize ) - 1;
+    mChannelMask = channelMask | ( channelMask << 16 ) | ( channelMask << 32 );
+    mBitsPerPixel = 3 * bitSize;
+
+    mLedPackets.clear();
+    mLedFlippedBits.clear();
+    std::fill( mPositionFlippedBits, mPositionFlippedBits + BIT_POSITION_COUNT, 0 );
+    mPositionComparedWords = 0;
+    mTotal = BitErrorCount();
+}
+
+void BitErrorEstimator::Reserve( U32 pixels )
+{
+    for( PacketWords& packet : mPackets )
+    {
+        packet.mWords.reserve( pixels );
+    }
+}
+
+PacketBitErrors BitErrorEstimator::EndPacket( U64 beginSample )
+{
+    PacketBitErrors result;
+
+    PacketWords& current = mPackets[ CURRENT ];
+    current.mBeginSample = beginSample;
+    current.mIsValid = true;
+
+    const PacketWords& before = mPackets[ OLDEST ];
+    const PacketWords& judged = mPackets[ JUDGED ];
+
+    if( before.mIsValid && judged.mIsValid )
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+
+        const size_t count = std::min( std::min( before.mWords.size(), judged.mWords.size() ), current.mWords.size() );
+
+        if( mLedPackets.size() < count )
+        {
+            mLedPackets.resize( count, 0 );
+            mLedFlippedBits.resize( count, 0 );
+        }
+
+        U64 comparedLeds = 0;
+
+        for( size_t i = 0; i < count; ++i )
+        {
+            // the majority of the three, where the outer two agree
+            const U64 reference = before.mWords[ i ];
+
+            if( reference != current.mWords[ i ] )
+            {
+                continue;
+            }
+
+            ++comparedLeds;
+            ++mLedPackets[ i ];
+
+            const U64 flipped = ( reference ^ judged.mWords[ i ] ) & mChannelMask;
+
+            if( !flipped )
+            {
+                continue;
+            }
+
+            const U32 flippedBits = PopCount( flipped );
+            mLedFlippedBits[ i ] += flippedBits;
+            result.mFlippedBits += flippedBits;
+
+            if( result.mFlippedLeds++ == 0 )
+            {
+                result.mFirstFlippedLed = static_cast<U32>( i );
+            }
+
+            // the position of each set bit is the count of the bits below it
+            for( U64 bits = flipped; bits; bits &= bits - 1 )
+            {
+                ++mPositionFlippedBits[ PopCount( ( bits & ( ~bits + 1 ) ) - 1 ) ];
+            }
+        }
+
+        result.mIsJudged = true;
+        result.mPacketBeginSample = judged.mBeginSample;
+        result.mComparedBits = comparedLeds * mBitsPerPixel;
+
+        mPositionComparedWords += comparedLeds;
+        mTotal.mComparedBits += result.mComparedBits;
+        mTotal.mFlippedBits += result.mFlippedBits;
+    }
+
+    // slide the window along, reusing the storage of the oldest packet
+    std::swap( mPackets[ OLDEST ], mPackets[ JUDGED ] );
+    std::swap( mPackets[ JUDGED ], mPackets[ CURRENT ] );
+    mPackets[ CURRENT ].mWords.clear();
+    mPackets[ CURRENT ].mIsValid = false;
+
+    return result;
+}
+
+BitErrorCount BitErrorEstimator::Total() const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    return mTotal;
+}
+
+U32 BitErrorEstimator::LedCount() const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    return static_cast<U32>( mLedPackets.size() );
+}
+
+BitErrorCount BitErrorEstimator::Led( U32 ledIndex ) const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    BitErrorCount count;
+
+    if( ledIndex < mLedPackets.size() )
+    {
+        count.mComparedBits = U64( mLedPackets[ ledIndex ] ) * mBitsPerPixel;
+        count.mFlippedBits = mLedFlippedBits[ ledIndex ];
+    }
+
+    return count;
+}
+
+BitErrorCount BitErrorEstimator::BitPosition( U32 position ) const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    BitErrorCount count;
+
+    if( ( position < BIT_POSITION_COUNT ) && ( ( mChannelMask >> position ) & 1 ) )
+    {
+        count.mComparedBits = mPositionComparedWords;
+        count.mFlippedBits = mPositionFlippedBits[ position ];
+    }
+
+    return count;
+}
+
+void BitErrorEstimator::WorstLeds( U32 count, std::vector<U32>& ledIndices ) const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    ledIndices.clear();
+
+    for( U32 i = 0; i < mLedFlippedBits.size(); ++i )
+    {
+        if( mLedFlippedBits[ i ] > 0 )
+        {
+            ledIndices.push_back( i );
+        }
+    }
+
+    const size_t worst = std::min<size_t>( count, ledIndices.size() );
+    std::partial_sort( ledIndices.begin(), ledIndices.begin() + worst, ledIndices.end(), [this]( U32 a, U32 b ) {
+        return ( mLedFlippedBits[ a ] > mLedFlippedBits[ b ] ) || ( ( mLedFlippedBits[ a ] == mLedFlippedBits[ b ] ) && ( a < b ) );
+    } );
+    ledIndices.resize( worst );
+}
@@ -0,0 +1,116 @@
+#ifndef ASYNCRGBLED_BIT_ERRORS_H
+#define ASYNCRGBLED_BIT_ERRORS_H
+
+#include <mutex>
+#include <vector>
+
+#include <AnalyzerTypes.h>
+
+#include "AsyncRgbLedHelpers.h"
+
+/// flipped bits found in one packet, see BitErrorEstimator::EndPacket
+struct PacketBitErrors
+{
+    bool mIsJudged = false; // there was a packet to judge
+    U64 mPacketBeginSample = 0;
+    U64 mComparedBits = 0;
+    U64 mFlippedBits = 0;
+    U32 mFlippedLeds = 0; // LEDs with at least one flipped bit
+    U32 mFirstFlippedLed = 0;
+};
+
+/// the error count of one LED or one bit position
+struct BitErrorCount
+{
+    U64 mComparedBits = 0;
+    U64 mFlippedBits = 0;
+
+    double Rate() const
+    {
+        return mComparedBits ? double( mFlippedBits ) / mComparedBits : 0.0;
+    }
+};
+
+/**
+ * @brief BitErrorEstimator - the bit error rate of the link, estimated from
+ * content that stays the same from refresh to refresh, where every bit that
+ * differs was received wrong, even though its timing was in tolerance.
+ *
+ * Each LED's bits are judged by a majority vote over three packets in a row:
+ * where the packets before and after agree on an LED, it shows static
+ * content, and any bit of the middle packet differing from them is a flipped
+ * bit. LEDs changing from one packet to the next aren't judged, so animated
+ * content only narrows what is compared. A packet is judged once the next one
+ * is complete.
+ *
+ * An LED's channels are packed into one word, 16 bits each, so comparing an
+ * LED is a couple of word-wide operations, and flipped bits are counted with
+ * a popcount. Counts are kept per LED and per bit position.
+ *
+ * Decoding adds packets while exports read the counts, so every access takes
+ * a lock.
+ */
+class BitErrorEstimator
+{
+  public:
+    static const U32 BITS_PER_CHANNEL_SLOT = 16;
+    static const U32 BIT_POSITION_COUNT = 3 * BITS_PER_CHANNEL_SLOT;
+
+    /// forgets everything, for channels of this many bits
+    void Configure( U8 bitSize );
+
+    /// room for packets of this many LEDs, so adding them never allocates
+    void Reserve( U32 pixels );
+
+    /// the next LED of the current packet
+    void AddPixel( const RGBValue& rgb )
+    {
+        mPackets[ CURRENT ].mWords.push_back( U64( rgb.red ) | ( U64( rgb.green ) << 16 ) | ( U64( rgb.blue ) << 32 ) );
+    }
+
+    /// the current packet is complete. Judges the packet before it, and
+    /// returns what was found there.
+    PacketBitErrors EndPacket( U64 beginSample );
+
+    BitErrorCount Total() const;
+
+    /// one more than the highest LED judged
+    U32 LedCount() const;
+    BitErrorCount Led( U32 ledIndex ) const;
+
+    /// position of a bit in red, green and blue, BITS_PER_CHANNEL_SLOT each,
+    /// 0 being the least significant bit of red
+    BitErrorCount BitPosition( U32 position ) const;
+
+    /// up to count LEDs with the most flipped bits, most first; ties by index
+    void WorstLeds( U32 count, std::vector<U32>& ledIndices ) const;
+
+  private:
+    enum
+    {
+        OLDEST = 0, // the packets before and after the judged one
+        JUDGED,
+        CURRENT,
+        WINDOW
+    };
+
+    struct PacketWords
+    {
+        std::vector<U64> mWords; // by LED
+        U64 mBeginSample = 0;
+        bool mIsValid = false;
+    };
+
+    PacketWords mPackets[ WINDOW ];
+    U64 mChannelMask = 0;
+    U32 mBitsPerPixel = 0;
+
+    mutable std::mutex mMutex;
+    std::vector<U32> mLedPackets; // packets judged, by LED
+    std::vector<U64> mLedFlippedBits;
+    U64 mPositionFlippedBits[ BIT_POSITION_COUNT ];
+    U64 mPositionComparedWords = 0; // each compares one bit of every position in use
+    BitErrorCount mTotal;
+};
+
+#endif // ASYNCRGBLED_BIT_ERRORS_H
@@ -0,0 +1,322 @@
+#include "AsyncRgbLedCApi.h"
+
+#include <cstddef> // for offsetof
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <strings.h> // for strcasecmp
+
+#include "AsyncRgbLedCaptureFile.h"
+#include "AsyncRgbLedControllers.h"
+#include "AsyncRgbLedDecoder.h"
+
+// pixels are handed out as the decoder stores them
+static_assert( sizeof( argb_pixel ) == sizeof( DecodedPixel ), "argb_pixel doesn't match DecodedPixel" );
+static_assert( offsetof( argb_pixel, red ) == offsetof( DecodedPixel, mRGB ) + offsetof( RGBValue, red ), "argb_pixel doesn't match" );
+static_assert( offsetof( argb_pixel, green ) == offsetof( DecodedPixel, mRGB ) + offsetof( RGBValue, green ), "argb_pixel doesn't match" );
+static_assert( offsetof( argb_pixel, blue ) == offsetof( DecodedPixel, mRGB ) + offsetof( RGBValue, blue ), "argb_pixel doesn't match" );
+static_assert( offsetof( argb_pixel, begin_sample ) == offsetof( DecodedPixel, mBeginSample ), "argb_pixel doesn't match" );
+static_assert( offsetof( argb_pixel, end_sample ) == offsetof( DecodedPixel, mEndSample ), "argb_pixel doesn't match" );
+
+namespace
+{
+    /// transitions in an array owned by the caller
+    class TransitionArray : public TransitionEdgeSource
+    {
+      public:
+        void Set( BitState initialState, const uint64_t* transitions, U64 count, U64 endSample )
+        {
+            mTransitions = transitions;
+            Reset( initialState, count, endSample );
+        }
+
+      protected:
+        U64 TransitionSample( U64 index ) const override
+        {
+            return mTransitions[ index ];
+        }
+
+      private:
+        const uint64_t* mTransitions = nullptr;
+    };
+
+    const std::vector<LedControllerData>& Controllers()
+    {
+        static const std::vector<LedControllerData> controllers = CreateControllerData();
+        return controllers;
+    }
+}
+
+struct argb_decoder
+{
+    LedControllerData mController;
+    double mSampleRateHz = 0.0;
+
+    AsyncRgbLedDecoder mDecoder;
+    TransitionArray mTransitions;
+    Logic2CaptureFile mCapture;
+    bool mHasSource = false;
+
+    DecodedPacket mPacket;
+    U64 mPacketCount = 0;
+    std::string mError;
+
+    /// a decoder reads a single source, from its start
+    void SetSource( EdgeSource* source )
+    {
+        mDecoder.Configure( BuildControllerTimingTable( mController, mSampleRateHz ), mController.mBitsPerChannel, mController.mLayout,
+                            mSampleRateHz );
+        mDecoder.SetSource( source );
+        mDecoder.SetLogErrors( false ); // a library keeps quiet on the host's stderr
+        mHasSource = true;
+        mError.clear();
+    }
+
+    /// keeps the reason a call failed, without throwing again
+    void Fail( const char* message )
+    {
+        try
+        {
+            mError = message;
+        }
+        catch( ... )
+        {
+            mError.clear();
+        }
+    }
+
+    bool CheckNoSource()
+    {
+        if( mHasSource )
+        {
+            mError = "the decoder has a source already";
+            return false;
+        }
+
+        return true;
+    }
+
+    bool Next( argb_packet& packet )
+    {
+        // the end of the source isn't an error
+        mError.clear();
+
+        if( !mHasSource )
+        {
+            mError = "the decoder has no source";
+            return false;
+        }
+
+        if( !mDecoder.DecodePacket( mPacket ) )
+        {
+            return false;
+        }
+
+        const PacketSummary& summary = mPacket.mSummary;
+        packet.index = mPacketCount++;
+        packet.begin_sample = summary.mBeginSample;
+        packet.end_sample = summary.mEndSample;
+        packet.pixel_count = summary.mPixelCount;
+        packet.bit_count = summary.mBitCount;
+        packet.high_speed = summary.mHighSpeed ? 1 : 0;
+        packet.pixels = reinterpret_cast<const argb_pixel*>( mPacket.mPixels.data() );
+        return true;
+    }
+};
+
+namespace
+{
+    /// runs the body of an entry point taking a decoder. No exception crosses
+    /// into C: it fails the call instead, with its message as the error.
+    template <typename Result, typename Body>
+    Result CallDecoder( argb_decoder* decoder, Result failure, Body body )
+    {
+        if( !decoder )
+        {
+            return failure;
+        }
+
+        try
+        {
+            return body();
+        }
+        catch( const std::exception& e )
+        {
+            decoder->Fail( e.what() );
+        }
+        catch( ... )
+        {
+            decoder->Fail( "unknown error" );
+        }
+
+        return failure;
+    }
+}
+
+int argb_api_version( void )
+{
+    return ARGB_API_VERSION;
+}
+
+int argb_controller_count( void )
+{
+    try
+    {
+        return static_cast<int>( Controllers().size() );
+    }
+    catch( ... )
+    {
+        return 0;
+    }
+}
+
+const char* argb_controller_name( int index )
+{
+    if( ( index < 0 ) || ( index >= argb_controller_count() ) )
+    {
+        return nullptr;
+    }
+
+    return Controllers()[ index ].mName.c_str();
+}
+
+argb_decoder* argb_decoder_create( const char* controller, double sample_rate_hz )
+{
+    if( !controller || !( sample_rate_hz > 0.0 ) )
+    {
+        return nullptr;
+    }
+
+    try
+    {
+        for( const LedControllerData& c : Controllers() )
+        {
+            if( ::strcasecmp( c.mName.c_str(), controller ) == 0 )
+            {
+                std::unique_ptr<argb_decoder> decoder( new argb_decoder() );
+                decoder->mController = c;
+                decoder->mSampleRateHz = sample_rate_hz;
+                return decoder.release();
+            }
+        }
+    }
+    catch( ... )
+    {
+        // out of memory, with no decoder to keep the reason in
+    }
+
+    return nullptr;
+}
+
+void argb_decoder_destroy( argb_decoder* decoder )
+{
+    delete decoder;
+}
+
+int argb_decoder_set_transitions( argb_decoder* decoder, int initial_level, const uint64_t* transitions, uint64_t count,
+                                  uint64_t end_sample )
+{
+    return CallDecoder( decoder, 0, [&]() -> int {
+        if( !decoder->CheckNoSource() )
+        {
+            return 0;
+        }
+
+        if( !transitions && ( count > 0 ) )
+        {
+            decoder->mError = "no transitions given";
+            return 0;
+        }
+
+        decoder->mTransitions.Set( initial_level ? BIT_HIGH : BIT_LOW, transitions, count, end_sample );
+        decoder->SetSource( &decoder->mTransitions );
+        return 1;
+    } );
+}
+
+int argb_decoder_open_capture( argb_decoder* decoder, const char* path )
+{
+    return CallDecoder( decoder, 0, [&]() -> int {
+        if( !decoder->CheckNoSource() )
+        {
+            return 0;
+        }
+
+        if( !path )
+        {
+            decoder->mError = "no path given";
+            return 0;
+        }
+
+        std::string error;
+
+        if( !decoder->mCapture.Open( path, decoder->mSampleRateHz, error ) )
+        {
+            decoder->mError = std::string( path ) + ": " + error;
+            return 0;
+        }
+
+        decoder->SetSource( &decoder->mCapture );
+        return 1;
+    } );
+}
+
+int argb_decoder_next( argb_decoder* decoder, argb_packet* packet )
+{
+    return CallDecoder( decoder, 0, [&]() -> int {
+        if( !packet )
+        {
+            decoder->mError = "no packet given";
+            return 0;
+        }
+
+        return decoder->Next( *packet ) ? 1 : 0;
+    } );
+}
+
+uint64_t argb_decoder_for_each( argb_decoder* decoder, argb_packet_callback callback, void* context )
+{
+    // packets passed before an exception still count
+    uint64_t count = 0;
+
+    CallDecoder( decoder, 0, [&]() -> int {
+        if( !callback )
+        {
+            decoder->mError = "no callback given";
+            return 0;
+        }
+
+        argb_packet packet;
+
+        while( decoder->Next( packet ) )
+        {
+            ++count;
+
+            if( callback( &packet, context ) != 0 )
+            {
+                break;
+            }
+        }
+
+        return 1;
+    } );
+
+    return count;
+}
+
+int argb_decoder_bits_per_channel( const argb_decoder* decoder )
+{
+    return decoder ? decoder->mController.mBitsPerChannel : 0;
+}
+
+uint64_t argb_decoder_error_count( const argb_decoder* decoder )
+{
+    return decoder ? decoder->mDecoder.ErrorCount() : 0;
+}
+
+const char* argb_decoder_error( const argb_decoder* decoder )
+{
+    return decoder ? decoder->mError.c_str() : "no decoder given";
+}
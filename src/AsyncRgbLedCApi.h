@@ -0,0 +1,104 @@
+#ifndef ASYNCRGBLED_C_API_H
+#define ASYNCRGBLED_C_API_H
+
+/*
+ * C interface to the analyzer's decoder, built on Linux and MacOS as the
+ * async_rgb_led shared library, for calling the decoder in-process from
+ * other languages.
+ *
+ * A decoder reads one source: either an array of transition sample numbers
+ * owned by the caller, or a Logic 2 binary digital export, which is mapped
+ * into memory. Packets come out one at a time, through argb_decoder_next or
+ * a callback. A packet's pixels are a contiguous array in the decoder's own
+ * storage, handed out without copying; they stay valid until the next packet
+ * is decoded or the decoder is destroyed.
+ *
+ * Functions returning int return 1 on success and 0 otherwise;
+ * argb_decoder_error then tells why. A NULL decoder, or any other NULL
+ * pointer argument, fails the call; no C++ exception ever reaches the
+ * caller. Separate decoders may be used from separate threads.
+ */
+
+#include <stdint.h>
+
+#define ARGB_API __attribute__( ( visibility( "default" ) ) )
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* bumped whenever a declaration below changes incompatibly */
+#define ARGB_API_VERSION 1
+
+    typedef struct argb_decoder argb_decoder;
+
+    /* laid out as the decoder stores its pixels */
+    typedef struct argb_pixel
+    {
+        uint16_t red;
+        uint16_t green;
+        uint16_t blue;
+        uint16_t padding;
+        uint64_t begin_sample; /* first sample of the pixel's first bit */
+        uint64_t end_sample;   /* last sample of its last bit */
+    } argb_pixel;
+
+    typedef struct argb_packet
+    {
+        uint64_t index; /* counting from 0 */
+        uint64_t begin_sample;
+        uint64_t end_sample;
+        uint32_t pixel_count;
+        uint32_t bit_count;
+        int high_speed;
+        const argb_pixel* pixels; /* pixel_count pixels, see above for how long they are valid */
+    } argb_packet;
+
+    /* return 0 to carry on, anything else to stop */
+    typedef int ( *argb_packet_callback )( const argb_packet* packet, void* context );
+
+    /* ARGB_API_VERSION of the library, which may differ from the header's */
+    ARGB_API int argb_api_version( void );
+
+    /* the controllers by index, as listed in the analyzer settings */
+    ARGB_API int argb_controller_count( void );
+    ARGB_API const char* argb_controller_name( int index );
+
+    /* NULL if the controller name, compared ignoring case, is unknown, or the
+       sample rate isn't positive */
+    ARGB_API argb_decoder* argb_decoder_create( const char* controller, double sample_rate_hz );
+    ARGB_API void argb_decoder_destroy( argb_decoder* decoder );
+
+    /* decode these transitions, in increasing sample numbers, with the line
+       at initial_level (0 or 1) before the first. The array isn't copied and
+       must stay valid while the decoder is used. end_sample is one past the
+       last sample captured. */
+    ARGB_API int argb_decoder_set_transitions( argb_decoder* decoder, int initial_level, const uint64_t* transitions, uint64_t count,
+                                               uint64_t end_sample );
+
+    /* decode a Logic 2 binary digital export, captured at the decoder's
+       sample rate */
+    ARGB_API int argb_decoder_open_capture( argb_decoder* decoder, const char* path );
+
+    /* the next packet with at least one pixel; 0 once the source is
+       exhausted */
+    ARGB_API int argb_decoder_next( argb_decoder* decoder, argb_packet* packet );
+
+    /* calls back with every remaining packet, until the source is exhausted
+       or the callback asks to stop. Returns the number of packets passed. */
+    ARGB_API uint64_t argb_decoder_for_each( argb_decoder* decoder, argb_packet_callback callback, void* context );
+
+    ARGB_API int argb_decoder_bits_per_channel( const argb_decoder* decoder );
+
+    /* times decoding was abandoned due to invalid timing */
+    ARGB_API uint64_t argb_decoder_error_count( const argb_decoder* decoder );
+
+    /* why the last call failed, empty if none did */
+    ARGB_API const char* argb_decoder_error( const argb_decoder* decoder );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ASYNCRGBLED_C_API_H */
@@ -0,0 +1,117 @@
+#include "AsyncRgbLedCaptureFile.h"
+
+#include <algorithm> // for std::max
+#include <cmath>     // for llround
+#include <cstring>   // for memcpy, memcmp
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const char IDENTIFIER[ 8 ] = { '<', 'S', 'A', 'L', 'E', 'A', 'E', '>' };
+    const size_t HEADER_SIZE = 8 + 4 + 4 + 4 + 8 + 8 + 8;
+
+    template <typename T>
+    T ReadValue( const unsigned char* data )
+    {
+        // the header fields and transition times are not naturally aligned
+        T value;
+        memcpy( &value, data, sizeof( T ) );
+        return value;
+    }
+}
+
+Logic2CaptureFile::~Logic2CaptureFile()
+{
+    Close();
+}
+
+bool Logic2CaptureFile::Open( const std::string& path, double sampleRateHz, std::string& error )
+{
+    Close();
+
+    const int fd = ::open( path.c_str(), O_RDONLY );
+
+    if( fd < 0 )
+    {
+        error = "can't open file";
+        return false;
+    }
+
+    struct stat info;
+
+    if( ( ::fstat( fd, &info ) != 0 ) || ( static_cast<size_t>( info.st_size ) < HEADER_SIZE ) )
+    {
+        ::close( fd );
+        error = "file is too short for a Logic 2 binary export";
+        return false;
+    }
+
+    mMappingSize = static_cast<size_t>( info.st_size );
+    mMapping = ::mmap( nullptr, mMappingSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+    ::close( fd );
+
+    if( mMapping == MAP_FAILED )
+    {
+        mMapping = nullptr;
+        error = "can't map file";
+        return false;
+    }
+
+    // transitions are read front to back exactly once
+    ::madvise( mMapping, mMappingSize, MADV_SEQUENTIAL );
+
+    const unsigned char* data = static_cast<const unsigned char*>( mMapping );
+
+    const S32 version = ReadValue<S32>( data + 8 );
+    const S32 type = ReadValue<S32>( data + 12 );
+
+    if( ( memcmp( data, IDENTIFIER, sizeof( IDENTIFIER ) ) != 0 ) || ( version < 0 ) || ( version > 1 ) || ( type != 0 ) )
+    {
+        Close();
+        error = "not a Logic 2 binary digital export";
+        return false;
+    }
+
+    const U32 initialState = ReadValue<U32>( data + 16 );
+    mBeginTimeSec = ReadValue<double>( data + 20 );
+    const double endTimeSec = ReadValue<double>( data + 28 );
+    mTransitionCount = ReadValue<U64>( data + 36 );
+    mTransitions = data + HEADER_SIZE;
+    mSampleRateHz = sampleRateHz;
+
+    if( mTransitionCount > ( mMappingSize - HEADER_SIZE ) / sizeof( double ) )
+    {
+        Close();
+        error = "file is truncated";
+        return false;
+    }
+
+    mEndSample = static_cast<U64>( std::max( 0.0, ( endTimeSec - mBeginTimeSec ) * sampleRateHz ) );
+    Reset( initialState ? BIT_HIGH : BIT_LOW, mTransitionCount, mEndSample );
+    return true;
+}
+
+void Logic2CaptureFile::Close()
+{
+    if( mMapping )
+    {
+        ::munmap( mMapping, mMappingSize );
+    }
+
+    mMapping = nullptr;
+    mMappingSize = 0;
+    mTransitions = nullptr;
+    mTransitionCount = 0;
+    Reset( BIT_LOW, 0, 0 );
+}
+
+U64 Logic2CaptureFile::TransitionSample( U64 index ) const
+{
+    const double timeSec = ReadValue<double>( mTransitions + index * sizeof( double ) );
+    const double sample = ( timeSec - mBeginTimeSec ) * mSampleRateHz;
+    return ( sample > 0.0 ) ? static_cast<U64>( std::llround( sample ) ) : 0;
+}
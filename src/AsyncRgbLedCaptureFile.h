@@ -0,0 +1,60 @@
+#ifndef ASYNCRGBLED_CAPTURE_FILE_H
+#define ASYNCRGBLED_CAPTURE_FILE_H
+
+#include <string>
+
+#include "AsyncRgbLedDecoder.h"
+
+/**
+ * @brief Logic2CaptureFile - one digital channel exported from Logic 2 in the
+ * binary format, memory-mapped and presented as an EdgeSource.
+ *
+ * The file holds an 8-byte "<SALEAE>" identifier, then int32 version, int32
+ * type (0 = digital), uint32 initial state, double begin time, double end
+ * time, uint64 transition count and the transition times as doubles, all
+ * little-endian. Times are in seconds; the format doesn't record the sample
+ * rate, so it has to be supplied to convert them to sample numbers.
+ */
+class Logic2CaptureFile : public TransitionEdgeSource
+{
+  public:
+    Logic2CaptureFile() = default;
+    ~Logic2CaptureFile();
+
+    Logic2CaptureFile( const Logic2CaptureFile& ) = delete;
+    Logic2CaptureFile& operator=( const Logic2CaptureFile& ) = delete;
+
+    /// returns false and fills in error if the file can't be used
+    bool Open( const std::string& path, double sampleRateHz, std::string& error );
+    void Close();
+
+    double BeginTimeSec() const
+    {
+        return mBeginTimeSec;
+    }
+
+    U64 TransitionCount() const
+    {
+        return mTransitionCount;
+    }
+
+    U64 EndSample() const
+    {
+        return mEndSample;
+    }
+
+  protected:
+    U64 TransitionSample( U64 index ) const override;
+
+  private:
+    void* mMapping = nullptr;
+    size_t mMappingSize = 0;
+
+    const unsigned char* mTransitions = nullptr;
+    U64 mTransitionCount = 0;
+    U64 mEndSample = 0;
+    double mBeginTimeSec = 0.0;
+    double mSampleRateHz = 0.0;
+};
+
+#endif // ASYNCRGBLED_CAPTURE_FILE_H
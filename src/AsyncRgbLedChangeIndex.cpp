@@ -0,0 +1,211 @@
+#include "AsyncRgbLedChangeIndex.h"
+
+#include <algorithm> // for std::upper_bound, std::lower_bound, std::sort, std::inplace_merge
+#include <cstdlib>   // for abs
+
+namespace
+{
+    bool SameColor( const RGBValue& a, const RGBValue& b )
+    {
+        return ( a.red == b.red ) && ( a.green == b.green ) && ( a.blue == b.blue );
+    }
+
+    bool WithinTolerance( const RGBValue& a, const RGBValue& b, U16 tolerance )
+    {
+        return ( std::abs( a.red - b.red ) <= tolerance ) && ( std::abs( a.green - b.green ) <= tolerance ) &&
+               ( std::abs( a.blue - b.blue ) <= tolerance );
+    }
+
+    /// changes waiting for the ordering by color are merged in once there are
+    /// this many, or an eighth of those merged already if that is more. This
+    /// keeps the cost of merging constant per change, and the scan of those
+    /// waiting short.
+    const size_t MINIMUM_COLOR_MERGE = 256;
+    const size_t COLOR_MERGE_FRACTION = 8;
+}
+
+void PixelChangeIndex::Clear()
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    mLeds.clear();
+    mChangeCount = 0;
+}
+
+bool PixelChangeIndex::Add( U32 ledIndex, U64 sample, const RGBValue& rgb )
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    if( ledIndex >= mLeds.size() )
+    {
+        mLeds.resize( ledIndex + 1 );
+    }
+
+    LedHistory& history = mLeds[ ledIndex ];
+
+    if( !history.mColors.empty() && SameColor( history.mColors.back(), rgb ) )
+    {
+        return false;
+    }
+
+    history.mSamples.push_back( sample );
+    history.mColors.push_back( rgb );
+    ++mChangeCount;
+
+    const size_t merged = history.mByColor.size();
+
+    if( history.mSamples.size() - merged >= std::max( MINIMUM_COLOR_MERGE, merged / COLOR_MERGE_FRACTION ) )
+    {
+        MergeIntoColorOrder( history );
+    }
+
+    return true;
+}
+
+void PixelChangeIndex::MergeIntoColorOrder( LedHistory& history )
+{
+    const std::vector<RGBValue>& colors = history.mColors;
+    std::vector<U32>& byColor = history.mByColor;
+
+    // order by color, then by position, which is also sample order
+    auto colorOrder = [&colors]( U32 a, U32 b ) {
+        const U64 ca = colors[ a ].ConvertToU64();
+        const U64 cb = colors[ b ].ConvertToU64();
+        return ( ca < cb ) || ( ( ca == cb ) && ( a < b ) );
+    };
+
+    const size_t merged = byColor.size();
+
+    for( size_t i = merged; i < colors.size(); ++i )
+    {
+        byColor.push_back( static_cast<U32>( i ) );
+    }
+
+    std::sort( byColor.begin() + merged, byColor.end(), colorOrder );
+    std::inplace_merge( byColor.begin(), byColor.begin() + merged, byColor.end(), colorOrder );
+}
+
+U32 PixelChangeIndex::LedCount() const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    return static_cast<U32>( mLeds.size() );
+}
+
+U64 PixelChangeIndex::ChangeCount() const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    return mChangeCount;
+}
+
+const PixelChangeIndex::LedHistory* PixelChangeIndex::History( U32 ledIndex ) const
+{
+    return ( ledIndex < mLeds.size() ) ? &mLeds[ ledIndex ] : nullptr;
+}
+
+bool PixelChangeIndex::ValueAt( U32 ledIndex, U64 sample, PixelChange& change ) const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    const LedHistory* history = History( ledIndex );
+
+    if( !history )
+    {
+        return false;
+    }
+
+    const auto next = std::upper_bound( history->mSamples.begin(), history->mSamples.end(), sample );
+
+    if( next == history->mSamples.begin() )
+    {
+        return false;
+    }
+
+    const size_t i = ( next - history->mSamples.begin() ) - 1;
+    change.mSample = history->mSamples[ i ];
+    change.mRGB = history->mColors[ i ];
+    return true;
+}
+
+void PixelChangeIndex::Changes( U32 ledIndex, U64 beginSample, U64 endSample, std::vector<PixelChange>& changes ) const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    changes.clear();
+    const LedHistory* history = History( ledIndex );
+
+    if( !history )
+    {
+        return;
+    }
+
+    const auto first = std::lower_bound( history->mSamples.begin(), history->mSamples.end(), beginSample );
+
+    for( size_t i = first - history->mSamples.begin(); ( i < history->mSamples.size() ) && ( history->mSamples[ i ] <= endSample ); ++i )
+    {
+        PixelChange change;
+        change.mSample = history->mSamples[ i ];
+        change.mRGB = history->mColors[ i ];
+        changes.push_back( change );
+    }
+}
+
+bool PixelChangeIndex::FindFirst( U32 ledIndex, const RGBValue& target, U16 tolerance, U64 fromSample, PixelChange& change ) const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    const LedHistory* history = History( ledIndex );
+
+    if( !history )
+    {
+        return false;
+    }
+
+    const std::vector<U64>& samples = history->mSamples;
+    const std::vector<RGBValue>& colors = history->mColors;
+    size_t found = samples.size();
+
+    if( tolerance == 0 )
+    {
+        const std::vector<U32>& byColor = history->mByColor;
+
+        // the first change to the target color at or after fromSample, among
+        // those merged into the ordering by color
+        const U32 firstAtOrAfter = static_cast<U32>( std::lower_bound( samples.begin(), samples.end(), fromSample ) - samples.begin() );
+        const U64 targetColor = target.ConvertToU64();
+        const auto candidate =
+            std::lower_bound( byColor.begin(), byColor.end(), firstAtOrAfter, [&colors, targetColor]( U32 entry, U32 position ) {
+                const U64 c = colors[ entry ].ConvertToU64();
+                return ( c < targetColor ) || ( ( c == targetColor ) && ( entry < position ) );
+            } );
+
+        if( ( candidate != byColor.end() ) && SameColor( colors[ *candidate ], target ) )
+        {
+            found = *candidate;
+        }
+
+        // otherwise among those still waiting, which all come later
+        for( size_t i = std::max<size_t>( firstAtOrAfter, byColor.size() ); ( found == samples.size() ) && ( i < samples.size() ); ++i )
+        {
+            if( SameColor( colors[ i ], target ) )
+            {
+                found = i;
+            }
+        }
+    }
+    else
+    {
+        for( size_t i = std::lower_bound( samples.begin(), samples.end(), fromSample ) - samples.begin(); i < samples.size(); ++i )
+        {
+            if( WithinTolerance( colors[ i ], target, tolerance ) )
+            {
+                found = i;
+                break;
+            }
+        }
+    }
+
+    if( found == samples.size() )
+    {
+        return false;
+    }
+
+    change.mSample = samples[ found ];
+    change.mRGB = colors[ found ];
+    return true;
+}
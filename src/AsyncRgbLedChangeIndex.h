@@ -0,0 +1,84 @@
+#ifndef ASYNCRGBLED_CHANGE_INDEX_H
+#define ASYNCRGBLED_CHANGE_INDEX_H
+
+#include <mutex>
+#include <vector>
+
+#include <AnalyzerTypes.h>
+
+#include "AsyncRgbLedHelpers.h"
+
+/// an LED taking on a new value
+struct PixelChange
+{
+    U64 mSample = 0; // start of the pixel which carried the new value
+    RGBValue mRGB;
+};
+
+/**
+ * @brief PixelChangeIndex - for each LED along the strip, the samples where its
+ * value changed, so per-LED questions don't need a search through every
+ * pixel frame.
+ *
+ * The changes of each LED are kept sorted by sample, so finding the value at
+ * a point in time, or the changes in a time window, is a binary search. Exact
+ * color matches use a second ordering by color, which Add() keeps up to date
+ * by merging new changes into it in batches, so queries never sort. Memory
+ * is CHANGE_BYTES per change; pixels repeating the previous value of their
+ * LED take nothing.
+ *
+ * Decoding adds to the index while exports and queries read it, so every
+ * access takes a lock.
+ */
+class PixelChangeIndex
+{
+  public:
+    /// memory of one change, in the sample and color lists and the ordering by color
+    static const U64 CHANGE_BYTES = 20;
+
+    void Clear();
+
+    /// a decoded pixel. Each LED's pixels must arrive in sample order.
+    /// Returns true if it changed the LED's value, and so took memory.
+    bool Add( U32 ledIndex, U64 sample, const RGBValue& rgb );
+
+    /// one more than the highest LED index seen
+    U32 LedCount() const;
+    U64 ChangeCount() const;
+
+    /// the last change of the LED at or before the sample, false if none
+    bool ValueAt( U32 ledIndex, U64 sample, PixelChange& change ) const;
+
+    /// the changes of the LED in [ beginSample, endSample ], oldest first
+    void Changes( U32 ledIndex, U64 beginSample, U64 endSample, std::vector<PixelChange>& changes ) const;
+
+    /**
+     * The first change of the LED at or after fromSample to a color within
+     * tolerance of the target, on every channel. False if there is none.
+     * Exact matches (tolerance 0) are a binary search, plus a scan of the
+     * changes not merged into the ordering by color yet; otherwise the
+     * changes from fromSample on are scanned.
+     */
+    bool FindFirst( U32 ledIndex, const RGBValue& target, U16 tolerance, U64 fromSample, PixelChange& change ) const;
+
+  private:
+    struct LedHistory
+    {
+        std::vector<U64> mSamples;
+        std::vector<RGBValue> mColors;
+
+        /// positions in mSamples ordered by color, then sample. Only the
+        /// first mByColor.size() changes are covered, later ones are merged
+        /// in once there are enough of them.
+        std::vector<U32> mByColor;
+    };
+
+    const LedHistory* History( U32 ledIndex ) const;
+    static void MergeIntoColorOrder( LedHistory& history );
+
+    std::vector<LedHistory> mLeds;
+    U64 mChangeCount = 0;
+    mutable std::mutex mMutex;
+};
+
+#endif // ASYNCRGBLED_CHANGE_INDEX_H
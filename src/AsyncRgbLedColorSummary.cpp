@@ -0,0 +1,160 @@
+#include "AsyncRgbLedColorSummary.h"
+
+#include <algorithm> // for std::min, std::max, std::fill
+#include <cmath>     // for llround
+
+namespace
+{
+    const double FINEST_BUCKET_SEC = 1e-3;
+
+    /// each level's buckets are this many of the level below, so they nest
+    const U64 LEVEL_SCALE = 10;
+}
+
+void ColorSummaryPyramid::Configure( double sampleRateHz, U8 bitSize )
+{
+    mSampleRateHz = sampleRateHz;
+    mBitSize = bitSize;
+    mCompleted.clear();
+
+    U64 bucketSamples = static_cast<U64>( std::max<S64>( 1, std::llround( FINEST_BUCKET_SEC * sampleRateHz ) ) );
+
+    for( Level& level : mLevels )
+    {
+        level = Level();
+        level.mBucketSamples = bucketSamples;
+        bucketSamples *= LEVEL_SCALE;
+    }
+}
+
+void ColorSummaryPyramid::AddPacket( U64 beginSample )
+{
+    OpenBucket( 0, beginSample / mLevels[ 0 ].mBucketSamples );
+    ++mLevels[ 0 ].mPackets;
+}
+
+void ColorSummaryPyramid::AddPixel( U32 ledIndex, const RGBValue& rgb )
+{
+    Level& level = mLevels[ 0 ];
+
+    if( ledIndex >= level.mLeds.size() )
+    {
+        level.mLeds.resize( ledIndex + 1 );
+    }
+
+    LedSum& sum = level.mLeds[ ledIndex ];
+    sum.mRed += rgb.red;
+    sum.mGreen += rgb.green;
+    sum.mBlue += rgb.blue;
+    ++sum.mCount;
+
+    level.mLedCount = std::max( level.mLedCount, ledIndex + 1 );
+    ++level.mPixels;
+}
+
+void ColorSummaryPyramid::CompleteBucketsBefore( U64 sample, std::vector<ColorSummaryBucket>& completed )
+{
+    // going up the levels, so that buckets folded into a coarser level by
+    // this call are completed too when they also end before the sample
+    for( U32 i = 0; i < LEVEL_COUNT; ++i )
+    {
+        const Level& level = mLevels[ i ];
+
+        if( level.mIsOpen && ( ( level.mBucketIndex + 1 ) * level.mBucketSamples <= sample ) )
+        {
+            CompleteBucket( i );
+        }
+    }
+
+    completed.insert( completed.end(), mCompleted.begin(), mCompleted.end() );
+    mCompleted.clear();
+}
+
+void ColorSummaryPyramid::OpenBucket( U32 levelIndex, U64 bucketIndex )
+{
+    Level& level = mLevels[ levelIndex ];
+
+    if( level.mIsOpen && ( level.mBucketIndex == bucketIndex ) )
+    {
+        return;
+    }
+
+    if( level.mIsOpen )
+    {
+        CompleteBucket( levelIndex );
+    }
+
+    level.mIsOpen = true;
+    level.mBucketIndex = bucketIndex;
+}
+
+void ColorSummaryPyramid::CompleteBucket( U32 levelIndex )
+{
+    Level& level = mLevels[ levelIndex ];
+
+    ColorSummaryBucket bucket;
+    bucket.mLevel = levelIndex;
+    bucket.mBeginSample = level.mBucketIndex * level.mBucketSamples;
+    bucket.mEndSample = bucket.mBeginSample + level.mBucketSamples - 1;
+    bucket.mDurationSec = level.mBucketSamples / mSampleRateHz;
+    bucket.mPackets = level.mPackets;
+    bucket.mPixels = level.mPixels;
+
+    // equal ranges, the last one may be shorter
+    const U32 ledCount = level.mLedCount;
+    const U32 maximumRanges = std::max<U32>( 1, std::min( ColorSummaryBucket::MAX_RANGE_COUNT, ledCount ) );
+    bucket.mLedsPerRange = std::max<U32>( 1, ( ledCount + maximumRanges - 1 ) / maximumRanges );
+    bucket.mRangeCount = ( ledCount + bucket.mLedsPerRange - 1 ) / bucket.mLedsPerRange;
+
+    for( U32 range = 0; range < bucket.mRangeCount; ++range )
+    {
+        LedSum total;
+        const U32 end = std::min( ledCount, ( range + 1 ) * bucket.mLedsPerRange );
+
+        for( U32 led = range * bucket.mLedsPerRange; led < end; ++led )
+        {
+            const LedSum& sum = level.mLeds[ led ];
+            total.mRed += sum.mRed;
+            total.mGreen += sum.mGreen;
+            total.mBlue += sum.mBlue;
+            total.mCount += sum.mCount;
+        }
+
+        const U64 count = std::max<U64>( 1, total.mCount );
+        const RGBValue average( static_cast<U16>( total.mRed / count ), static_cast<U16>( total.mGreen / count ),
+                                static_cast<U16>( total.mBlue / count ) );
+        average.ConvertTo8Bit( mBitSize, bucket.mColors[ range ] );
+    }
+
+    mCompleted.push_back( bucket );
+
+    if( levelIndex + 1 < LEVEL_COUNT )
+    {
+        OpenBucket( levelIndex + 1, level.mBucketIndex / LEVEL_SCALE );
+        Level& coarser = mLevels[ levelIndex + 1 ];
+        coarser.mPackets += level.mPackets;
+        coarser.mPixels += level.mPixels;
+        coarser.mLedCount = std::max( coarser.mLedCount, ledCount );
+
+        if( coarser.mLeds.size() < ledCount )
+        {
+            coarser.mLeds.resize( ledCount );
+        }
+
+        for( U32 led = 0; led < ledCount; ++led )
+        {
+            LedSum& to = coarser.mLeds[ led ];
+            const LedSum& from = level.mLeds[ led ];
+            to.mRed += from.mRed;
+            to.mGreen += from.mGreen;
+            to.mBlue += from.mBlue;
+            to.mCount += from.mCount;
+        }
+    }
+
+    std::fill( level.mLeds.begin(), level.mLeds.begin() + ledCount, LedSum() );
+    level.mIsOpen = false;
+    level.mPackets = 0;
+    level.mPixels = 0;
+    level.mLedCount = 0;
+}
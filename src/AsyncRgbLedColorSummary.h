@@ -0,0 +1,90 @@
+#ifndef ASYNCRGBLED_COLOR_SUMMARY_H
+#define ASYNCRGBLED_COLOR_SUMMARY_H
+
+#include <vector>
+
+#include <AnalyzerTypes.h>
+
+#include "AsyncRgbLedHelpers.h"
+
+/// the average colors of one time bucket of one level
+struct ColorSummaryBucket
+{
+    static const U32 MAX_RANGE_COUNT = 8;
+
+    U32 mLevel = 0;
+    U64 mBeginSample = 0; // first sample of the bucket
+    U64 mEndSample = 0;   // last sample of the bucket
+    double mDurationSec = 0.0;
+    U64 mPackets = 0;
+    U64 mPixels = 0;
+
+    /// the strip is split into up to MAX_RANGE_COUNT ranges of equal length
+    U32 mLedsPerRange = 1;
+    U32 mRangeCount = 0;
+
+    /// [ range ][ red, green, blue ], scaled to 8 bits
+    U8 mColors[ MAX_RANGE_COUNT ][ 3 ];
+};
+
+/**
+ * @brief ColorSummaryPyramid - average colors of the strip over time buckets
+ * of 1 ms, 10 ms, 100 ms and 1 s, so a zoomed-out view can read a few coarse
+ * records rather than every pixel.
+ *
+ * Only the finest level sees each pixel. When one of its buckets is complete,
+ * its per-LED sums are folded into the enclosing bucket of the next level, and
+ * so on up, so the cost per pixel doesn't depend on the number of levels.
+ * Buckets without packets produce nothing.
+ */
+class ColorSummaryPyramid
+{
+  public:
+    static const U32 LEVEL_COUNT = 4;
+
+    void Configure( double sampleRateHz, U8 bitSize );
+
+    /// a packet starting at this sample; its pixels follow
+    void AddPacket( U64 beginSample );
+    void AddPixel( U32 ledIndex, const RGBValue& rgb );
+
+    /// complete every bucket which ends before this sample, since no more
+    /// packets can fall into it. Completed buckets are appended to completed,
+    /// finest level first.
+    void CompleteBucketsBefore( U64 sample, std::vector<ColorSummaryBucket>& completed );
+
+  private:
+    struct LedSum
+    {
+        U64 mRed = 0;
+        U64 mGreen = 0;
+        U64 mBlue = 0;
+        U64 mCount = 0;
+    };
+
+    struct Level
+    {
+        U64 mBucketSamples = 1;
+        bool mIsOpen = false;
+        U64 mBucketIndex = 0;
+        U64 mPackets = 0;
+        U64 mPixels = 0;
+        U32 mLedCount = 0; // of the longest packet in the bucket
+        std::vector<LedSum> mLeds;
+    };
+
+    /// makes bucketIndex the open bucket of the level, completing the
+    /// previous one first if needed
+    void OpenBucket( U32 level, U64 bucketIndex );
+
+    /// appends the open bucket of the level to mCompleted and folds it into
+    /// the next level
+    void CompleteBucket( U32 level );
+
+    Level mLevels[ LEVEL_COUNT ];
+    std::vector<ColorSummaryBucket> mCompleted;
+    double mSampleRateHz = 1.0;
+    U8 mBitSize = 8;
+};
+
+#endif // ASYNCRGBLED_COLOR_SUMMARY_H
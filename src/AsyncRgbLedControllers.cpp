@@ -0,0 +1,256 @@
+#include "AsyncRgbLedControllers.h"
+
+#include <algorithm> // for std::min
+#include <cstdio>
+
+double operator"" _ns( unsigned long long x )
+{
+    return x * 1e-9;
+}
+
+double operator"" _us( unsigned long long x )
+{
+    return x * 1e-6;
+}
+
+std::string FormatBitTimings( const BitTiming timing[ 2 ] )
+{
+    std::string result;
+
+    for( const auto b : { BIT_LOW, BIT_HIGH } )
+    {
+        for( const TimingTolerance* t : { &timing[ b ].mPositiveTiming, &timing[ b ].mNegativeTiming } )
+        {
+            char buf[ 64 ];
+            ::snprintf( buf, sizeof( buf ), "%s%g/%g/%g", result.empty() ? "" : ", ", t->mMinimumSec * 1e9, t->mNominalSec * 1e9,
+                        t->mMaximumSec * 1e9 );
+            result += buf;
+        }
+    }
+
+    return result;
+}
+
+bool ParseBitTimings( const char* text, BitTiming timing[ 2 ] )
+{
+    double ns[ 12 ];
+    int consumed = 0;
+    const int count = ::sscanf( text, " %lf / %lf / %lf , %lf / %lf / %lf , %lf / %lf / %lf , %lf / %lf / %lf %n", &ns[ 0 ], &ns[ 1 ],
+                                &ns[ 2 ], &ns[ 3 ], &ns[ 4 ], &ns[ 5 ], &ns[ 6 ], &ns[ 7 ], &ns[ 8 ], &ns[ 9 ], &ns[ 10 ], &ns[ 11 ], &consumed );
+
+    if( ( count != 12 ) || ( text[ consumed ] != '\0' ) )
+    {
+        return false;
+    }
+
+    TimingTolerance windows[ 4 ];
+
+    for( int w = 0; w < 4; ++w )
+    {
+        const double minimum = ns[ w * 3 ], nominal = ns[ w * 3 + 1 ], maximum = ns[ w * 3 + 2 ];
+
+        if( ( minimum < 0.0 ) || ( minimum > nominal ) || ( nominal > maximum ) || ( maximum <= 0.0 ) )
+        {
+            return false;
+        }
+
+        windows[ w ] = TimingTolerance( minimum * 1e-9, nominal * 1e-9, maximum * 1e-9 );
+    }
+
+    timing[ BIT_LOW ] = BitTiming( windows[ 0 ], windows[ 1 ] );
+    timing[ BIT_HIGH ] = BitTiming( windows[ 2 ], windows[ 3 ] );
+    return true;
+}
+
+std::vector<LedControllerData> CreateControllerData()
+{
+    // order of values here must correspond to the Controller enum of
+    // AsyncRgbLedAnalyzerSettings
+    return {
+        // name, description, bits per channel, channels per frame, reset time nsec, low-speed data nsec, has high speed, high speed data
+        // nsec, color layout
+
+        // https://cdn-shop.adafruit.com/datasheets/WS2811.pdf
+        { "WS2811",
+          "Worldsemi 24-bit RGB controller",
+          8,
+          3,
+          { 50_us, 50_us, 50_us },
+          {
+              // low-speed times
+              { { 350_ns, 500_ns, 650_ns }, { 1850_ns, 2000_ns, 2150_ns } },    // 0-bit times
+              { { 1050_ns, 1200_ns, 1350_ns }, { 1150_ns, 1300_ns, 1450_ns } }, // 1-bit times
+          },
+          true,
+          {
+              // high-speed times
+              { { 175_ns, 250_ns, 325_ns }, { 925_ns, 1000_ns, 1075_ns } }, // 0-bit times
+              { { 525_ns, 600_ns, 675_ns }, { 1225_ns, 1300_ns, 1375_ns } } // 1-bit times
+          },
+          LAYOUT_RGB },
+        // https://cdn-shop.adafruit.com/datasheets/WS2812B.pdf
+        // http://www.seeedstudio.com/document/pdf/WS2812B%20Datasheet.pdf
+        { "WS2812B",
+          "Worldsemi 24-bit RGB integrated light-source",
+          8,
+          3,
+          { 50_us, 50_us, 50_us },
+          {
+              // low-speed times
+              { { 200_ns, 400_ns, 550_ns }, { 700_ns, 850_ns, 1050_ns } }, // 0-bit times
+              { { 650_ns, 800_ns, 1050_ns }, { 200_ns, 450_ns, 600_ns } }, // 1-bit times
+          },
+          false,
+          { {}, {} },
+          LAYOUT_GRB },
+
+        // http://www.led-color.com/upload/201609/WS2813%20LED.pdf
+        { "WS2813",
+          "Worldsemi 24-bit RGB integrated light-source",
+          8,
+          3,
+          { 50_us, 50_us, 50_us },
+          {
+              // low-speed times
+              { { 300_ns, 375_ns, 450_ns }, { 300_ns, 875_ns, 100_us } },  // 0-bit times
+              { { 750_ns, 875_ns, 1000_ns }, { 300_ns, 375_ns, 100_us } }, // 1-bit times
+          },
+          false,
+          { {}, {} },
+          LAYOUT_GRB },
+
+        // https://www.deskontrol.net/descargas/datasheets/TM1809.pdf
+        { "TM1809",
+          "Titan Micro 9-chanel 24-bit RGB controller",
+          8,
+          9,
+          { 24_us, 24_us, 1.0 },
+          {
+              // low-speed times
+              { { 450_ns, 600_ns, 750_ns }, { 1050_ns, 1200_ns, 1350_ns } }, // 0-bit times
+              { { 1050_ns, 1200_ns, 1350_ns }, { 450_ns, 600_ns, 750_ns } }, // 1-bit times
+          },
+          true,
+          {
+              // high-speed times
+              { { 250_ns, 320_ns, 390_ns }, { 530_ns, 600_ns, 670_ns } }, // 0-bit times
+              { { 530_ns, 600_ns, 670_ns }, { 250_ns, 320_ns, 390_ns } }  // 1-bit times
+          },
+          LAYOUT_RGB },
+
+        // https://www.deskontrol.net/descargas/datasheets/TM1804.pdf
+        { "TM1804",
+          "Titan Micro 24-bit RGB controller",
+          8,
+          3,
+          { 10_us, 10_us, 1.0 },
+          {
+              // low-speed times
+              { { 850_ns, 1_us, 1150_ns }, { 1850_ns, 2_us, 2150_ns } }, // 0-bit times
+              { { 1850_ns, 2_us, 2150_ns }, { 850_ns, 1_us, 1150_ns } }, // 1-bit times
+          },
+          false,
+          { {}, {} },
+          LAYOUT_RGB },
+
+        // http://www.bestlightingbuy.com/pdf/UCS1903%20datasheet.pdf
+        { "UCS1903",
+          "UCS1903 24-bit RGB controller",
+          8,
+          3,
+          { 24_us, 24_us, 1.0 },
+          {
+              // low-speed times
+              { { 350_ns, 500_ns, 650_ns }, { 1850_ns, 2000_ns, 2150_ns } }, // 0-bit times
+              { { 1850_ns, 2000_ns, 2150_ns }, { 350_ns, 500_ns, 650_ns } }, // 1-bit times
+          },
+          true,
+          {
+              // high-speed times
+              { { 175_ns, 250_ns, 325_ns }, { 925_ns, 1000_ns, 1075_ns } }, // 0-bit times
+              { { 925_ns, 1000_ns, 1075_ns }, { 175_ns, 250_ns, 325_ns } }  // 1-bit times
+          },
+          LAYOUT_RGB },
+
+        // https://www.syncrolight.co.uk/datasheets/LPD1886%20datasheet.pdf
+        { "LPD1886 - 24 bit",
+          "LPD1886 RGB controller in 24-bit mode",
+          8,
+          3,
+          { 24_us, 30_us, 1.0 },
+          {
+              // low-speed times
+              { { 150_ns, 200_ns, 280_ns }, { 500_ns, 600_ns, 10_us } }, // 0-bit times
+              { { 450_ns, 600_ns, 9_us }, { 150_ns, 200_ns, 10_us } },   // 1-bit times
+          },
+          false,
+          { {}, {} },
+          LAYOUT_RGB },
+
+        { "LPD1886 - 36 bit",
+          "LPD1886 RGB controller in 36-bit mode",
+          12,
+          3,
+          { 24_us, 30_us, 1.0 },
+          {
+              // low-speed times
+              { { 150_ns, 200_ns, 280_ns }, { 500_ns, 600_ns, 10_us } }, // 0-bit times
+              { { 450_ns, 600_ns, 9_us }, { 150_ns, 200_ns, 10_us } },   // 1-bit times
+          },
+          false,
+          { {}, {} },
+          LAYOUT_RGB },
+
+        // timing from the Custom settings, see
+        // AsyncRgbLedAnalyzerSettings::SetCustomControllerFromInterfaces.
+        // Starts out with the WS2812B values.
+        { "Custom",
+          "Controller timing entered in the Custom settings",
+          8,
+          3,
+          { 50_us, 50_us, 1.0 },
+          {
+              // low-speed times
+              { { 200_ns, 400_ns, 550_ns }, { 700_ns, 850_ns, 1050_ns } }, // 0-bit times
+              { { 650_ns, 800_ns, 1050_ns }, { 200_ns, 450_ns, 600_ns } }, // 1-bit times
+          },
+          false,
+          { {}, {} },
+          LAYOUT_GRB },
+    };
+}
+
+ControllerTimingTable BuildControllerTimingTable( const LedControllerData& c, double sampleRateHz )
+{
+    ControllerTimingTable table;
+    table.mHasHighSpeed = c.mHasHighSpeed;
+
+    for( const auto b : { BIT_LOW, BIT_HIGH } )
+    {
+        table.mData[ 0 ][ b ].mPositive = SampleWindow( c.mDataTiming[ b ].mPositiveTiming, sampleRateHz );
+        table.mData[ 0 ][ b ].mNegative = SampleWindow( c.mDataTiming[ b ].mNegativeTiming, sampleRateHz );
+
+        if( c.mHasHighSpeed )
+        {
+            table.mData[ 1 ][ b ].mPositive = SampleWindow( c.mDataTimingHighSpeed[ b ].mPositiveTiming, sampleRateHz );
+            table.mData[ 1 ][ b ].mNegative = SampleWindow( c.mDataTimingHighSpeed[ b ].mNegativeTiming, sampleRateHz );
+        }
+    }
+
+    // a low is a reset once it lasts strictly longer than the minimum, so
+    // the threshold is the longest low which doesn't
+    table.mMinimumResetSamples = SamplesNotExceeding( c.mResetTiming.mMinimumSec, sampleRateHz );
+
+    double minimumLowSec =
+        std::min( c.mDataTiming[ BIT_LOW ].mNegativeTiming.mMinimumSec, c.mDataTiming[ BIT_HIGH ].mNegativeTiming.mMinimumSec );
+
+    if( c.mHasHighSpeed )
+    {
+        minimumLowSec = std::min( c.mDataTimingHighSpeed[ BIT_LOW ].mNegativeTiming.mMinimumSec,
+                                  c.mDataTimingHighSpeed[ BIT_HIGH ].mNegativeTiming.mMinimumSec );
+    }
+
+    // a threshold rather than a window, so it is truncated
+    table.mMinimumLowSamples = static_cast<U64>( minimumLowSec * sampleRateHz );
+    return table;
+}
@@ -0,0 +1,42 @@
+#ifndef ASYNCRGBLED_CONTROLLERS_H
+#define ASYNCRGBLED_CONTROLLERS_H
+
+#include <string>
+#include <vector>
+
+#include <AnalyzerTypes.h>
+
+#include "AsyncRgbLedHelpers.h"
+
+// we can't do direct defualt initialisation here, since according to C++11
+// that makes this type non-POD and hence unsuitable for direct initialisation.
+// C++14 fixes this.
+struct LedControllerData
+{
+    std::string mName;
+    std::string mDescription;
+    U8 mBitsPerChannel; // = 8;
+    U8 mChannelCount;   // = 3;
+    TimingTolerance mResetTiming;
+    BitTiming mDataTiming[ 2 ]; // BIT_HIGH and BIT_LOW
+
+    bool mHasHighSpeed;                  // = true
+    BitTiming mDataTimingHighSpeed[ 2 ]; // BIT_HIGH and BIT_LOW
+
+    ColorLayout mLayout; // = LAYOUT_RGB
+};
+
+/// The built-in controllers, followed by the Custom controller entry
+std::vector<LedControllerData> CreateControllerData();
+
+ControllerTimingTable BuildControllerTimingTable( const LedControllerData& controller, double sampleRateHz );
+
+/**
+ * Bit timing as text: four min/nominal/max windows in nanoseconds, in the
+ * order 0-bit high, 0-bit low, 1-bit high, 1-bit low. For example the
+ * WS2812B: "200/400/550, 700/850/1050, 650/800/1050, 200/450/600"
+ */
+std::string FormatBitTimings( const BitTiming timing[ 2 ] );
+bool ParseBitTimings( const char* text, BitTiming timing[ 2 ] );
+
+#endif // ASYNCRGBLED_CONTROLLERS_H
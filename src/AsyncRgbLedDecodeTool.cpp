@@ -0,0 +1,634 @@
+// Command-line decoder for digital captures exported from Logic 2, using the
+// same decoding code as the analyzer. Runs one file per thread.
+
+#include <algorithm> // for std::min, std::max
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <strings.h> // for strcasecmp
+
+#include "AsyncRgbLedCaptureFile.h"
+#include "AsyncRgbLedControllers.h"
+#include "AsyncRgbLedDecoder.h"
+#include "AsyncRgbLedPixelFile.h"
+#include "AsyncRgbLedResultsText.h" // for ParseExportWindow
+
+namespace
+{
+    enum OutputFormat
+    {
+        FORMAT_CSV,
+        FORMAT_BINARY
+    };
+
+    struct ToolOptions
+    {
+        double mSampleRateHz = 0.0;
+        LedControllerData mController;
+        OutputFormat mFormat = FORMAT_CSV;
+        std::string mOutputDirectory;
+        unsigned mJobs = 0;
+        bool mVerbose = false;
+        std::vector<std::string> mInputs;
+
+        // decoded and written first, in seconds of capture time
+        bool mHasWindow = false;
+        double mWindowBeginSec = 0.0;
+        double mWindowEndSec = 0.0;
+    };
+
+    /// the packets overlapping [ mBeginSample, mEndSample ]
+    struct PacketWindow
+    {
+        U64 mBeginSample = 0;
+        U64 mEndSample = ~U64( 0 );
+    };
+
+    struct FileResult
+    {
+        bool mOk = false;
+        std::string mError;
+        std::string mOutputPath;
+        U64 mPackets = 0;
+        U64 mPixels = 0;
+        U64 mErrors = 0;
+        double mCaptureSec = 0.0;
+        double mElapsedSec = 0.0;
+
+        std::string mWindowOutputPath;
+        U64 mWindowPackets = 0;
+        U64 mWindowPixels = 0;
+        U64 mCheckpoints = 0;
+        double mWindowElapsedSec = 0.0;
+    };
+
+    void PrintUsage()
+    {
+        std::printf( "usage: async_rgb_led_decode --sample-rate HZ [options] capture.bin [capture.bin ...]\n"
+                     "\n"
+                     "Decodes Logic 2 binary digital exports of addressable LED data.\n"
+                     "\n"
+                     "  --sample-rate HZ          sample rate of the captures (required)\n"
+                     "  --controller NAME         controller, see --list-controllers (default WS2811)\n"
+                     "  --timing TEXT             bit timing of a custom controller, as in the Custom\n"
+                     "                            analyzer setting; selects the Custom controller\n"
+                     "  --high-speed-timing TEXT  high-speed bit timing of a custom controller\n"
+                     "  --bits N                  bits per channel of a custom controller\n"
+                     "  --layout rgb|grb          color order of a custom controller\n"
+                     "  --reset-us N              reset time of a custom controller, in microseconds\n"
+                     "  --format csv|binary       output format (default csv)\n"
+                     "  --output-dir DIR          where to write outputs (default: next to the inputs)\n"
+                     "  --jobs N                  files decoded in parallel (default: one per core)\n"
+                     "  --window BEGIN,END        first decode the packets in this time window, in\n"
+                     "                            seconds as in the output, into *.window.pixels.*\n"
+                     "  --verbose                 report every timing error\n"
+                     "  --list-controllers        list the supported controllers\n" );
+    }
+
+    bool SelectController( const char* name, LedControllerData& controller )
+    {
+        for( const LedControllerData& c : CreateControllerData() )
+        {
+            if( ::strcasecmp( c.mName.c_str(), name ) == 0 )
+            {
+                controller = c;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool ParseOptions( int argc, char** argv, ToolOptions& options )
+    {
+        const std::vector<LedControllerData> controllers = CreateControllerData();
+        options.mController = controllers.front();
+        const LedControllerData& custom = controllers.back();
+        bool isCustom = false;
+
+        for( int i = 1; i < argc; ++i )
+        {
+            const std::string arg = argv[ i ];
+            const bool hasValue = ( i + 1 < argc );
+
+            if( arg == "--list-controllers" )
+            {
+                for( const LedControllerData& c : controllers )
+                {
+                    std::printf( "%-20s %s\n", c.mName.c_str(), c.mDescription.c_str() );
+                }
+
+                std::exit( EXIT_SUCCESS );
+            }
+            else if( arg == "--verbose" )
+            {
+                options.mVerbose = true;
+            }
+            else if( arg == "--help" || arg == "-h" )
+            {
+                PrintUsage();
+                std::exit( EXIT_SUCCESS );
+            }
+            else if( arg.compare( 0, 2, "--" ) == 0 )
+            {
+                if( !hasValue )
+                {
+                    std::fprintf( stderr, "missing value for %s\n", arg.c_str() );
+                    return false;
+                }
+
+                const char* value = argv[ ++i ];
+
+                if( arg == "--sample-rate" )
+                {
+                    options.mSampleRateHz = std::atof( value );
+                }
+                else if( arg == "--controller" )
+                {
+                    if( !SelectController( value, options.mController ) )
+                    {
+                        std::fprintf( stderr, "unknown controller: %s\n", value );
+                        return false;
+                    }
+                }
+                else if( arg == "--timing" || arg == "--high-speed-timing" || arg == "--bits" || arg == "--layout" || arg == "--reset-us" )
+                {
+                    if( !isCustom )
+                    {
+                        options.mController = custom;
+                        isCustom = true;
+                    }
+
+                    LedControllerData& c = options.mController;
+
+                    if( arg == "--timing" && !ParseBitTimings( value, c.mDataTiming ) )
+                    {
+                        std::fprintf( stderr, "invalid timing: %s\n", value );
+                        return false;
+                    }
+                    else if( arg == "--high-speed-timing" )
+                    {
+                        c.mHasHighSpeed = ParseBitTimings( value, c.mDataTimingHighSpeed );
+
+                        if( !c.mHasHighSpeed )
+                        {
+                            std::fprintf( stderr, "invalid high-speed timing: %s\n", value );
+                            return false;
+                        }
+                    }
+                    else if( arg == "--bits" )
+                    {
+                        c.mBitsPerChannel = static_cast<U8>( std::min( 16, std::max( 8, std::atoi( value ) ) ) );
+                    }
+                    else if( arg == "--layout" )
+                    {
+                        c.mLayout = ( ::strcasecmp( value, "grb" ) == 0 ) ? LAYOUT_GRB : LAYOUT_RGB;
+                    }
+                    else if( arg == "--reset-us" )
+                    {
+                        const double resetSec = std::atof( value ) * 1e-6;
+                        c.mResetTiming = TimingTolerance( resetSec, resetSec, 1.0 );
+                    }
+                }
+                else if( arg == "--format" )
+                {
+                    options.mFormat = ( std::strcmp( value, "binary" ) == 0 ) ? FORMAT_BINARY : FORMAT_CSV;
+                }
+                else if( arg == "--output-dir" )
+                {
+                    options.mOutputDirectory = value;
+                }
+                else if( arg == "--jobs" )
+                {
+                    options.mJobs = static_cast<unsigned>( std::max( 1, std::atoi( value ) ) );
+                }
+                else if( arg == "--window" )
+                {
+                    options.mHasWindow = ParseExportWindow( value, options.mWindowBeginSec, options.mWindowEndSec );
+
+                    if( !options.mHasWindow )
+                    {
+                        std::fprintf( stderr, "invalid window, expected BEGIN,END in seconds: %s\n", value );
+                        return false;
+                    }
+                }
+                else
+                {
+                    std::fprintf( stderr, "unknown option: %s\n", arg.c_str() );
+                    return false;
+                }
+            }
+            else
+            {
+                options.mInputs.push_back( arg );
+            }
+        }
+
+        if( options.mSampleRateHz <= 0.0 || options.mInputs.empty() )
+        {
+            PrintUsage();
+            return false;
+        }
+
+        if( options.mJobs == 0 )
+        {
+            options.mJobs = std::max( 1u, std::thread::hardware_concurrency() );
+        }
+
+        return true;
+    }
+
+    std::string OutputPath( const std::string& input, const ToolOptions& options, const char* suffix = ".pixels" )
+    {
+        std::string base = input;
+
+        if( !options.mOutputDirectory.empty() )
+        {
+            const size_t slash = base.find_last_of( '/' );
+            base = options.mOutputDirectory + "/" + ( slash == std::string::npos ? base : base.substr( slash + 1 ) );
+        }
+
+        const size_t dot = base.find_last_of( '.' );
+        const size_t slash = base.find_last_of( '/' );
+
+        if( dot != std::string::npos && ( slash == std::string::npos || dot > slash ) )
+        {
+            base.erase( dot );
+        }
+
+        return base + suffix + ( options.mFormat == FORMAT_CSV ? ".csv" : ".bin" );
+    }
+
+    /// the pixel output of a capture, or of its window, as CSV or binary
+    class PixelOutput
+    {
+      public:
+        ~PixelOutput()
+        {
+            if( mFile )
+            {
+                ::fclose( mFile );
+            }
+        }
+
+        bool Open( const std::string& path, const Logic2CaptureFile& capture, const ToolOptions& options, std::string& error )
+        {
+            mPath = path;
+            mBeginTimeSec = capture.BeginTimeSec();
+            mSampleRateHz = options.mSampleRateHz;
+            mBitSize = options.mController.mBitsPerChannel;
+            mIsCsv = ( options.mFormat == FORMAT_CSV );
+
+            if( !mIsCsv )
+            {
+                if( !mBinary.Open( path, mBitSize, mSampleRateHz ) )
+                {
+                    error = "can't create " + path;
+                    return false;
+                }
+
+                return true;
+            }
+
+            mFile = ::fopen( path.c_str(), "w" );
+
+            if( !mFile )
+            {
+                error = "can't create " + path;
+                return false;
+            }
+
+            mBuffer.resize( 1 << 20 );
+            ::setvbuf( mFile, mBuffer.data(), _IOFBF, mBuffer.size() );
+
+            // same columns as the analyzer's text/csv export
+            std::fprintf( mFile, "Time [s], Packet ID, LED Index, Red, Green, Blue, Web-CSS\n" );
+            return true;
+        }
+
+        void Write( U64 packetId, const DecodedPacket& packet )
+        {
+            ++mPackets;
+            mPixels += packet.mPixels.size();
+
+            if( !mIsCsv )
+            {
+                mBinary.WritePacket( packetId, packet );
+                return;
+            }
+
+            U32 ledIndex = 0;
+
+            for( const DecodedPixel& pixel : packet.mPixels )
+            {
+                U8 webColor[ 3 ];
+                pixel.mRGB.ConvertTo8Bit( mBitSize, webColor );
+                const double timeSec = mBeginTimeSec + pixel.mBeginSample / mSampleRateHz;
+
+                std::fprintf( mFile, "%.9f,%llu,%u,%u,%u,%u,#%02x%02x%02x\n", timeSec, static_cast<unsigned long long>( packetId ),
+                              ledIndex++, pixel.mRGB.red, pixel.mRGB.green, pixel.mRGB.blue, webColor[ 0 ], webColor[ 1 ], webColor[ 2 ] );
+            }
+        }
+
+        bool Close( std::string& error )
+        {
+            bool ok = true;
+
+            if( mIsCsv )
+            {
+                ok = ( ::ferror( mFile ) == 0 );
+                ok = ( ::fclose( mFile ) == 0 ) && ok;
+                mFile = nullptr;
+            }
+            else
+            {
+                ok = mBinary.Close();
+            }
+
+            if( !ok )
+            {
+                error = "failed writing " + mPath;
+            }
+
+            return ok;
+        }
+
+        U64 Packets() const
+        {
+            return mPackets;
+        }
+
+        U64 Pixels() const
+        {
+            return mPixels;
+        }
+
+      private:
+        std::string mPath;
+        bool mIsCsv = true;
+        FILE* mFile = nullptr;
+        std::vector<char> mBuffer;
+        PixelFileWriter mBinary;
+        double mBeginTimeSec = 0.0;
+        double mSampleRateHz = 0.0;
+        U8 mBitSize = 8;
+        U64 mPackets = 0;
+        U64 mPixels = 0;
+    };
+
+    /// the packets decoded between two reset checkpoints around the window,
+    /// kept for the full pass so that it doesn't decode them again
+    struct WindowRun
+    {
+        bool mHasBegin = false; // false if the run starts with the capture
+        U64 mBeginGapSample = 0;
+        U64 mBeginGapEndSample = 0;
+        U64 mFirstPacketId = 0;
+
+        bool mHasEnd = false; // false if the run ends with the capture
+        U64 mEndGapTransition = 0;
+
+        std::vector<DecodedPacket> mPackets;
+        U64 mErrors = 0;
+    };
+
+    void ConfigureDecoder( AsyncRgbLedDecoder& decoder, Logic2CaptureFile& capture, const ToolOptions& options )
+    {
+        const LedControllerData& controller = options.mController;
+        decoder.Configure( BuildControllerTimingTable( controller, options.mSampleRateHz ), controller.mBitsPerChannel, controller.mLayout,
+                           options.mSampleRateHz );
+        decoder.SetSource( &capture );
+        decoder.SetLogErrors( options.mVerbose );
+    }
+
+    /**
+     * Decodes the packets of the window before anything else. A scan of the
+     * reset gaps, which only compares transition times, finds the last reset
+     * before the window and the first one after it; decoding runs between the
+     * two, starting in the same state as after any other reset, rather than
+     * from the start of the capture. Each reset before the run counts as one
+     * packet, so packet IDs match the full output as long as every reset is
+     * followed by a packet which decodes.
+     */
+    bool DecodeWindow( const std::string& path, const ToolOptions& options, WindowRun& run, FileResult& result )
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        Logic2CaptureFile capture;
+
+        if( !capture.Open( path, options.mSampleRateHz, result.mError ) )
+        {
+            return false;
+        }
+
+        const ControllerTimingTable timing = BuildControllerTimingTable( options.mController, options.mSampleRateHz );
+        std::vector<ResetCheckpoint> checkpoints;
+        capture.ScanResetGaps( timing.mMinimumResetSamples, checkpoints );
+        result.mCheckpoints = checkpoints.size();
+
+        auto toSample = [&]( double timeSec ) {
+            return static_cast<U64>( std::max( 0.0, ( timeSec - capture.BeginTimeSec() ) * options.mSampleRateHz ) );
+        };
+
+        PacketWindow window;
+        window.mBeginSample = toSample( options.mWindowBeginSec );
+        window.mEndSample = toSample( options.mWindowEndSec );
+
+        // the packet overlapping the start of the window starts after the last
+        // reset gap ending at or before it, and no packet after the first gap
+        // starting past its end overlaps it
+        auto next = std::upper_bound( checkpoints.begin(), checkpoints.end(), window.mBeginSample,
+                                      []( U64 sample, const ResetCheckpoint& c ) { return sample < c.mGapEndSample; } );
+        auto after = std::upper_bound( next, checkpoints.end(), window.mEndSample,
+                                       []( U64 sample, const ResetCheckpoint& c ) { return sample < c.mGapBeginSample; } );
+
+        // the decoder also takes a long enough low level at the start of the
+        // capture as a reset, which the scan leaves out
+        const bool startsWithReset = ( capture.GetBitState() == BIT_LOW ) && capture.HasNextTransition() &&
+                                     ( capture.GetSampleOfNextEdge() - capture.GetSampleNumber() > timing.mMinimumResetSamples );
+
+        AsyncRgbLedDecoder decoder;
+        ConfigureDecoder( decoder, capture, options );
+
+        if( next != checkpoints.begin() )
+        {
+            const ResetCheckpoint& begin = *( next - 1 );
+            capture.SeekToTransition( begin.mGapTransition );
+            run.mHasBegin = true;
+            run.mBeginGapSample = begin.mGapBeginSample;
+            run.mBeginGapEndSample = begin.mGapEndSample;
+            run.mFirstPacketId = static_cast<U64>( next - 1 - checkpoints.begin() ) + ( startsWithReset ? 1 : 0 );
+        }
+
+        run.mHasEnd = ( after != checkpoints.end() );
+        const U64 endSample = run.mHasEnd ? after->mGapEndSample : ~U64( 0 );
+
+        if( run.mHasEnd )
+        {
+            run.mEndGapTransition = after->mGapTransition;
+        }
+
+        PixelOutput output;
+        result.mWindowOutputPath = OutputPath( path, options, ".window.pixels" );
+
+        if( !output.Open( result.mWindowOutputPath, capture, options, result.mError ) )
+        {
+            return false;
+        }
+
+        DecodedPacket packet;
+
+        // the packet starting after the end gap is left to the full pass
+        while( decoder.DecodePacket( packet ) && ( packet.mSummary.mBeginSample < endSample ) )
+        {
+            if( ( packet.mSummary.mEndSample >= window.mBeginSample ) && ( packet.mSummary.mBeginSample <= window.mEndSample ) )
+            {
+                output.Write( run.mFirstPacketId + run.mPackets.size(), packet );
+            }
+
+            run.mPackets.push_back( packet );
+        }
+
+        run.mErrors = decoder.ErrorCount();
+        result.mWindowPackets = output.Packets();
+        result.mWindowPixels = output.Pixels();
+        result.mWindowElapsedSec = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        return output.Close( result.mError );
+    }
+
+    FileResult DecodeFile( const std::string& path, const ToolOptions& options )
+    {
+        FileResult result;
+        const auto start = std::chrono::steady_clock::now();
+        WindowRun run;
+
+        if( options.mHasWindow )
+        {
+            if( !DecodeWindow( path, options, run, result ) )
+            {
+                return result;
+            }
+
+            // report it right away, the rest of the capture takes longer
+            std::printf( "%s: window of %llu packets, %llu pixels in %.3f s, %llu reset checkpoints -> %s\n", path.c_str(),
+                         static_cast<unsigned long long>( result.mWindowPackets ), static_cast<unsigned long long>( result.mWindowPixels ),
+                         result.mWindowElapsedSec, static_cast<unsigned long long>( result.mCheckpoints ), result.mWindowOutputPath.c_str() );
+            std::fflush( stdout );
+        }
+
+        Logic2CaptureFile capture;
+
+        if( !capture.Open( path, options.mSampleRateHz, result.mError ) )
+        {
+            return result;
+        }
+
+        PixelOutput output;
+        result.mOutputPath = OutputPath( path, options );
+
+        if( !output.Open( result.mOutputPath, capture, options, result.mError ) )
+        {
+            return result;
+        }
+
+        AsyncRgbLedDecoder decoder;
+        ConfigureDecoder( decoder, capture, options );
+        DecodedPacket packet;
+        U64 packetId = 0;
+
+        if( options.mHasWindow )
+        {
+            // up to the run, which the window pass decoded already. A decoder
+            // resynchronising after an error may run into it, that packet is
+            // then taken from the run as well.
+            while( run.mHasBegin && ( capture.GetSampleNumber() < run.mBeginGapSample ) && decoder.DecodePacket( packet ) &&
+                   ( packet.mSummary.mBeginSample < run.mBeginGapEndSample ) )
+            {
+                output.Write( packetId++, packet );
+            }
+
+            for( const DecodedPacket& p : run.mPackets )
+            {
+                output.Write( packetId++, p );
+            }
+
+            result.mErrors = decoder.ErrorCount() + run.mErrors;
+
+            // carry on after the run, in the state after its last reset
+            ConfigureDecoder( decoder, capture, options );
+
+            if( run.mHasEnd )
+            {
+                capture.SeekToTransition( run.mEndGapTransition );
+            }
+        }
+
+        while( ( !options.mHasWindow || run.mHasEnd ) && decoder.DecodePacket( packet ) )
+        {
+            output.Write( packetId++, packet );
+        }
+
+        result.mErrors += decoder.ErrorCount();
+        result.mPackets = output.Packets();
+        result.mPixels = output.Pixels();
+        result.mOk = output.Close( result.mError );
+        result.mCaptureSec = capture.EndSample() / options.mSampleRateHz;
+        result.mElapsedSec = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        return result;
+    }
+}
+
+int main( int argc, char** argv )
+{
+    ToolOptions options;
+
+    if( !ParseOptions( argc, argv, options ) )
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<FileResult> results( options.mInputs.size() );
+    std::atomic<size_t> nextInput( 0 );
+    std::vector<std::thread> workers;
+
+    for( unsigned j = 0; j < std::min<size_t>( options.mJobs, options.mInputs.size() ); ++j )
+    {
+        workers.emplace_back( [&]() {
+            for( size_t i = nextInput++; i < options.mInputs.size(); i = nextInput++ )
+            {
+                results[ i ] = DecodeFile( options.mInputs[ i ], options );
+            }
+        } );
+    }
+
+    for( std::thread& worker : workers )
+    {
+        worker.join();
+    }
+
+    int status = EXIT_SUCCESS;
+
+    for( size_t i = 0; i < results.size(); ++i )
+    {
+        const FileResult& r = results[ i ];
+
+        if( !r.mOk )
+        {
+            std::fprintf( stderr, "%s: %s\n", options.mInputs[ i ].c_str(), r.mError.c_str() );
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        std::printf( "%s: %llu packets, %llu pixels, %llu errors, %.3f s of capture in %.3f s -> %s\n", options.mInputs[ i ].c_str(),
+                     static_cast<unsigned long long>( r.mPackets ), static_cast<unsigned long long>( r.mPixels ),
+                     static_cast<unsigned long long>( r.mErrors ), r.mCaptureSec, r.mElapsedSec, r.mOutputPath.c_str() );
+    }
+
+    return status;
+}
@@ -0,0 +1,616 @@
+#include "AsyncRgbLedDecoder.h"
+
+#include "AsyncRgbLedForwarding.h"
+#include "AsyncRgbLedTimingMargins.h"
+
+#include <algorithm> // for std::min, std::max
+#include <iostream>
+#include <limits>
+
+void TransitionEdgeSource::Reset( BitState initialState, U64 transitionCount, U64 endSample )
+{
+    mTransitionCount = transitionCount;
+    mNextTransition = 0;
+    mSampleNumber = 0;
+    mEndSample = endSample;
+    mInitialState = initialState;
+    mBitState = initialState;
+}
+
+U64 TransitionEdgeSource::GetSampleNumber()
+{
+    return mSampleNumber;
+}
+
+BitState TransitionEdgeSource::GetBitState()
+{
+    return mBitState;
+}
+
+void TransitionEdgeSource::Advance( U32 numSamples )
+{
+    AdvanceToAbsPosition( mSampleNumber + numSamples );
+}
+
+void TransitionEdgeSource::AdvanceToAbsPosition( U64 sampleNumber )
+{
+    // a transition takes effect at its own sample number
+    while( ( mNextTransition < mTransitionCount ) && ( TransitionSample( mNextTransition ) <= sampleNumber ) )
+    {
+        mBitState = Toggle( mBitState );
+        ++mNextTransition;
+    }
+
+    mSampleNumber = std::max( mSampleNumber, sampleNumber );
+}
+
+void TransitionEdgeSource::AdvanceToNextEdge()
+{
+    if( mNextTransition < mTransitionCount )
+    {
+        mSampleNumber = std::max( mSampleNumber, TransitionSample( mNextTransition++ ) );
+        mBitState = Toggle( mBitState );
+    }
+    else
+    {
+        // no more edges, the line stays put until the end of the data
+        mSampleNumber = std::max( mSampleNumber, mEndSample );
+    }
+}
+
+U64 TransitionEdgeSource::GetSampleOfNextEdge()
+{
+    if( mNextTransition < mTransitionCount )
+    {
+        return TransitionSample( mNextTransition );
+    }
+
+    return std::max( mSampleNumber, mEndSample );
+}
+
+bool TransitionEdgeSource::WouldAdvancingCauseTransition( U32 numSamples )
+{
+    return ( mNextTransition < mTransitionCount ) && ( TransitionSample( mNextTransition ) <= mSampleNumber + numSamples );
+}
+
+void TransitionEdgeSource::SeekToTransition( U64 index )
+{
+    if( index >= mTransitionCount )
+    {
+        return;
+    }
+
+    // every transition toggles the level, so only the count matters
+    mNextTransition = index + 1;
+    mSampleNumber = TransitionSample( index );
+    mBitState = ( mNextTransition % 2 ) ? Toggle( mInitialState ) : mInitialState;
+}
+
+void TransitionEdgeSource::ScanResetGaps( U64 minimumSamples, std::vector<ResetCheckpoint>& checkpoints ) const
+{
+    checkpoints.clear();
+
+    // counting from zero, falling edges are the even-numbered transitions
+    // when the line starts high, the odd-numbered ones otherwise
+    U64 index = ( mInitialState == BIT_HIGH ) ? 0 : 1;
+
+    for( ; index < mTransitionCount; index += 2 )
+    {
+        const U64 gapBegin = TransitionSample( index );
+        const U64 gapEnd = ( index + 1 < mTransitionCount ) ? TransitionSample( index + 1 ) : std::max( gapBegin, mEndSample );
+
+        if( gapEnd - gapBegin > minimumSamples )
+        {
+            ResetCheckpoint checkpoint;
+            checkpoint.mGapTransition = index;
+            checkpoint.mGapBeginSample = gapBegin;
+            checkpoint.mGapEndSample = gapEnd;
+            checkpoints.push_back( checkpoint );
+        }
+    }
+}
+
+bool TransitionEdgeSource::AtEnd()
+{
+    return ( mNextTransition >= mTransitionCount ) && ( mSampleNumber >= mEndSample );
+}
+
+namespace
+{
+    // a low line is only idle once it lasts much longer than the gap between
+    // packets at typical refresh rates, so ordinary resets aren't reported
+    const double IDLE_MINIMUM_SEC = 0.1;
+
+    // steps across a span at the head of a live capture double in length up
+    // to this, so that a long span is reported in a few pieces while its
+    // progress never lags far behind
+    const double SPAN_STEP_MAXIMUM_SEC = 10.0;
+}
+
+void AsyncRgbLedDecoder::Configure( const ControllerTimingTable& timing, U8 bitSize, ColorLayout layout, double sampleRateHz )
+{
+    mTiming = timing;
+    mBitSize = bitSize;
+    mLayout = layout;
+    mSampleRateHz = sampleRateHz;
+
+    // no bit has a high pulse as long as a reset
+    mIdleSamples = std::max( timing.mMinimumResetSamples, static_cast<U64>( IDLE_MINIMUM_SEC * sampleRateHz ) );
+    mStuckSamples = std::max<U64>( timing.mMinimumResetSamples, 1 );
+    mSpanStepSamples = std::min<U64>( static_cast<U64>( SPAN_STEP_MAXIMUM_SEC * sampleRateHz ), std::numeric_limits<U32>::max() );
+    mIsWithinLevel = false;
+
+    mFirstBitAfterReset = false;
+    mDidDetectHighSpeed = false;
+    mIsResyncNeeded = true;
+    mErrorCount = 0;
+}
+
+void AsyncRgbLedDecoder::StartPacket()
+{
+    mFirstBitAfterReset = true;
+}
+
+bool AsyncRgbLedDecoder::DecodePacket( DecodedPacket& packet )
+{
+    packet.mPixels.clear();
+
+    while( !mSource->AtEnd() )
+    {
+        if( mIsResyncNeeded )
+        {
+            SynchronizeToReset();
+            mIsResyncNeeded = false;
+            continue;
+        }
+
+        StartPacket();
+
+        // data word reading loop
+        for( ;; )
+        {
+            const RGBResult result = ReadRGBTriple();
+
+            if( result.mValid )
+            {
+                DecodedPixel pixel;
+                pixel.mRGB = result.mRGB;
+                pixel.mBeginSample = result.mValueBeginSample;
+                pixel.mEndSample = result.mValueEndSample;
+                packet.mPixels.push_back( pixel );
+            }
+            else if( !result.mIsReset )
+            {
+                // something error occurred, let's resynchronise
+                mIsResyncNeeded = true;
+            } // a pixel cut short by a reset is dropped, the next packet follows
+
+            if( mIsResyncNeeded || result.mIsReset )
+            {
+                break;
+            }
+        }
+
+        if( !packet.mPixels.empty() )
+        {
+            PacketSummary& summary = packet.mSummary;
+            summary.mBeginSample = packet.mPixels.front().mBeginSample;
+            summary.mEndSample = packet.mPixels.back().mEndSample;
+            summary.mPixelCount = static_cast<U32>( packet.mPixels.size() );
+            summary.mBitCount = summary.mPixelCount * 3 * mBitSize;
+            summary.mHighSpeed = mDidDetectHighSpeed;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+U64 AsyncRgbLedDecoder::SkipLevel( bool canStopInSpan )
+{
+    const BitState level = mSource->GetBitState();
+    const U64 spanSamples = ( level == BIT_HIGH ) ? mStuckSamples : mIdleSamples;
+
+    if( !mIsWithinLevel )
+    {
+        mLevelBeginSample = mSource->GetSampleNumber();
+        mHasSpan = false;
+    }
+
+    mIsWithinLevel = false;
+    const U64 beginSample = mLevelBeginSample;
+
+    // at the head of a live capture, looking for the next edge waits for it,
+    // and a line holding its level to the end of the capture never gets one.
+    // Once the level is long enough to be a span, it is reported at every
+    // step, so that it shows up, and progress with it, while we wait.
+    while( mLineSpans && mLineSpanSink && mSource->IsAtCaptureHead() )
+    {
+        const U64 samples = mSource->GetSampleNumber() - beginSample;
+        const U64 step = ( samples <= spanSamples ) ? spanSamples + 1 - samples : std::max<U64>( std::min( samples, mSpanStepSamples ), 1 );
+
+        if( mSource->WouldAdvancingCauseTransition( static_cast<U32>( step ) ) )
+        {
+            break;
+        }
+
+        mSource->Advance( static_cast<U32>( step ) );
+        AddLineSpan( level, mSource->GetSampleNumber() - 1 );
+
+        if( canStopInSpan )
+        {
+            mIsWithinLevel = true;
+            return samples + step;
+        }
+
+        mLineSpanSink->UpdateLineSpans();
+    }
+
+    const U64 edgeSample = mSource->GetSampleOfNextEdge();
+
+    mSource->AdvanceToAbsPosition( edgeSample );
+
+    const U64 samples = edgeSample - beginSample;
+
+    if( mLineSpans && ( samples > spanSamples ) )
+    {
+        AddLineSpan( level, edgeSample - 1 );
+    }
+
+    return samples;
+}
+
+void AsyncRgbLedDecoder::AddLineSpan( BitState level, U64 endSample )
+{
+    if( !mHasSpan )
+    {
+        mHasSpan = true;
+        mSpanBeginSample = mLevelBeginSample;
+    }
+    else if( !mLineSpans->empty() && ( mLineSpans->back().mLevel == level ) && ( mLineSpans->back().mBeginSample == mSpanBeginSample ) )
+    {
+        // not taken by the owner yet
+        mLineSpans->back().mEndSample = endSample;
+        mSpanEndSample = endSample;
+        return;
+    }
+    else
+    {
+        mSpanBeginSample = mSpanEndSample + 1;
+    }
+
+    LineSpan span;
+    span.mLevel = level;
+    span.mBeginSample = mSpanBeginSample;
+    span.mEndSample = endSample;
+    mLineSpans->push_back( span );
+    mSpanEndSample = endSample;
+}
+
+void AsyncRgbLedDecoder::SynchronizeToReset()
+{
+    if( mSource->GetBitState() == BIT_HIGH )
+    {
+        SkipLevel();
+    }
+
+    // a recorded capture can end before we find one
+    while( !mSource->AtEnd() )
+    {
+        if( SkipLevel() > mTiming.mMinimumResetSamples )
+        {
+            // it's a reset, we are done. We are at the end of the reset,
+            // ready for the first ReadRGB / ReadBit
+            return;
+        }
+
+        // skip the high pulse, to the next falling edge, which is our next
+        // candidate for the beginning of a RESET
+        SkipLevel();
+    }
+}
+
+auto AsyncRgbLedDecoder::ReadRGBTriple() -> RGBResult
+{
+    U16 channels[ 3 ] = { 0, 0, 0 };
+    RGBResult result;
+    mDidTakeProvisional = false;
+
+    int channel = 0;
+
+    for( ; channel < 3; )
+    {
+        U16 value = 0;
+        int i = 0;
+
+        for( ; i < mBitSize; ++i )
+        {
+            mIsLastBitOfPixel = ( channel == 2 ) && ( i + 1 == mBitSize );
+
+            if( mIsLastBitOfPixel )
+            {
+                // what a provisional pixel is made of
+                mPendingChannels[ 0 ] = channels[ 0 ];
+                mPendingChannels[ 1 ] = channels[ 1 ];
+                mPendingChannels[ 2 ] = value;
+                mPendingBeginSample = result.mValueBeginSample;
+            }
+
+            auto bitResult = ReadBit();
+            mIsLastBitOfPixel = false;
+
+            if( !bitResult.mValid )
+            {
+                break;
+            }
+
+            // for the first bit of channel 0, record the beginning time
+            // for accurate frame positions in the results
+            if( ( i == 0 ) && ( channel == 0 ) )
+            {
+                result.mValueBeginSample = bitResult.mBeginSample;
+            }
+
+            result.mValueEndSample = bitResult.mEndSample;
+            // MSB first
+            value = static_cast<U16>( ( value << 1 ) | ( bitResult.mBitValue == BIT_HIGH ? 1 : 0 ) );
+            result.mIsReset = bitResult.mIsReset;
+
+            if( result.mIsReset && ( ( i + 1 < mBitSize ) || ( channel < 2 ) ) )
+            {
+                // the packet ended part way through the pixel, e.g. a bit
+                // was lost. Reading on would merge it with the next packet.
+                break;
+            }
+        }
+
+        if( i == mBitSize )
+        {
+            // we saw a complete channel, save it
+            channels[ channel++ ] = value;
+        }
+        else
+        {
+            // partial data due to reset or invalid timing, discard
+            break;
+        }
+    }
+
+    result.mIsProvisional = mDidTakeProvisional;
+
+    if( channel == 3 )
+    {
+        // we saw three complete channels, we can use this
+        result.mRGB = RGBValue::CreateFromControllerOrder( mLayout, channels );
+        result.mValid = true;
+    } // in all other cases, mValid stays false - no RGB data was written
+    else if( !mSource->AtEnd() )
+    {
+        ++mErrorCount;
+    }
+
+    return result;
+}
+
+auto AsyncRgbLedDecoder::ReadBit() -> ReadResult
+{
+    ReadResult result;
+    result.mValid = false;
+
+    if( mSource->GetBitState() == BIT_LOW )
+    {
+        SkipLevel();
+    }
+
+    result.mBeginSample = mSource->GetSampleNumber();
+
+    // a stuck line ends the packet without waiting for the falling edge,
+    // which synchronising skips to instead
+    const U64 highSamples = SkipLevel( true );
+
+    if( mSource->AtEnd() )
+    {
+        return result; // the data ended before a complete bit
+    }
+
+    const U64 fallingEdgeSample = mSource->GetSampleNumber();
+
+    if( highSamples > mStuckSamples )
+    {
+        if( mLogErrors )
+        {
+            std::cerr << "line stuck high for " << highSamples / mSampleRateHz << " s" << std::endl;
+        }
+
+        return result; // invalid result, reset required
+    }
+
+    if( mFirstBitAfterReset )
+    {
+        // we can't classify yet, need to wait until we have the low pulse timing
+    }
+    else
+    {
+        // clasify based on existing value
+        // ensure consistency with previously detected speed setting
+        if( mTiming.Data( BIT_LOW, mDidDetectHighSpeed ).mPositive.Contains( highSamples ) )
+        {
+            result.mBitValue = BIT_LOW;
+        }
+        else if( mTiming.Data( BIT_HIGH, mDidDetectHighSpeed ).mPositive.Contains( highSamples ) )
+        {
+            result.mBitValue = BIT_HIGH;
+        }
+        else
+        {
+            if( mLogErrors )
+            {
+                std::cerr << "positive pulse timing doesn't match detected speed mode" << std::endl;
+            }
+
+            mSource->AdvanceToAbsPosition( fallingEdgeSample );
+            return result; // invalid result, reset required
+        }
+
+        if( mIsLastBitOfPixel && mProvisionalSink && mSource->IsAtCaptureHead() )
+        {
+            // the pixel is complete but for the low phase, which would only be
+            // checked once more data arrives. Hand it out now, ending where the
+            // next bit could start at the earliest.
+            U16 pending[ 3 ] = { mPendingChannels[ 0 ], mPendingChannels[ 1 ],
+                                 static_cast<U16>( ( mPendingChannels[ 2 ] << 1 ) | ( result.mBitValue == BIT_HIGH ? 1 : 0 ) ) };
+
+            mDidTakeProvisional =
+                mProvisionalSink->AddProvisionalPixel( RGBValue::CreateFromControllerOrder( mLayout, pending ), mPendingBeginSample,
+                                                       fallingEdgeSample + std::max<U64>( mTiming.mMinimumLowSamples, 1 ) - 1 );
+        }
+    }
+
+    // check for a too-short low timing
+    if( mSource->WouldAdvancingCauseTransition( static_cast<U32>( mTiming.mMinimumLowSamples ) ) )
+    {
+        mSource->AdvanceToNextEdge();
+
+        if( mLogErrors )
+        {
+            std::cerr << "too show low pulse, invalid bit" << std::endl;
+        }
+
+        return result; // invalid result, reset required
+    }
+
+    // check for a low period exceeding the minimum reset time
+    // if we exceed that, this is a reset
+    const U32 minResetSamples = static_cast<U32>( mTiming.mMinimumResetSamples );
+
+    if( !mSource->WouldAdvancingCauseTransition( minResetSamples ) )
+    {
+        // if we see a single bit in between resets, we can't decode the speed,
+        // but this is meaningless anyway, so return an error
+        if( mFirstBitAfterReset )
+        {
+            if( mLogErrors )
+            {
+                std::cerr << "No complete bit between resets, can't decode" << std::endl;
+            }
+
+            return result; // return invalid
+        }
+
+        mSource->Advance( minResetSamples );
+        result.mIsReset = true;
+    }
+    else
+    {
+        // we saw a transition, let's see the timing
+        mSource->AdvanceToNextEdge();
+
+        // the -1 is so the end of this frame, and start of the next, don't
+        // overlap.
+        result.mEndSample = mSource->GetSampleNumber() - 1;
+    }
+
+    // measured as the classifier has always measured it, and recorded in the
+    // histograms the same way, so that margins agree with the decode
+    const U64 lowSamples = result.mIsReset ? 0 : result.mEndSample - fallingEdgeSample;
+
+    if( result.mIsReset )
+    {
+        // if this bit is also a reset, we can't check the low time since it
+        // will exceed the maximums, but we still want to accept that case
+        // as valid
+        result.mValid = true;
+
+        // use the nominal negative pulse timing for the frame ending.
+        result.mEndSample = fallingEdgeSample + mTiming.Data( result.mBitValue, mDidDetectHighSpeed ).mNegative.mNominal;
+    }
+    else if( mFirstBitAfterReset )
+    {
+        // two-way classification. This is necessary because the the 0-data
+        // positive pulse of low-speed mode can match the 1-data positive pulse
+        // in high speed mode, for some controllers. Hence we need to correlate
+        // the high and low times to detect the speed mode
+
+        // this also sets mBitValue correct as a side-effect of the detection
+        result.mValid = DetectSpeedMode( highSamples, lowSamples, result.mBitValue );
+    }
+    else
+    {
+        // already detected the speed mode, ensure consistency
+
+        if( mTiming.Data( result.mBitValue, mDidDetectHighSpeed ).mNegative.Contains( lowSamples ) )
+        {
+            // we are good
+            result.mValid = true;
+        }
+        else
+        {
+            // we could do further classification here on the error, eg speed mismatch,
+            // or bit value mismatch
+            if( mLogErrors )
+            {
+                std::cerr << "negative pulse timing doesn't match positive pulse" << std::endl;
+            }
+
+            result.mValid = false;
+        }
+    }
+
+    // once the speed mode is known, the bit value is too. Widths which fail
+    // the low-time check are still recorded, they land outside the window.
+    if( mTimingMargins && !mFirstBitAfterReset )
+    {
+        mTimingMargins->Add( mDidDetectHighSpeed, result.mBitValue, PULSE_HIGH, highSamples, result.mBeginSample );
+
+        if( !result.mIsReset )
+        {
+            mTimingMargins->Add( mDidDetectHighSpeed, result.mBitValue, PULSE_LOW, lowSamples, fallingEdgeSample );
+        }
+    }
+
+    if( mPulseWidths && result.mValid )
+    {
+        mPulseWidths->Add( result.mBitValue, fallingEdgeSample - result.mBeginSample );
+    }
+
+    return result;
+}
+
+bool AsyncRgbLedDecoder::DetectSpeedMode( U64 positiveSamples, U64 negativeSamples, BitState& value )
+{
+    mDidDetectHighSpeed = false;
+
+    // low speed bits
+    for( const auto b : { BIT_LOW, BIT_HIGH } )
+    {
+        if( mTiming.Data( b, false ).Contains( positiveSamples, negativeSamples ) )
+        {
+            value = b;
+            mFirstBitAfterReset = false;
+            return true;
+        }
+    }
+
+    if( mTiming.mHasHighSpeed )
+    {
+        // high speed bits
+        for( const auto b : { BIT_LOW, BIT_HIGH } )
+        {
+            if( mTiming.Data( b, true ).Contains( positiveSamples, negativeSamples ) )
+            {
+                mDidDetectHighSpeed = true;
+                value = b;
+                mFirstBitAfterReset = false;
+                return true;
+            }
+        }
+    } // of high-speed mode tests
+
+    if( mLogErrors )
+    {
+        std::cerr << "failed to classify: " << positiveSamples / mSampleRateHz << "/" << negativeSamples / mSampleRateHz << std::endl;
+    }
+
+    return false;
+}
+
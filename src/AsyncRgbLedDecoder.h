@@ -0,0 +1,309 @@
+#ifndef ASYNCRGBLED_DECODER_H
+#define ASYNCRGBLED_DECODER_H
+
+#include <vector>
+
+#include <AnalyzerTypes.h>
+
+#include "AsyncRgbLedHelpers.h"
+#include "AsyncRgbLedStatistics.h"
+
+class TimingMargins;
+struct PulseWidthTotals;
+
+/**
+ * @brief EdgeSource - the subset of AnalyzerChannelData the decoder relies on.
+ * Inside Logic this forwards to the SDK channel data, elsewhere it is backed by
+ * a list of transitions, so the same decoding code runs in both places.
+ */
+class EdgeSource
+{
+  public:
+    virtual ~EdgeSource() = default;
+
+    virtual U64 GetSampleNumber() = 0;
+    virtual BitState GetBitState() = 0;
+    virtual void Advance( U32 numSamples ) = 0;
+    virtual void AdvanceToAbsPosition( U64 sampleNumber ) = 0;
+    virtual void AdvanceToNextEdge() = 0;
+    virtual U64 GetSampleOfNextEdge() = 0;
+    virtual bool WouldAdvancingCauseTransition( U32 numSamples ) = 0;
+
+    /// true once all the data was consumed. Channel data inside Logic never
+    /// ends, the analyzer thread blocks waiting for more instead.
+    virtual bool AtEnd()
+    {
+        return false;
+    }
+
+    /// true when no later transition was captured yet, so looking for one
+    /// would wait for more data. Recorded data has everything from the start.
+    virtual bool IsAtCaptureHead()
+    {
+        return false;
+    }
+};
+
+/// a low level lasting longer than a reset. Decoding started at its falling
+/// edge is in the same clean state as after SynchronizeToReset.
+struct ResetCheckpoint
+{
+    U64 mGapTransition = 0;  // index of the falling edge starting the gap
+    U64 mGapBeginSample = 0; // sample of that edge
+    U64 mGapEndSample = 0;   // rising edge ending the gap, where a packet starts
+};
+
+/**
+ * @brief TransitionEdgeSource - an EdgeSource over a list of transition sample
+ * numbers, as found in recorded captures. Subclasses provide the storage.
+ */
+class TransitionEdgeSource : public EdgeSource
+{
+  public:
+    U64 GetSampleNumber() override;
+    BitState GetBitState() override;
+    void Advance( U32 numSamples ) override;
+    void AdvanceToAbsPosition( U64 sampleNumber ) override;
+    void AdvanceToNextEdge() override;
+    U64 GetSampleOfNextEdge() override;
+    bool WouldAdvancingCauseTransition( U32 numSamples ) override;
+    bool AtEnd() override;
+
+    /// false once the last transition was passed
+    bool HasNextTransition() const
+    {
+        return mNextTransition < mTransitionCount;
+    }
+
+    /// move to the transition, in constant time, whichever the current position
+    void SeekToTransition( U64 index );
+
+    /// every low level longer than minimumSamples, found by comparing the
+    /// transition samples without decoding the bits in between. The low level
+    /// before the first transition isn't included.
+    void ScanResetGaps( U64 minimumSamples, std::vector<ResetCheckpoint>& checkpoints ) const;
+
+  protected:
+    /// call once the transition storage is available
+    void Reset( BitState initialState, U64 transitionCount, U64 endSample );
+
+    /// sample number of a transition, in increasing order
+    virtual U64 TransitionSample( U64 index ) const = 0;
+
+  private:
+    U64 mTransitionCount = 0;
+    U64 mNextTransition = 0;
+    U64 mSampleNumber = 0;
+    U64 mEndSample = 0;
+    BitState mInitialState = BIT_LOW;
+    BitState mBitState = BIT_LOW;
+};
+
+struct DecodedPixel
+{
+    RGBValue mRGB;
+    U64 mBeginSample = 0;
+    U64 mEndSample = 0;
+};
+
+/// a stretch where the line held one level for far longer than any bit: low
+/// is an idle line, high a stuck one
+struct LineSpan
+{
+    BitState mLevel = BIT_LOW;
+    U64 mBeginSample = 0;
+    U64 mEndSample = 0; // last sample at the level
+};
+
+/// all pixels between two resets. The pixel storage is reused from packet to
+/// packet, to avoid allocating per pixel.
+struct DecodedPacket
+{
+    std::vector<DecodedPixel> mPixels;
+    PacketSummary mSummary;
+};
+
+/**
+ * @brief ProvisionalPixelSink - receives a pixel as soon as the high pulse of
+ * its last bit is known, rather than once the low phase confirms the bit,
+ * which at the end of a packet means waiting out a reset.
+ */
+class ProvisionalPixelSink
+{
+  public:
+    virtual ~ProvisionalPixelSink() = default;
+
+    /// returns false if the pixel wasn't taken, it is then returned by
+    /// ReadRGBTriple as usual
+    virtual bool AddProvisionalPixel( const RGBValue& rgb, U64 beginSample, U64 endSample ) = 0;
+};
+
+/**
+ * @brief LineSpanSink - told about an idle or stuck span while the line still
+ * holds its level at the head of a live capture, where the edge ending it may
+ * never come. The span so far is at the end of the list given to SetLineSpans.
+ * Once the owner took it, a longer span is continued by a new one starting
+ * where it ended.
+ */
+class LineSpanSink
+{
+  public:
+    virtual ~LineSpanSink() = default;
+
+    virtual void UpdateLineSpans() = 0;
+};
+
+/**
+ * @brief AsyncRgbLedDecoder - bit, pixel and packet decoding, independent of
+ * the Analyzer SDK runtime so it can be shared by the analyzer and the
+ * command-line tools.
+ */
+class AsyncRgbLedDecoder
+{
+  public:
+    void Configure( const ControllerTimingTable& timing, U8 bitSize, ColorLayout layout, double sampleRateHz );
+
+    void SetSource( EdgeSource* source )
+    {
+        mSource = source;
+    }
+
+    /// record pulse widths into these histograms, or nullptr to disable
+    void SetTimingMargins( TimingMargins* margins )
+    {
+        mTimingMargins = margins;
+    }
+
+    /// add the high width of every bit to these totals, or nullptr to disable
+    void SetPulseWidths( PulseWidthTotals* widths )
+    {
+        mPulseWidths = widths;
+    }
+
+    /// append idle and stuck spans to this list, or nullptr to disable. The
+    /// owner drains it as it sees fit.
+    void SetLineSpans( std::vector<LineSpan>* spans )
+    {
+        mLineSpans = spans;
+    }
+
+    /// spans still going on at the head of a live capture are reported here
+    /// as they grow, or nullptr to only report them once they end
+    void SetLineSpanSink( LineSpanSink* sink )
+    {
+        mLineSpanSink = sink;
+    }
+
+    /// pixels whose last bit arrives at the head of a live capture are passed
+    /// here before the bit is confirmed, or nullptr to disable
+    void SetProvisionalPixelSink( ProvisionalPixelSink* sink )
+    {
+        mProvisionalSink = sink;
+    }
+
+    /// print the reason for every timing error to stderr
+    void SetLogErrors( bool logErrors )
+    {
+        mLogErrors = logErrors;
+    }
+
+    struct RGBResult
+    {
+        bool mValid = false;
+        bool mIsReset = false;
+        RGBValue mRGB;
+        U64 mValueBeginSample = 0;
+        U64 mValueEndSample = 0;
+
+        /// the pixel was taken by the ProvisionalPixelSink already. If it then
+        /// turned out invalid, mValid is false as usual.
+        bool mIsProvisional = false;
+    };
+
+    /// advance to the end of the next reset, ready for StartPacket
+    void SynchronizeToReset();
+    void StartPacket();
+    RGBResult ReadRGBTriple();
+
+    /// decode the next packet containing at least one pixel, synchronising
+    /// again after errors. Returns false once the source is exhausted.
+    bool DecodePacket( DecodedPacket& packet );
+
+    /// speed mode detected from the first bit of the current packet
+    bool IsHighSpeed() const
+    {
+        return mDidDetectHighSpeed;
+    }
+
+    /// number of times decoding was abandoned due to invalid timing
+    U64 ErrorCount() const
+    {
+        return mErrorCount;
+    }
+
+    U8 BitSize() const
+    {
+        return mBitSize;
+    }
+
+  private:
+    struct ReadResult
+    {
+        bool mValid = false;
+        bool mIsReset = false;
+        BitState mBitValue = BIT_LOW;
+        U64 mBeginSample = 0;
+        U64 mEndSample = 0;
+    };
+
+    ReadResult ReadBit();
+    bool DetectSpeedMode( U64 positiveSamples, U64 negativeSamples, BitState& value );
+
+    /// jump over the level at the current position in one step, to the next
+    /// edge, noting an idle or stuck span if it lasted long enough. Returns
+    /// the length of the level so far. At the head of a live capture, with a
+    /// LineSpanSink, the level is crossed in bounded steps instead; with
+    /// canStopInSpan, skipping then stops as soon as the level is a span,
+    /// and the next call carries on with it.
+    U64 SkipLevel( bool canStopInSpan = false );
+    void AddLineSpan( BitState level, U64 endSample );
+
+    EdgeSource* mSource = nullptr;
+    TimingMargins* mTimingMargins = nullptr;
+    PulseWidthTotals* mPulseWidths = nullptr;
+    std::vector<LineSpan>* mLineSpans = nullptr;
+    LineSpanSink* mLineSpanSink = nullptr;
+    ProvisionalPixelSink* mProvisionalSink = nullptr;
+
+    // the pixel read so far, while its last bit is being read
+    bool mIsLastBitOfPixel = false;
+    bool mDidTakeProvisional = false;
+    U16 mPendingChannels[ 3 ] = { 0, 0, 0 };
+    U64 mPendingBeginSample = 0;
+
+    ControllerTimingTable mTiming;
+    U8 mBitSize = 8;
+    ColorLayout mLayout = LAYOUT_RGB;
+    double mSampleRateHz = 0.0;
+
+    // lower bounds for a level to be reported as an idle or a stuck line
+    U64 mIdleSamples = 0;
+    U64 mStuckSamples = 0;
+
+    // a level crossed in steps: where it began if SkipLevel stopped inside
+    // it, and the part of its span reported so far
+    bool mIsWithinLevel = false;
+    U64 mLevelBeginSample = 0;
+    bool mHasSpan = false;
+    U64 mSpanBeginSample = 0;
+    U64 mSpanEndSample = 0;
+    U64 mSpanStepSamples = 0; // longest step
+
+    bool mFirstBitAfterReset = false;
+    bool mDidDetectHighSpeed = false;
+    bool mIsResyncNeeded = true;
+    bool mLogErrors = true;
+    U64 mErrorCount = 0;
+};
+
+#endif // ASYNCRGBLED_DECODER_H
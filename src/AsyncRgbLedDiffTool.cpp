@@ -0,0 +1,450 @@
+// Compares the pixels of two recordings of the same animation, such as
+// captures before and after a firmware change. Each side is a Logic 2 binary
+// digital export, decoded on the fly, or a binary pixel file written by
+// async_rgb_led_decode. Both are streamed, so captures of any length compare
+// in one pass and constant memory.
+
+#include <algorithm> // for std::min, std::max, std::find_if
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <strings.h> // for strcasecmp
+
+#include "AsyncRgbLedCaptureFile.h"
+#include "AsyncRgbLedControllers.h"
+#include "AsyncRgbLedDecoder.h"
+#include "AsyncRgbLedPixelDiff.h"
+#include "AsyncRgbLedPixelFile.h"
+
+namespace
+{
+    // the same exit status as diff and cmp
+    const int EXIT_SAME = 0;
+    const int EXIT_DIFFERENT = 1;
+    const int EXIT_TROUBLE = 2;
+
+    // packets of each side whose hashes the offset search compares
+    const U64 ALIGN_PACKETS = 256;
+
+    struct ToolOptions
+    {
+        double mSampleRateHz = 0.0;
+        LedControllerData mController;
+        S64 mOffset = 0; // packet i of the first input pairs with i + mOffset of the second
+        U64 mSearch = 0; // look for the best offset within +-mSearch instead
+        bool mVerbose = false;
+        std::string mInputs[ 2 ];
+    };
+
+    struct StreamPacket
+    {
+        U64 mIndex = 0;
+        U64 mHash = 0;
+        DecodedPacket mPacket;
+    };
+
+    void PrintUsage()
+    {
+        std::printf( "usage: async_rgb_led_diff [options] before after\n"
+                     "\n"
+                     "Compares the pixels of two recordings, packet by packet. Each one is a Logic 2\n"
+                     "binary digital export, or a binary pixel file from async_rgb_led_decode.\n"
+                     "Exits with 0 if the pixels are the same, 1 if they differ or packets are left\n"
+                     "over at the end, 2 on errors.\n"
+                     "\n"
+                     "  --sample-rate HZ          sample rate of Logic 2 exports (required for them)\n"
+                     "  --controller NAME         controller of Logic 2 exports (default WS2811); for\n"
+                     "                            custom timing, decode to pixel files first\n"
+                     "  --offset N                pair packet i of before with packet i + N of after\n"
+                     "  --search N                find the offset within +-N packets whose first\n"
+                     "                            packets agree best, instead of --offset\n"
+                     "  --verbose                 report every timing error of Logic 2 exports\n" );
+    }
+
+    bool ParseOptions( int argc, char** argv, ToolOptions& options )
+    {
+        const std::vector<LedControllerData> controllers = CreateControllerData();
+        options.mController = controllers.front();
+        int inputs = 0;
+
+        for( int i = 1; i < argc; ++i )
+        {
+            const std::string arg = argv[ i ];
+
+            if( arg == "--help" || arg == "-h" )
+            {
+                PrintUsage();
+                std::exit( EXIT_SAME );
+            }
+            else if( arg == "--verbose" )
+            {
+                options.mVerbose = true;
+            }
+            else if( arg.compare( 0, 2, "--" ) == 0 )
+            {
+                if( i + 1 >= argc )
+                {
+                    std::fprintf( stderr, "missing value for %s\n", arg.c_str() );
+                    return false;
+                }
+
+                const char* value = argv[ ++i ];
+
+                if( arg == "--sample-rate" )
+                {
+                    options.mSampleRateHz = std::atof( value );
+                }
+                else if( arg == "--controller" )
+                {
+                    auto found = std::find_if( controllers.begin(), controllers.end(), [value]( const LedControllerData& c ) {
+                        return ::strcasecmp( c.mName.c_str(), value ) == 0;
+                    } );
+
+                    if( found == controllers.end() )
+                    {
+                        std::fprintf( stderr, "unknown controller: %s\n", value );
+                        return false;
+                    }
+
+                    options.mController = *found;
+                }
+                else if( arg == "--offset" )
+                {
+                    options.mOffset = std::atoll( value );
+                }
+                else if( arg == "--search" )
+                {
+                    options.mSearch = static_cast<U64>( std::max( 0ll, std::atoll( value ) ) );
+                }
+                else
+                {
+                    std::fprintf( stderr, "unknown option: %s\n", arg.c_str() );
+                    return false;
+                }
+            }
+            else if( inputs < 2 )
+            {
+                options.mInputs[ inputs++ ] = arg;
+            }
+            else
+            {
+                std::fprintf( stderr, "more than two inputs: %s\n", arg.c_str() );
+                return false;
+            }
+        }
+
+        if( inputs != 2 )
+        {
+            PrintUsage();
+            return false;
+        }
+
+        return true;
+    }
+
+    /// the packets of one input, with a look-ahead for the offset search
+    class PacketStream
+    {
+      public:
+        bool Open( const std::string& path, const ToolOptions& options, std::string& error )
+        {
+            mIsPixelFile = PixelFileReader::IsPixelFile( path );
+
+            if( mIsPixelFile )
+            {
+                if( !mPixelFile.Open( path, error ) )
+                {
+                    return false;
+                }
+
+                mSampleRateHz = mPixelFile.SampleRateHz();
+                mBitsPerChannel = mPixelFile.BitsPerChannel();
+                return true;
+            }
+
+            if( options.mSampleRateHz <= 0.0 )
+            {
+                error = path + " is a Logic 2 export, which needs --sample-rate";
+                return false;
+            }
+
+            if( !mCapture.Open( path, options.mSampleRateHz, error ) )
+            {
+                return false;
+            }
+
+            const LedControllerData& controller = options.mController;
+            mDecoder.Configure( BuildControllerTimingTable( controller, options.mSampleRateHz ), controller.mBitsPerChannel,
+                                controller.mLayout, options.mSampleRateHz );
+            mDecoder.SetSource( &mCapture );
+            mDecoder.SetLogErrors( options.mVerbose );
+            mSampleRateHz = options.mSampleRateHz;
+            mBitsPerChannel = controller.mBitsPerChannel;
+            return true;
+        }
+
+        /// the next packet, false at the end of the input
+        bool Next( StreamPacket& packet )
+        {
+            if( mLookAhead.empty() )
+            {
+                return Read( packet );
+            }
+
+            std::swap( packet, mLookAhead.front() );
+            mLookAhead.pop_front();
+            return true;
+        }
+
+        /// hashes of up to count packets from the current one on, without
+        /// consuming them
+        void Peek( U64 count, std::vector<U64>& hashes )
+        {
+            while( mLookAhead.size() < count )
+            {
+                mLookAhead.emplace_back();
+
+                if( !Read( mLookAhead.back() ) )
+                {
+                    mLookAhead.pop_back();
+                    break;
+                }
+            }
+
+            hashes.clear();
+
+            for( size_t i = 0; i < std::min<size_t>( count, mLookAhead.size() ); ++i )
+            {
+                hashes.push_back( mLookAhead[ i ].mHash );
+            }
+        }
+
+        /// drops up to count packets, returning how many there were
+        U64 Skip( U64 count )
+        {
+            StreamPacket packet;
+            U64 skipped = 0;
+
+            while( ( skipped < count ) && Next( packet ) )
+            {
+                ++skipped;
+            }
+
+            return skipped;
+        }
+
+        double SampleRateHz() const
+        {
+            return mSampleRateHz;
+        }
+
+        U8 BitsPerChannel() const
+        {
+            return mBitsPerChannel;
+        }
+
+        U64 PacketsRead() const
+        {
+            return mPacketsRead;
+        }
+
+        U64 PixelsRead() const
+        {
+            return mPixelsRead;
+        }
+
+      private:
+        bool Read( StreamPacket& packet )
+        {
+            U32 flags = 0;
+            const bool isRead =
+                mIsPixelFile ? mPixelFile.ReadPacket( packet.mIndex, packet.mPacket, flags ) : mDecoder.DecodePacket( packet.mPacket );
+
+            if( !isRead )
+            {
+                return false;
+            }
+
+            if( !mIsPixelFile )
+            {
+                packet.mIndex = mPacketsRead;
+            }
+
+            packet.mHash = HashPacketPixels( packet.mPacket.mPixels );
+            ++mPacketsRead;
+            mPixelsRead += packet.mPacket.mPixels.size();
+            return true;
+        }
+
+        bool mIsPixelFile = false;
+        PixelFileReader mPixelFile;
+        Logic2CaptureFile mCapture;
+        AsyncRgbLedDecoder mDecoder;
+        double mSampleRateHz = 0.0;
+        U8 mBitsPerChannel = 8;
+        U64 mPacketsRead = 0;
+        U64 mPixelsRead = 0;
+        std::deque<StreamPacket> mLookAhead;
+    };
+
+    void PrintPixel( const char* name, const RGBValue& rgb )
+    {
+        std::printf( "  %-8s %u,%u,%u\n", name, rgb.red, rgb.green, rgb.blue );
+    }
+}
+
+int main( int argc, char** argv )
+{
+    ToolOptions options;
+
+    if( !ParseOptions( argc, argv, options ) )
+    {
+        return EXIT_TROUBLE;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    PacketStream streams[ 2 ];
+
+    for( int s = 0; s < 2; ++s )
+    {
+        std::string error;
+
+        if( !streams[ s ].Open( options.mInputs[ s ], options, error ) )
+        {
+            std::fprintf( stderr, "%s\n", error.c_str() );
+            return EXIT_TROUBLE;
+        }
+    }
+
+    if( streams[ 0 ].BitsPerChannel() != streams[ 1 ].BitsPerChannel() )
+    {
+        std::fprintf( stderr, "the inputs have %u and %u bits per channel\n", streams[ 0 ].BitsPerChannel(),
+                      streams[ 1 ].BitsPerChannel() );
+        return EXIT_TROUBLE;
+    }
+
+    S64 offset = options.mOffset;
+
+    if( options.mSearch > 0 )
+    {
+        std::vector<U64> hashes[ 2 ];
+        streams[ 0 ].Peek( ALIGN_PACKETS + options.mSearch, hashes[ 0 ] );
+        streams[ 1 ].Peek( ALIGN_PACKETS + options.mSearch, hashes[ 1 ] );
+        offset = AlignPacketHashes( hashes[ 0 ], hashes[ 1 ], options.mSearch );
+    }
+
+    U64 unpaired[ 2 ] = { 0, 0 };
+    unpaired[ offset < 0 ? 0 : 1 ] = streams[ offset < 0 ? 0 : 1 ].Skip( offset < 0 ? U64( -offset ) : U64( offset ) );
+
+    PixelDiff diff;
+    StreamPacket packets[ 2 ];
+    bool hasFirstPair = false;
+    double timeOffsetSec = 0.0;
+    int leftoverInput = -1; // whose packet in packets[] was the first one left over
+
+    for( ;; )
+    {
+        const bool hasA = streams[ 0 ].Next( packets[ 0 ] );
+        const bool hasB = hasA && streams[ 1 ].Next( packets[ 1 ] );
+
+        if( !hasB )
+        {
+            if( hasA )
+            {
+                leftoverInput = 0;
+            }
+            else if( streams[ 1 ].Next( packets[ 1 ] ) )
+            {
+                leftoverInput = 1;
+            }
+
+            unpaired[ 0 ] += hasA ? 1 : 0;
+            unpaired[ 1 ] += ( leftoverInput == 1 ) ? 1 : 0;
+            break;
+        }
+
+        if( !hasFirstPair )
+        {
+            timeOffsetSec = packets[ 1 ].mPacket.mSummary.mBeginSample / streams[ 1 ].SampleRateHz() -
+                            packets[ 0 ].mPacket.mSummary.mBeginSample / streams[ 0 ].SampleRateHz();
+            hasFirstPair = true;
+        }
+
+        diff.Compare( packets[ 0 ].mIndex, packets[ 0 ].mPacket, packets[ 0 ].mHash, packets[ 1 ].mIndex, packets[ 1 ].mPacket,
+                      packets[ 1 ].mHash );
+    }
+
+    // whatever is left over on either side
+    unpaired[ 0 ] += streams[ 0 ].Skip( ~U64( 0 ) );
+    unpaired[ 1 ] += streams[ 1 ].Skip( ~U64( 0 ) );
+
+    const double elapsedSec = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    const PixelDiffTotals& totals = diff.Totals();
+
+    for( int s = 0; s < 2; ++s )
+    {
+        std::printf( "%s: %llu packets, %llu pixels\n", options.mInputs[ s ].c_str(),
+                     static_cast<unsigned long long>( streams[ s ].PacketsRead() ),
+                     static_cast<unsigned long long>( streams[ s ].PixelsRead() ) );
+    }
+
+    std::printf( "offset: %+lld packets", static_cast<long long>( offset ) );
+
+    if( hasFirstPair )
+    {
+        std::printf( ", %+.6f s between the first paired packets", timeOffsetSec );
+    }
+
+    std::printf( "\n" );
+
+    // packets skipped for the offset don't count, but an input running out
+    // before the other does, as does one without any packets
+    const bool hasEmptyInput = ( streams[ 0 ].PacketsRead() == 0 ) || ( streams[ 1 ].PacketsRead() == 0 );
+    const bool isDifferent = totals.mHasDivergence || hasEmptyInput || ( leftoverInput >= 0 );
+
+    if( totals.mHasDivergence )
+    {
+        const PixelDivergence& d = totals.mFirstDivergence;
+        std::printf( "first difference: packet %llu at %.6f s and packet %llu at %.6f s, ", static_cast<unsigned long long>( d.mPacketA ),
+                     d.mSampleA / streams[ 0 ].SampleRateHz(), static_cast<unsigned long long>( d.mPacketB ),
+                     d.mSampleB / streams[ 1 ].SampleRateHz() );
+
+        if( d.mIsLengthOnly )
+        {
+            std::printf( "the pixels agree but one packet ends after %u\n", d.mPixel );
+        }
+        else
+        {
+            std::printf( "LED %u\n", d.mPixel );
+            PrintPixel( "before", d.mRGBA );
+            PrintPixel( "after", d.mRGBB );
+        }
+    }
+    else if( hasEmptyInput )
+    {
+        std::printf( "first difference: %s has no packets\n", options.mInputs[ streams[ 0 ].PacketsRead() == 0 ? 0 : 1 ].c_str() );
+    }
+    else if( leftoverInput >= 0 )
+    {
+        const StreamPacket& p = packets[ leftoverInput ];
+        std::printf( "first difference: packet %llu at %.6f s of %s has no counterpart\n", static_cast<unsigned long long>( p.mIndex ),
+                     p.mPacket.mSummary.mBeginSample / streams[ leftoverInput ].SampleRateHz(), options.mInputs[ leftoverInput ].c_str() );
+    }
+
+    std::printf( "packets: %llu paired, %llu identical, %llu differing, %llu of another length\n",
+                 static_cast<unsigned long long>( totals.mPackets ), static_cast<unsigned long long>( totals.mIdenticalPackets ),
+                 static_cast<unsigned long long>( totals.mPackets - totals.mIdenticalPackets ),
+                 static_cast<unsigned long long>( totals.mLengthMismatches ) );
+    std::printf( "pixels: %llu compared, %llu differing (%.6f%%), largest channel difference %u\n",
+                 static_cast<unsigned long long>( totals.mComparedPixels ), static_cast<unsigned long long>( totals.mDifferingPixels ),
+                 totals.mComparedPixels ? 100.0 * totals.mDifferingPixels / totals.mComparedPixels : 0.0, totals.mMaximumDelta );
+    std::printf( "unpaired: %llu before, %llu after\n", static_cast<unsigned long long>( unpaired[ 0 ] ),
+                 static_cast<unsigned long long>( unpaired[ 1 ] ) );
+    std::printf( "compared in %.3f s\n", elapsedSec );
+
+    return isDifferent ? EXIT_DIFFERENT : EXIT_SAME;
+}
@@ -0,0 +1,365 @@
+#include "AsyncRgbLedEventRules.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    // ends a chain of LED rules
+    const U32 NO_RULE = ~U32( 0 );
+
+    std::string Trim( const std::string& text )
+    {
+        const size_t begin = text.find_first_not_of( " \t" );
+
+        if( begin == std::string::npos )
+        {
+            return std::string();
+        }
+
+        return text.substr( begin, text.find_last_not_of( " \t" ) + 1 - begin );
+    }
+
+    bool ParseComparison( const char* op, EventRule::Comparison& comparison )
+    {
+        static const struct
+        {
+            const char* mText;
+            EventRule::Comparison mComparison;
+        } comparisons[] = {
+            { "=", EventRule::COMPARE_EQUAL },
+            { "==", EventRule::COMPARE_EQUAL },
+            { "!=", EventRule::COMPARE_NOT_EQUAL },
+            { "<", EventRule::COMPARE_LESS },
+            { "<=", EventRule::COMPARE_LESS_OR_EQUAL },
+            { ">", EventRule::COMPARE_GREATER },
+            { ">=", EventRule::COMPARE_GREATER_OR_EQUAL },
+        };
+
+        for( const auto& c : comparisons )
+        {
+            if( ::strcmp( op, c.mText ) == 0 )
+            {
+                comparison = c.mComparison;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool ParseSubject( const char* name, EventRule::Subject& subject, bool& isTime )
+    {
+        static const struct
+        {
+            const char* mName;
+            EventRule::Subject mSubject;
+            bool mIsTime;
+        } subjects[] = {
+            { "pixels", EventRule::RULE_PIXELS, false },     { "duration", EventRule::RULE_DURATION, true },
+            { "gap", EventRule::RULE_GAP, true },            { "interval", EventRule::RULE_INTERVAL, true },
+            { "bitrate", EventRule::RULE_BITRATE, false },
+        };
+
+        for( const auto& s : subjects )
+        {
+            if( ::strcmp( name, s.mName ) == 0 )
+            {
+                subject = s.mSubject;
+                isTime = s.mIsTime;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// seconds per unit of a time value, 0 if the unit isn't one
+    double TimeUnitSec( const char* unit )
+    {
+        if( ( unit[ 0 ] == '\0' ) || ( ::strcmp( unit, "s" ) == 0 ) )
+        {
+            return 1.0;
+        }
+
+        if( ::strcmp( unit, "ms" ) == 0 )
+        {
+            return 1e-3;
+        }
+
+        if( ::strcmp( unit, "us" ) == 0 )
+        {
+            return 1e-6;
+        }
+
+        if( ::strcmp( unit, "ns" ) == 0 )
+        {
+            return 1e-9;
+        }
+
+        return 0.0;
+    }
+
+    bool ParseLedRule( const char* text, EventRule& rule )
+    {
+        char index[ 12 ] = "";
+        char op[ 3 ] = "";
+        unsigned int red, green, blue;
+        int consumed = 0;
+
+        if( ( ::sscanf( text, " led %11[0-9*] %2[=!] #%2x%2x%2x %n", index, op, &red, &green, &blue, &consumed ) != 5 ) ||
+            ( text[ consumed ] != '\0' ) || !ParseComparison( op, rule.mComparison ) ||
+            ( ( rule.mComparison != EventRule::COMPARE_EQUAL ) && ( rule.mComparison != EventRule::COMPARE_NOT_EQUAL ) ) )
+        {
+            return false;
+        }
+
+        if( ::strcmp( index, "*" ) == 0 )
+        {
+            rule.mAnyLed = true;
+        }
+        else
+        {
+            unsigned long ledIndex;
+            int indexConsumed = 0;
+
+            // pixel frames don't count further
+            if( ( ::sscanf( index, "%lu%n", &ledIndex, &indexConsumed ) != 1 ) || ( index[ indexConsumed ] != '\0' ) ||
+                ( ledIndex > PixelFrameData::MAX_LED_INDEX ) )
+            {
+                return false;
+            }
+
+            rule.mLedIndex = static_cast<U32>( ledIndex );
+        }
+
+        rule.mSubject = EventRule::RULE_LED;
+        rule.mColor[ 0 ] = static_cast<U8>( red );
+        rule.mColor[ 1 ] = static_cast<U8>( green );
+        rule.mColor[ 2 ] = static_cast<U8>( blue );
+        return true;
+    }
+
+    bool ParsePacketRule( const char* text, EventRule& rule )
+    {
+        char name[ 16 ] = "";
+        char op[ 3 ] = "";
+        char unit[ 3 ] = "";
+        double value;
+        int consumed = 0;
+
+        const int count = ::sscanf( text, " %15[a-z] %2[=!<>] %lf %2[a-z] %n", name, op, &value, unit, &consumed );
+
+        if( count == 3 )
+        {
+            consumed = 0;
+            ::sscanf( text, " %*[a-z] %*[=!<>] %*f %n", &consumed );
+        }
+
+        bool isTime = false;
+
+        if( ( count < 3 ) || ( text[ consumed ] != '\0' ) || !ParseSubject( name, rule.mSubject, isTime ) ||
+            !ParseComparison( op, rule.mComparison ) )
+        {
+            return false;
+        }
+
+        const double unitSec = isTime ? TimeUnitSec( unit ) : ( unit[ 0 ] == '\0' ? 1.0 : 0.0 );
+
+        if( unitSec == 0.0 )
+        {
+            return false;
+        }
+
+        rule.mValue = value * unitSec;
+        return true;
+    }
+
+    bool Compare( double value, EventRule::Comparison comparison, double reference )
+    {
+        switch( comparison )
+        {
+        case EventRule::COMPARE_EQUAL:
+            return value == reference;
+        case EventRule::COMPARE_NOT_EQUAL:
+            return value != reference;
+        case EventRule::COMPARE_LESS:
+            return value < reference;
+        case EventRule::COMPARE_LESS_OR_EQUAL:
+            return value <= reference;
+        case EventRule::COMPARE_GREATER:
+            return value > reference;
+        case EventRule::COMPARE_GREATER_OR_EQUAL:
+            return value >= reference;
+        }
+
+        return false;
+    }
+}
+
+bool EventRuleSet::Parse( const std::string& text, std::string& badRule )
+{
+    mRules.clear();
+
+    size_t begin = 0;
+
+    while( begin <= text.size() )
+    {
+        size_t end = text.find( ';', begin );
+
+        if( end == std::string::npos )
+        {
+            end = text.size();
+        }
+
+        EventRule rule;
+        rule.mText = Trim( text.substr( begin, end - begin ) );
+        begin = end + 1;
+
+        if( rule.mText.empty() )
+        {
+            continue;
+        }
+
+        if( !ParseLedRule( rule.mText.c_str(), rule ) && !ParsePacketRule( rule.mText.c_str(), rule ) )
+        {
+            badRule = rule.mText;
+            mRules.clear();
+            return false;
+        }
+
+        mRules.push_back( rule );
+    }
+
+    return true;
+}
+
+void EventRuleSet::Reset( U8 bitSize )
+{
+    mBitSize = bitSize;
+    mFirstLedRule.clear();
+    mNextLedRule.assign( mRules.size(), NO_RULE );
+    mAnyLedRules.clear();
+    mWasTrue.assign( mRules.size(), std::vector<bool>() );
+
+    // chained in reverse, so each LED's rules are checked in the order given
+    for( U32 r = static_cast<U32>( mRules.size() ); r-- > 0; )
+    {
+        const EventRule& rule = mRules[ r ];
+
+        if( rule.mSubject != EventRule::RULE_LED )
+        {
+            continue;
+        }
+
+        if( rule.mAnyLed )
+        {
+            mAnyLedRules.insert( mAnyLedRules.begin(), r );
+            continue;
+        }
+
+        if( mFirstLedRule.size() <= rule.mLedIndex )
+        {
+            mFirstLedRule.resize( rule.mLedIndex + 1, NO_RULE );
+        }
+
+        mNextLedRule[ r ] = mFirstLedRule[ rule.mLedIndex ];
+        mFirstLedRule[ rule.mLedIndex ] = r;
+        mWasTrue[ r ].assign( 1, false );
+    }
+}
+
+void EventRuleSet::CheckPixel( U32 ledIndex, const RGBValue& rgb, U64 sample, std::vector<RuleEvent>& events )
+{
+    const U32 first = ( ledIndex < mFirstLedRule.size() ) ? mFirstLedRule[ ledIndex ] : NO_RULE;
+
+    if( ( first == NO_RULE ) && mAnyLedRules.empty() )
+    {
+        return;
+    }
+
+    PixelEvent pixel;
+    pixel.mLedIndex = ledIndex;
+    pixel.mRGB = rgb;
+    pixel.mSample = sample;
+    rgb.ConvertTo8Bit( mBitSize, pixel.mColor );
+
+    for( U32 r = first; r != NO_RULE; r = mNextLedRule[ r ] )
+    {
+        CheckLedRule( r, 0, pixel, events );
+    }
+
+    for( const U32 r : mAnyLedRules )
+    {
+        CheckLedRule( r, ledIndex, pixel, events );
+    }
+}
+
+void EventRuleSet::CheckLedRule( U32 rule, U32 slot, const PixelEvent& pixel, std::vector<RuleEvent>& events )
+{
+    const EventRule& r = mRules[ rule ];
+    const bool isEqual =
+        ( pixel.mColor[ 0 ] == r.mColor[ 0 ] ) && ( pixel.mColor[ 1 ] == r.mColor[ 1 ] ) && ( pixel.mColor[ 2 ] == r.mColor[ 2 ] );
+    const bool isTrue = ( r.mComparison == EventRule::COMPARE_EQUAL ) ? isEqual : !isEqual;
+
+    std::vector<bool>& wasTrue = mWasTrue[ rule ];
+
+    if( wasTrue.size() <= slot )
+    {
+        wasTrue.resize( slot + 1, false );
+    }
+
+    if( isTrue && !wasTrue[ slot ] )
+    {
+        RuleEvent event;
+        event.mRule = rule;
+        event.mSample = pixel.mSample;
+        event.mLedIndex = pixel.mLedIndex;
+        event.mRGB = pixel.mRGB;
+        events.push_back( event );
+    }
+
+    wasTrue[ slot ] = isTrue;
+}
+
+void EventRuleSet::CheckPacket( const PacketSummary& packet, const PacketMetrics& metrics, std::vector<RuleEvent>& events ) const
+{
+    for( U32 r = 0; r < mRules.size(); ++r )
+    {
+        const EventRule& rule = mRules[ r ];
+        double value;
+
+        switch( rule.mSubject )
+        {
+        case EventRule::RULE_PIXELS:
+            value = packet.mPixelCount;
+            break;
+        case EventRule::RULE_DURATION:
+            value = metrics.mDurationSec;
+            break;
+        case EventRule::RULE_GAP:
+        case EventRule::RULE_INTERVAL:
+            if( !metrics.mHasPrevious )
+            {
+                continue;
+            }
+
+            value = ( rule.mSubject == EventRule::RULE_GAP ) ? metrics.mGapSec : metrics.mRefreshIntervalSec;
+            break;
+        case EventRule::RULE_BITRATE:
+            value = metrics.mBitrate;
+            break;
+        default:
+            continue; // LED rules are checked per pixel
+        }
+
+        if( Compare( value, rule.mComparison, rule.mValue ) )
+        {
+            RuleEvent event;
+            event.mRule = r;
+            event.mSample = packet.mBeginSample;
+            event.mValue = value;
+            events.push_back( event );
+        }
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef ASYNCRGBLED_EVENT_RULES_H
+#define ASYNCRGBLED_EVENT_RULES_H
+
+#include <string>
+#include <vector>
+
+#include <AnalyzerTypes.h>
+
+#include "AsyncRgbLedHelpers.h"
+#include "AsyncRgbLedStatistics.h"
+
+/// one condition of an EventRuleSet
+struct EventRule
+{
+    enum Subject
+    {
+        RULE_LED = 0,  // the color of one LED, or of any
+        RULE_PIXELS,   // pixels in a packet
+        RULE_DURATION, // of a packet, in seconds
+        RULE_GAP,      // since the previous packet, in seconds
+        RULE_INTERVAL, // start to start from the previous packet, in seconds
+        RULE_BITRATE   // of a packet, in bits per second
+    };
+
+    enum Comparison
+    {
+        COMPARE_EQUAL = 0,
+        COMPARE_NOT_EQUAL,
+        COMPARE_LESS,
+        COMPARE_LESS_OR_EQUAL,
+        COMPARE_GREATER,
+        COMPARE_GREATER_OR_EQUAL
+    };
+
+    Subject mSubject = RULE_LED;
+    Comparison mComparison = COMPARE_EQUAL;
+    std::string mText; // as entered, trimmed
+
+    // LED rules
+    bool mAnyLed = false;
+    U32 mLedIndex = 0;
+    U8 mColor[ 3 ] = { 0, 0, 0 }; // 8-bit red, green, blue
+
+    // packet rules
+    double mValue = 0.0;
+};
+
+/// a rule which fired
+struct RuleEvent
+{
+    U32 mRule = 0; // index into the EventRuleSet
+    U64 mSample = 0;
+
+    // LED rules: the LED and its new color
+    U32 mLedIndex = 0;
+    RGBValue mRGB;
+
+    // packet rules: the value compared
+    double mValue = 0.0;
+};
+
+/**
+ * @brief EventRuleSet - conditions checked against every decoded pixel and
+ * packet, so rare events can be found without exporting the capture.
+ *
+ * Rules are separated by semicolons:
+ *
+ *   led 120 = #ffffff    LED 120 turned this color, in 8 bits per channel
+ *   led * != #000000     any LED turned from this color to another one
+ *   pixels != 300        a packet of another length
+ *   gap > 20ms           a reset gap longer than 20 ms
+ *
+ * LED rules compare with = or != only, and fire when the comparison becomes
+ * true for an LED, not on every packet it stays true. Packet rules take any
+ * of = != < <= > >= on pixels, duration, gap, interval or bitrate; times may
+ * have an s, ms, us or ns unit, seconds otherwise. They fire on every packet
+ * matching. Gap and interval rules don't fire on the first packet.
+ *
+ * The rules of each LED are found by index, so the cost per pixel is one
+ * lookup plus the rules of that LED and the wildcard ones.
+ */
+class EventRuleSet
+{
+  public:
+    /// replaces the rules. Returns false, leaving the set empty, if any rule
+    /// doesn't parse; badRule is then its text.
+    bool Parse( const std::string& text, std::string& badRule );
+
+    bool IsEmpty() const
+    {
+        return mRules.empty();
+    }
+
+    const EventRule& Rule( U32 index ) const
+    {
+        return mRules[ index ];
+    }
+
+    /// forget the LED colors seen so far, for a new run
+    void Reset( U8 bitSize );
+
+    void CheckPixel( U32 ledIndex, const RGBValue& rgb, U64 sample, std::vector<RuleEvent>& events );
+    void CheckPacket( const PacketSummary& packet, const PacketMetrics& metrics, std::vector<RuleEvent>& events ) const;
+
+  private:
+    /// a pixel being checked, with its color scaled to 8 bits once
+    struct PixelEvent
+    {
+        U32 mLedIndex;
+        RGBValue mRGB;
+        U64 mSample;
+        U8 mColor[ 3 ];
+    };
+
+    /// slot is where the rule keeps the state of this LED
+    void CheckLedRule( U32 rule, U32 slot, const PixelEvent& pixel, std::vector<RuleEvent>& events );
+
+    std::vector<EventRule> mRules;
+
+    // first LED rule by LED index, and the next rule of the same LED by rule
+    std::vector<U32> mFirstLedRule;
+    std::vector<U32> mNextLedRule;
+    std::vector<U32> mAnyLedRules;
+
+    // whether each rule's comparison was true last time, by rule, for an LED
+    // rule, and by LED index for a wildcard rule
+    std::vector<std::vector<bool>> mWasTrue;
+    U8 mBitSize = 8;
+};
+
+#endif // ASYNCRGBLED_EVENT_RULES_H
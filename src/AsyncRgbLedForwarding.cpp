@@ -0,0 +1,83 @@
+#include "AsyncRgbLedForwarding.h"
+
+#include <algorithm> // for std::min, std::max
+
+namespace
+{
+    bool SameColor( const RGBValue& a, const RGBValue& b )
+    {
+        return ( a.red == b.red ) && ( a.green == b.green ) && ( a.blue == b.blue );
+    }
+
+    /// output holds all of input from the offset on, and nothing else
+    bool IsForwardedFrom( const std::vector<DecodedPixel>& input, size_t offset, const std::vector<DecodedPixel>& output )
+    {
+        if( input.size() - offset != output.size() )
+        {
+            return false;
+        }
+
+        for( size_t i = 0; i < output.size(); ++i )
+        {
+            if( !SameColor( input[ offset + i ].mRGB, output[ i ].mRGB ) )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+ForwardingMetrics CompareForwardedPixels( const std::vector<DecodedPixel>& input, U32 consumedPixels,
+                                          const std::vector<DecodedPixel>& output )
+{
+    ForwardingMetrics metrics;
+
+    const size_t offset = std::min<size_t>( consumedPixels, input.size() );
+    const size_t expected = input.size() - offset;
+    const size_t common = std::min( expected, output.size() );
+    bool hasMismatch = false;
+
+    metrics.mExpectedPixels = static_cast<U32>( expected );
+
+    for( size_t i = 0; i < common; ++i )
+    {
+        if( !SameColor( input[ offset + i ].mRGB, output[ i ].mRGB ) )
+        {
+            if( !hasMismatch )
+            {
+                metrics.mFirstMismatch = static_cast<U32>( i );
+                hasMismatch = true;
+            }
+
+            ++metrics.mMismatches;
+        }
+    }
+
+    // pixels missing from DOUT, or extra ones, count as mismatches too
+    if( expected != output.size() )
+    {
+        if( !hasMismatch )
+        {
+            metrics.mFirstMismatch = static_cast<U32>( common );
+        }
+
+        metrics.mMismatches += static_cast<U32>( std::max( expected, output.size() ) - common );
+    }
+
+    // a DOUT packet which is all of DIN but a different number of pixels
+    // has only one possible shift
+    if( ( metrics.mMismatches > 0 ) && ( output.size() <= input.size() ) )
+    {
+        const size_t shift = input.size() - output.size();
+
+        if( IsForwardedFrom( input, shift, output ) )
+        {
+            metrics.mHasShift = true;
+            metrics.mShift = static_cast<U32>( shift );
+        }
+    }
+
+    return metrics;
+}
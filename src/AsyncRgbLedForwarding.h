@@ -0,0 +1,61 @@
+#ifndef ASYNCRGBLED_FORWARDING_H
+#define ASYNCRGBLED_FORWARDING_H
+
+#include <vector>
+
+#include <AnalyzerTypes.h>
+
+#include "AsyncRgbLedDecoder.h"
+
+/// the high pulse widths of the bits of one packet, summed by bit value, to
+/// compare how the LEDs reshape the pulses they forward
+struct PulseWidthTotals
+{
+    U64 mHighSamples[ 2 ] = { 0, 0 }; // indexed by BitState
+    U64 mCount[ 2 ] = { 0, 0 };
+
+    void Clear()
+    {
+        *this = PulseWidthTotals();
+    }
+
+    void Add( BitState value, U64 highSamples )
+    {
+        mHighSamples[ value ] += highSamples;
+        ++mCount[ value ];
+    }
+
+    bool HasBits( BitState value ) const
+    {
+        return mCount[ value ] > 0;
+    }
+
+    /// the mean high width in samples, zero without bits of that value
+    double MeanHighSamples( BitState value ) const
+    {
+        return mCount[ value ] ? double( mHighSamples[ value ] ) / mCount[ value ] : 0.0;
+    }
+};
+
+/// how one packet on DIN compares with what the LEDs sent on to DOUT
+struct ForwardingMetrics
+{
+    U32 mExpectedPixels = 0; // DIN pixels after the consumed ones
+    U32 mMismatches = 0;     // differing colors, plus pixels missing or extra on DOUT
+    U32 mFirstMismatch = 0;  // DOUT index of the first one, if there are any
+
+    /// DOUT matched DIN with mShift pixels consumed rather than the number
+    /// configured, which usually means that number is wrong
+    bool mHasShift = false;
+    U32 mShift = 0;
+};
+
+/**
+ * @brief CompareForwardedPixels - checks that output holds the pixels of input
+ * from consumedPixels on, with the same colors, as an LED chain forwards them.
+ * Timing isn't compared, only the order and the colors.
+ */
+ForwardingMetrics CompareForwardedPixels( const std::vector<DecodedPixel>& input, U32 consumedPixels,
+                                          const std::vector<DecodedPixel>& output );
+
+#endif // ASYNCRGBLED_FORWARDING_H
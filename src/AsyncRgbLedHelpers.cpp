@@ -1,6 +1,8 @@
 #include "AsyncRgbLedHelpers.h"
 
+#include <algorithm> // for std::min, std::max
 #include <cassert>
+#include <cmath>   // for ceil, floor
 #include <cstring> // for memcpy
 
 bool TimingTolerance::WithinTolerance( const double t ) const
@@ -13,6 +15,51 @@ bool BitTiming::WithinTolerance( const double positiveTime, const double negativ
     return mPositiveTiming.WithinTolerance( positiveTime ) && mNegativeTiming.WithinTolerance( negativeTime );
 }
 
+U64 SamplesReaching( double sec, double sampleRateHz )
+{
+    // the product can land a rounding error either side of a whole number,
+    // so settle on the count using the same division as the float checks
+    U64 samples = static_cast<U64>( std::max( std::ceil( sec * sampleRateHz ), 0.0 ) );
+
+    while( ( samples > 0 ) && ( ( samples - 1 ) / sampleRateHz >= sec ) )
+    {
+        --samples;
+    }
+
+    while( samples / sampleRateHz < sec )
+    {
+        ++samples;
+    }
+
+    return samples;
+}
+
+U64 SamplesNotExceeding( double sec, double sampleRateHz )
+{
+    U64 samples = static_cast<U64>( std::max( std::floor( sec * sampleRateHz ), 0.0 ) );
+
+    while( ( samples + 1 ) / sampleRateHz <= sec )
+    {
+        ++samples;
+    }
+
+    while( ( samples > 0 ) && ( samples / sampleRateHz > sec ) )
+    {
+        --samples;
+    }
+
+    return samples;
+}
+
+SampleWindow::SampleWindow( const TimingTolerance& tolerance, double sampleRateHz )
+    : mMinimum( SamplesReaching( tolerance.mMinimumSec, sampleRateHz ) ),
+      mNominal( static_cast<U64>( tolerance.mNominalSec * sampleRateHz ) ),
+      mMaximum( SamplesNotExceeding( tolerance.mMaximumSec, sampleRateHz ) )
+{
+    // Contains() is then exactly TimingTolerance::WithinTolerance() on
+    // samples / sampleRateHz, boundaries included
+}
+
 void RGBValue::ConvertToControllerOrder( ColorLayout layout, U16* values ) const
 {
     switch( layout )
@@ -59,6 +106,21 @@ U64 RGBValue::ConvertToU64() const
     return result;
 }
 
+PixelFrameData PixelFrameData::CreateFromU64( U64 raw )
+{
+    PixelFrameData result;
+    result.mLedIndex = static_cast<U32>( raw & 0xFFFFFF );
+    result.mPacketIndex = ( raw >> 24 ) & 0xFFFFFFFF;
+    result.mFlags = static_cast<U8>( raw >> 56 );
+    return result;
+}
+
+U64 PixelFrameData::ConvertToU64() const
+{
+    const U64 ledIndex = std::min<U64>( mLedIndex, MAX_LED_INDEX );
+    return ledIndex | ( ( mPacketIndex & 0xFFFFFFFF ) << 24 ) | ( static_cast<U64>( mFlags ) << 56 );
+}
+
 void RGBValue::ConvertTo8Bit( U8 bitSize, U8* values ) const
 {
     // we could choose to support smaller bit formats here, but
@@ -68,3 +130,46 @@ void RGBValue::ConvertTo8Bit( U8 bitSize, U8* values ) const
     values[ 1 ] = static_cast<U8>( green >> ( bitSize - 8 ) );
     values[ 2 ] = static_cast<U8>( blue >> ( bitSize - 8 ) );
 }
+
+void Pcg32Random::Seed( U64 seed )
+{
+    mState = 0;
+    Next();
+    mState += seed;
+    Next();
+}
+
+U32 Pcg32Random::Next()
+{
+    const U64 old = mState;
+    mState = old * 6364136223846793005ULL + 1442695040888963407ULL;
+    const U32 xorShifted = static_cast<U32>( ( ( old >> 18 ) ^ old ) >> 27 );
+    const U32 rotation = static_cast<U32>( old >> 59 );
+    return ( xorShifted >> rotation ) | ( xorShifted << ( ( 32 - rotation ) & 31 ) );
+}
+
+U32 Pcg32Random::NextBelow( U32 bound )
+{
+    // Lemire's multiply-shift, rejecting the few low products which would
+    // make some values more likely than others
+    U64 product = static_cast<U64>( Next() ) * bound;
+    U32 low = static_cast<U32>( product );
+
+    if( low < bound )
+    {
+        const U32 threshold = ( 0u - bound ) % bound;
+
+        while( low < threshold )
+        {
+            product = static_cast<U64>( Next() ) * bound;
+            low = static_cast<U32>( product );
+        }
+    }
+
+    return static_cast<U32>( product >> 32 );
+}
+
+double Pcg32Random::NextDouble()
+{
+    return Next() * ( 1.0 / 4294967296.0 );
+}
@@ -41,6 +41,34 @@ struct RGBValue
     void ConvertTo8Bit( U8 bitSize, U8* values ) const;
 };
 
+enum PixelFrameFlags
+{
+    PIXEL_FRAME_HIGH_SPEED = 1 << 0,
+    PIXEL_FRAME_AFTER_ERROR = 1 << 1, // the packet follows a decoding error, earlier pixels were lost
+    PIXEL_FRAME_PROVISIONAL = 1 << 2  // added in live mode before its last bit was confirmed
+};
+
+/**
+ * @brief PixelFrameData - what a legacy pixel Frame carries in mData2 besides
+ * the color in mData1, so export and display text need nothing but the frame.
+ *
+ * Packed as bits 0-23 LED index, bits 24-55 packet sequence number and bits
+ * 56-63 PIXEL_FRAME_* flags. Larger LED indices saturate, packet numbers
+ * wrap around.
+ */
+struct PixelFrameData
+{
+    static const U32 MAX_LED_INDEX = 0xFFFFFF;
+
+    U32 mLedIndex = 0;
+    U64 mPacketIndex = 0;
+    U8 mFlags = 0;
+
+    static PixelFrameData CreateFromU64( U64 raw );
+
+    U64 ConvertToU64() const;
+};
+
 struct TimingTolerance
 {
     TimingTolerance() = default;
@@ -75,4 +103,83 @@ struct BitTiming
     bool WithinTolerance( const double positiveTime, const double negativeTime ) const;
 };
 
+/// the fewest samples lasting at least sec, i.e. samples / sampleRateHz >= sec
+U64 SamplesReaching( double sec, double sampleRateHz );
+
+/// the most samples lasting no longer than sec, i.e. samples / sampleRateHz <= sec
+U64 SamplesNotExceeding( double sec, double sampleRateHz );
+
+/// A TimingTolerance converted to whole samples at a particular sample rate,
+/// so that pulse widths can be checked without floating-point math.
+struct SampleWindow
+{
+    SampleWindow() = default;
+    SampleWindow( const TimingTolerance& tolerance, double sampleRateHz );
+
+    U64 mMinimum = 0;
+    U64 mNominal = 0;
+    U64 mMaximum = 0;
+
+    bool Contains( U64 samples ) const
+    {
+        return ( samples >= mMinimum ) && ( samples <= mMaximum );
+    }
+};
+
+struct BitSampleWindows
+{
+    SampleWindow mPositive;
+    SampleWindow mNegative;
+
+    bool Contains( U64 positiveSamples, U64 negativeSamples ) const
+    {
+        return mPositive.Contains( positiveSamples ) && mNegative.Contains( negativeSamples );
+    }
+};
+
+/// The timing of a controller converted to samples, built once before
+/// decoding so that per-bit classification only compares integers.
+struct ControllerTimingTable
+{
+    BitSampleWindows mData[ 2 ][ 2 ]; // [ isHighSpeed ][ BIT_LOW / BIT_HIGH ]
+    bool mHasHighSpeed = false;
+
+    /// a low period longer than this is a reset
+    U64 mMinimumResetSamples = 0;
+
+    /// shortest valid low period of any data bit, in any supported speed mode
+    U64 mMinimumLowSamples = 0;
+
+    const BitSampleWindows& Data( BitState value, bool isHighSpeed ) const
+    {
+        return mData[ isHighSpeed ][ value ];
+    }
+};
+
+/**
+ * @brief Pcg32Random - small, fast pseudo-random generator (PCG-XSH-RR, see
+ * https://www.pcg-random.org). Each instance has its own state, so several
+ * generators can run concurrently and reproducibly, unlike rand().
+ */
+class Pcg32Random
+{
+  public:
+    explicit Pcg32Random( U64 seed = 0 )
+    {
+        Seed( seed );
+    }
+
+    void Seed( U64 seed );
+    U32 Next();
+
+    /// uniformly distributed value in [0, bound), without modulo bias
+    U32 NextBelow( U32 bound );
+
+    /// uniformly distributed value in [0, 1)
+    double NextDouble();
+
+  private:
+    U64 mState = 0;
+};
+
 #endif // of #define ASYNCRGBLED_ANALYZER_SETTINGS
@@ -0,0 +1,134 @@
+#include "AsyncRgbLedPixelDiff.h"
+
+#include <algorithm> // for std::min, std::max
+
+namespace
+{
+    const U64 HASH_MULTIPLIER = 0x9e3779b97f4a7c15ull;
+
+    U32 ChannelDelta( U16 a, U16 b )
+    {
+        return ( a > b ) ? a - b : b - a;
+    }
+}
+
+U64 HashPacketPixels( const std::vector<DecodedPixel>& pixels )
+{
+    // every step is a bijection of the hash so far, so changing one pixel
+    // always changes the result. The final mix spreads the low bits upward.
+    U64 hash = pixels.size();
+
+    for( const DecodedPixel& pixel : pixels )
+    {
+        hash = ( hash ^ pixel.mRGB.ConvertToU64() ) * HASH_MULTIPLIER;
+        hash ^= hash >> 29;
+    }
+
+    hash ^= hash >> 32;
+    return hash * HASH_MULTIPLIER;
+}
+
+void PixelDiff::Compare( U64 indexA, const DecodedPacket& a, U64 hashA, U64 indexB, const DecodedPacket& b, U64 hashB )
+{
+    ++mTotals.mPackets;
+
+    const size_t count = std::min( a.mPixels.size(), b.mPixels.size() );
+    mTotals.mComparedPixels += count;
+
+    const bool isSameLength = a.mPixels.size() == b.mPixels.size();
+
+    if( isSameLength && ( hashA == hashB ) )
+    {
+        ++mTotals.mIdenticalPackets;
+        return;
+    }
+
+    if( !isSameLength )
+    {
+        ++mTotals.mLengthMismatches;
+    }
+
+    const bool wasDiverged = mTotals.mHasDivergence;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        const RGBValue& x = a.mPixels[ i ].mRGB;
+        const RGBValue& y = b.mPixels[ i ].mRGB;
+
+        if( x.ConvertToU64() == y.ConvertToU64() )
+        {
+            continue;
+        }
+
+        ++mTotals.mDifferingPixels;
+        const U32 delta =
+            std::max( std::max( ChannelDelta( x.red, y.red ), ChannelDelta( x.green, y.green ) ), ChannelDelta( x.blue, y.blue ) );
+        mTotals.mMaximumDelta = std::max( mTotals.mMaximumDelta, delta );
+
+        if( !mTotals.mHasDivergence )
+        {
+            mTotals.mHasDivergence = true;
+            mTotals.mFirstDivergence.mPixel = static_cast<U32>( i );
+            mTotals.mFirstDivergence.mRGBA = x;
+            mTotals.mFirstDivergence.mRGBB = y;
+        }
+    }
+
+    if( !mTotals.mHasDivergence && !isSameLength )
+    {
+        mTotals.mHasDivergence = true;
+        mTotals.mFirstDivergence.mPixel = static_cast<U32>( count );
+        mTotals.mFirstDivergence.mIsLengthOnly = true;
+    }
+
+    if( mTotals.mHasDivergence && !wasDiverged )
+    {
+        PixelDivergence& divergence = mTotals.mFirstDivergence;
+        divergence.mPacketA = indexA;
+        divergence.mPacketB = indexB;
+        divergence.mSampleA = a.mSummary.mBeginSample;
+        divergence.mSampleB = b.mSummary.mBeginSample;
+    }
+}
+
+S64 AlignPacketHashes( const std::vector<U64>& hashesA, const std::vector<U64>& hashesB, U64 maxOffset )
+{
+    S64 bestOffset = 0;
+    U64 bestMatches = 0;
+
+    // offsets by increasing size, so the first best is the smallest
+    for( U64 size = 0; size <= maxOffset; ++size )
+    {
+        for( const S64 offset : { S64( size ), -S64( size ) } )
+        {
+            const size_t skipA = ( offset < 0 ) ? size : 0;
+            const size_t skipB = ( offset > 0 ) ? size : 0;
+
+            if( ( skipA >= hashesA.size() ) || ( skipB >= hashesB.size() ) )
+            {
+                continue;
+            }
+
+            const size_t count = std::min( hashesA.size() - skipA, hashesB.size() - skipB );
+            U64 matches = 0;
+
+            for( size_t i = 0; i < count; ++i )
+            {
+                matches += hashesA[ skipA + i ] == hashesB[ skipB + i ];
+            }
+
+            if( matches > bestMatches )
+            {
+                bestMatches = matches;
+                bestOffset = offset;
+            }
+
+            if( size == 0 )
+            {
+                break;
+            }
+        }
+    }
+
+    return bestOffset;
+}
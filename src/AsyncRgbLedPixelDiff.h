@@ -0,0 +1,70 @@
+#ifndef ASYNCRGBLED_PIXEL_DIFF_H
+#define ASYNCRGBLED_PIXEL_DIFF_H
+
+#include <vector>
+
+#include <AnalyzerTypes.h>
+
+#include "AsyncRgbLedDecoder.h"
+
+/// a packet's pixels reduced to one word. Packets differing in a single
+/// pixel always hash differently.
+U64 HashPacketPixels( const std::vector<DecodedPixel>& pixels );
+
+/// where two captures first differ, see PixelDiff
+struct PixelDivergence
+{
+    U64 mPacketA = 0; // packet indices in each capture
+    U64 mPacketB = 0;
+    U64 mSampleA = 0; // where the packets begin
+    U64 mSampleB = 0;
+    U32 mPixel = 0; // LED index, or the shorter length if only the lengths differ
+    bool mIsLengthOnly = false;
+    RGBValue mRGBA;
+    RGBValue mRGBB;
+};
+
+struct PixelDiffTotals
+{
+    U64 mPackets = 0; // pairs compared
+    U64 mIdenticalPackets = 0;
+    U64 mLengthMismatches = 0; // pairs with different pixel counts
+    U64 mComparedPixels = 0;   // pixels both packets of a pair have
+    U64 mDifferingPixels = 0;
+    U32 mMaximumDelta = 0; // largest difference of any channel
+
+    bool mHasDivergence = false;
+    PixelDivergence mFirstDivergence;
+};
+
+/**
+ * @brief PixelDiff - compares the packets of two captures, pair by pair, once
+ * they are aligned.
+ *
+ * Pairs whose hashes and lengths agree are counted as identical without
+ * looking at their pixels, so long runs of the same refresh cost a word
+ * compare each. Only pairs which differ are compared pixel by pixel.
+ */
+class PixelDiff
+{
+  public:
+    void Compare( U64 indexA, const DecodedPacket& a, U64 hashA, U64 indexB, const DecodedPacket& b, U64 hashB );
+
+    const PixelDiffTotals& Totals() const
+    {
+        return mTotals;
+    }
+
+  private:
+    PixelDiffTotals mTotals;
+};
+
+/**
+ * @brief AlignPacketHashes - the packet offset of capture B relative to A,
+ * within +-maxOffset, at which the most hashes of the first packets agree:
+ * packet i of A pairs with packet i + offset of B. Ties go to the smallest
+ * offset, so static content, which agrees everywhere, isn't shifted.
+ */
+S64 AlignPacketHashes( const std::vector<U64>& hashesA, const std::vector<U64>& hashesB, U64 maxOffset );
+
+#endif // ASYNCRGBLED_PIXEL_DIFF_H
@@ -0,0 +1,169 @@
+#include "AsyncRgbLedPixelFile.h"
+
+#include <cstring>
+
+namespace
+{
+    const char MAGIC[ 8 ] = { 'A', 'R', 'G', 'B', 'P', 'I', 'X', '1' };
+
+    const size_t READ_BUFFER_SIZE = 1 << 20;
+}
+
+PixelFileWriter::~PixelFileWriter()
+{
+    Close();
+}
+
+bool PixelFileWriter::Open( const std::string& path, U8 bitsPerChannel, double sampleRateHz )
+{
+    Close();
+    mFile = ::fopen( path.c_str(), "wb" );
+
+    if( !mFile )
+    {
+        return false;
+    }
+
+    const U32 bits = bitsPerChannel;
+    const U32 reserved = 0;
+    ::fwrite( MAGIC, sizeof( MAGIC ), 1, mFile );
+    ::fwrite( &bits, sizeof( bits ), 1, mFile );
+    ::fwrite( &reserved, sizeof( reserved ), 1, mFile );
+    ::fwrite( &sampleRateHz, sizeof( sampleRateHz ), 1, mFile );
+    return true;
+}
+
+void PixelFileWriter::WritePacket( U64 packetIndex, const DecodedPacket& packet, U32 extraFlags )
+{
+    const PacketSummary& summary = packet.mSummary;
+    const U32 pixelCount = static_cast<U32>( packet.mPixels.size() );
+    const U32 flags = ( summary.mHighSpeed ? PIXEL_PACKET_HIGH_SPEED : 0 ) | extraFlags;
+
+    ::fwrite( &packetIndex, sizeof( packetIndex ), 1, mFile );
+    ::fwrite( &summary.mBeginSample, sizeof( summary.mBeginSample ), 1, mFile );
+    ::fwrite( &summary.mEndSample, sizeof( summary.mEndSample ), 1, mFile );
+    ::fwrite( &pixelCount, sizeof( pixelCount ), 1, mFile );
+    ::fwrite( &flags, sizeof( flags ), 1, mFile );
+
+    for( const DecodedPixel& pixel : packet.mPixels )
+    {
+        const U16 rgb[ 3 ] = { pixel.mRGB.red, pixel.mRGB.green, pixel.mRGB.blue };
+        ::fwrite( rgb, sizeof( rgb ), 1, mFile );
+    }
+}
+
+bool PixelFileWriter::Close()
+{
+    if( !mFile )
+    {
+        return true;
+    }
+
+    const bool ok = ( ::ferror( mFile ) == 0 );
+    const bool closed = ( ::fclose( mFile ) == 0 );
+    mFile = nullptr;
+    return ok && closed;
+}
+
+PixelFileReader::~PixelFileReader()
+{
+    Close();
+}
+
+bool PixelFileReader::IsPixelFile( const std::string& path )
+{
+    FILE* file = ::fopen( path.c_str(), "rb" );
+
+    if( !file )
+    {
+        return false;
+    }
+
+    char magic[ sizeof( MAGIC ) ];
+    const bool isPixelFile = ( ::fread( magic, sizeof( magic ), 1, file ) == 1 ) && ( std::memcmp( magic, MAGIC, sizeof( MAGIC ) ) == 0 );
+    ::fclose( file );
+    return isPixelFile;
+}
+
+bool PixelFileReader::Open( const std::string& path, std::string& error )
+{
+    Close();
+    mFile = ::fopen( path.c_str(), "rb" );
+
+    if( !mFile )
+    {
+        error = "can't open " + path;
+        return false;
+    }
+
+    mBuffer.resize( READ_BUFFER_SIZE );
+    ::setvbuf( mFile, mBuffer.data(), _IOFBF, mBuffer.size() );
+
+    char magic[ sizeof( MAGIC ) ];
+    U32 bits = 0;
+    U32 reserved = 0;
+
+    if( ( ::fread( magic, sizeof( magic ), 1, mFile ) != 1 ) || ( std::memcmp( magic, MAGIC, sizeof( MAGIC ) ) != 0 ) ||
+        ( ::fread( &bits, sizeof( bits ), 1, mFile ) != 1 ) || ( ::fread( &reserved, sizeof( reserved ), 1, mFile ) != 1 ) ||
+        ( ::fread( &mSampleRateHz, sizeof( mSampleRateHz ), 1, mFile ) != 1 ) || ( bits < 1 ) || ( bits > 16 ) )
+    {
+        error = path + " isn't a pixel file";
+        Close();
+        return false;
+    }
+
+    mBitsPerChannel = static_cast<U8>( bits );
+    return true;
+}
+
+void PixelFileReader::Close()
+{
+    if( mFile )
+    {
+        ::fclose( mFile );
+        mFile = nullptr;
+    }
+}
+
+bool PixelFileReader::ReadPacket( U64& packetIndex, DecodedPacket& packet, U32& flags )
+{
+    if( !mFile )
+    {
+        return false;
+    }
+
+    PacketSummary& summary = packet.mSummary;
+    U32 pixelCount = 0;
+
+    if( ( ::fread( &packetIndex, sizeof( packetIndex ), 1, mFile ) != 1 ) ||
+        ( ::fread( &summary.mBeginSample, sizeof( summary.mBeginSample ), 1, mFile ) != 1 ) ||
+        ( ::fread( &summary.mEndSample, sizeof( summary.mEndSample ), 1, mFile ) != 1 ) ||
+        ( ::fread( &pixelCount, sizeof( pixelCount ), 1, mFile ) != 1 ) || ( ::fread( &flags, sizeof( flags ), 1, mFile ) != 1 ) )
+    {
+        return false;
+    }
+
+    // all channels of the packet in one read
+    mValues.resize( size_t( pixelCount ) * 3 );
+
+    if( ::fread( mValues.data(), sizeof( U16 ), mValues.size(), mFile ) != mValues.size() )
+    {
+        return false;
+    }
+
+    packet.mPixels.resize( pixelCount );
+    const U16* values = mValues.data();
+
+    for( DecodedPixel& pixel : packet.mPixels )
+    {
+        pixel.mRGB = RGBValue( values[ 0 ], values[ 1 ], values[ 2 ] );
+        pixel.mBeginSample = summary.mBeginSample;
+        pixel.mEndSample = summary.mEndSample;
+        values += 3;
+    }
+
+    summary.mPixelCount = pixelCount;
+    summary.mBitCount = summary.mPixelCount * 3 * mBitsPerChannel;
+    summary.mHighSpeed = ( flags & PIXEL_PACKET_HIGH_SPEED ) != 0;
+    return true;
+}
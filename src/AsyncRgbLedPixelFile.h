@@ -0,0 +1,84 @@
+#ifndef ASYNCRGBLED_PIXEL_FILE_H
+#define ASYNCRGBLED_PIXEL_FILE_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "AsyncRgbLedDecoder.h"
+
+/**
+ * Binary pixel output of the command-line tools, in native (little-endian)
+ * byte order:
+ *
+ *   header:     char[ 8 ] "ARGBPIX1", U32 bits per channel, U32 reserved,
+ *               double sample rate in Hz
+ *   per packet: U64 packet index, U64 begin sample, U64 end sample,
+ *               U32 pixel count, U32 flags (PIXEL_PACKET_*), then
+ *               pixel count x U16[ 3 ] red, green, blue
+ */
+enum PixelPacketFlags
+{
+    PIXEL_PACKET_HIGH_SPEED = 1 << 0,
+    PIXEL_PACKET_IMPAIRED = 1 << 1 // simulated with glitches or dropped bits
+};
+
+class PixelFileWriter
+{
+  public:
+    PixelFileWriter() = default;
+    ~PixelFileWriter();
+
+    PixelFileWriter( const PixelFileWriter& ) = delete;
+    PixelFileWriter& operator=( const PixelFileWriter& ) = delete;
+
+    bool Open( const std::string& path, U8 bitsPerChannel, double sampleRateHz );
+    void WritePacket( U64 packetIndex, const DecodedPacket& packet, U32 extraFlags = 0 );
+
+    /// returns false if any write failed
+    bool Close();
+
+  private:
+    FILE* mFile = nullptr;
+};
+
+class PixelFileReader
+{
+  public:
+    PixelFileReader() = default;
+    ~PixelFileReader();
+
+    PixelFileReader( const PixelFileReader& ) = delete;
+    PixelFileReader& operator=( const PixelFileReader& ) = delete;
+
+    /// whether the file starts like a pixel file
+    static bool IsPixelFile( const std::string& path );
+
+    /// returns false and fills in error if the file can't be used
+    bool Open( const std::string& path, std::string& error );
+    void Close();
+
+    /// the next packet, false at the end of the file or of its last complete
+    /// packet. The file has no samples per pixel, so every pixel carries the
+    /// begin and end sample of its packet.
+    bool ReadPacket( U64& packetIndex, DecodedPacket& packet, U32& flags );
+
+    U8 BitsPerChannel() const
+    {
+        return mBitsPerChannel;
+    }
+
+    double SampleRateHz() const
+    {
+        return mSampleRateHz;
+    }
+
+  private:
+    FILE* mFile = nullptr;
+    std::vector<char> mBuffer; // for stdio, large enough to read at disk speed
+    std::vector<U16> mValues;
+    U8 mBitsPerChannel = 8;
+    double mSampleRateHz = 0.0;
+};
+
+#endif // ASYNCRGBLED_PIXEL_FILE_H
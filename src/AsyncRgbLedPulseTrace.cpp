@@ -0,0 +1,152 @@
+#include "AsyncRgbLedPulseTrace.h"
+
+#include <algorithm> // for std::max, std::upper_bound
+
+void PulseTrace::Start( BitState initialState, U64 beginSample, double sampleRateHz )
+{
+    Clear();
+
+    mIsStarted = true;
+    mInitialState = initialState;
+    mLastState = initialState;
+    mBeginSample = beginSample;
+    mEndSample = beginSample;
+    mLastSample = beginSample;
+    mSampleRateHz = sampleRateHz;
+    mBoundaryMinimumSamples = static_cast<U64>( BOUNDARY_MINIMUM_LOW_SEC * sampleRateHz );
+}
+
+void PulseTrace::Clear()
+{
+    // release the memory, a trace can be large
+    std::vector<U8>().swap( mDeltas );
+    std::vector<ResetBoundary>().swap( mBoundaries );
+
+    mIsStarted = false;
+    mIsFull = false;
+    mTransitionCount = 0;
+}
+
+void PulseTrace::AddTransition( U64 sample )
+{
+    if( !mIsStarted || mIsFull )
+    {
+        return;
+    }
+
+    if( mDeltas.size() >= MAX_BYTES )
+    {
+        // the trace ends just before the first transition it lacks
+        mIsFull = true;
+        mEndSample = sample - 1;
+        return;
+    }
+
+    U64 delta = sample - mLastSample;
+
+    // LEB128: seven bits per byte, the top bit set on all but the last
+    while( delta >= 0x80 )
+    {
+        mDeltas.push_back( static_cast<U8>( delta | 0x80 ) );
+        delta >>= 7;
+    }
+
+    mDeltas.push_back( static_cast<U8>( delta ) );
+
+    if( ( mLastState == BIT_LOW ) && ( sample - mLastSample >= mBoundaryMinimumSamples ) )
+    {
+        ResetBoundary boundary;
+        boundary.mSample = sample;
+        boundary.mTransition = mTransitionCount;
+        boundary.mByteOffset = mDeltas.size();
+        mBoundaries.push_back( boundary );
+    }
+
+    ++mTransitionCount;
+    mLastSample = sample;
+    mLastState = Toggle( mLastState );
+    mEndSample = std::max( mEndSample, sample );
+}
+
+void PulseTrace::Extend( U64 sample )
+{
+    if( mIsStarted && !mIsFull )
+    {
+        mEndSample = std::max( mEndSample, sample );
+    }
+}
+
+bool PulseTrace::FindBoundaryAtOrBefore( U64 transition, ResetBoundary& boundary ) const
+{
+    auto it = std::upper_bound( mBoundaries.begin(), mBoundaries.end(), transition,
+                                []( U64 t, const ResetBoundary& b ) { return t < b.mTransition; } );
+
+    if( it == mBoundaries.begin() )
+    {
+        return false;
+    }
+
+    boundary = *( it - 1 );
+    return true;
+}
+
+U64 PulseTrace::ReadDelta( U64& byteOffset ) const
+{
+    U64 delta = 0;
+    int shift = 0;
+    U8 byte;
+
+    do
+    {
+        byte = mDeltas[ byteOffset++ ];
+        delta |= U64( byte & 0x7F ) << shift;
+        shift += 7;
+    } while( byte & 0x80 );
+
+    return delta;
+}
+
+void PulseTraceEdgeSource::Open( const PulseTrace& trace )
+{
+    mTrace = &trace;
+    mCursorTransition = 0;
+    mCursorSample = trace.BeginSample();
+    mCursorByteOffset = 0;
+
+    Reset( trace.InitialState(), trace.TransitionCount(), trace.EndSample() );
+    AdvanceToAbsPosition( trace.BeginSample() );
+}
+
+U64 PulseTraceEdgeSource::TransitionSample( U64 index ) const
+{
+    // in order, this is the cursor or the one after it
+    if( ( index + 1 < mCursorTransition ) || ( index > mCursorTransition ) )
+    {
+        // elsewhere, start from the closest boundary if that saves decoding
+        ResetBoundary boundary;
+
+        if( mTrace->FindBoundaryAtOrBefore( index, boundary ) )
+        {
+            if( ( boundary.mTransition + 1 > mCursorTransition ) || ( index + 1 < mCursorTransition ) )
+            {
+                mCursorTransition = boundary.mTransition + 1;
+                mCursorSample = boundary.mSample;
+                mCursorByteOffset = boundary.mByteOffset;
+            }
+        }
+        else if( index + 1 < mCursorTransition )
+        {
+            mCursorTransition = 0;
+            mCursorSample = mTrace->BeginSample();
+            mCursorByteOffset = 0;
+        }
+    }
+
+    while( mCursorTransition <= index )
+    {
+        mCursorSample += mTrace->ReadDelta( mCursorByteOffset );
+        ++mCursorTransition;
+    }
+
+    return mCursorSample;
+}
@@ -0,0 +1,140 @@
+#ifndef ASYNCRGBLED_PULSE_TRACE_H
+#define ASYNCRGBLED_PULSE_TRACE_H
+
+#include <vector>
+
+#include <AnalyzerTypes.h>
+
+#include "AsyncRgbLedDecoder.h"
+
+/// the end of a low level long enough to be a reset, for seeking into a trace
+struct ResetBoundary
+{
+    U64 mSample = 0;     // the rising edge ending the low level
+    U64 mTransition = 0; // index of that edge
+    U64 mByteOffset = 0; // of the delta after that edge
+};
+
+/**
+ * @brief PulseTrace - the transitions of one digital channel, kept in memory
+ * as varint-encoded deltas, so a later run with different settings can decode
+ * from the trace rather than walking the channel data again.
+ *
+ * Each transition takes a LEB128 varint of the samples since the previous one:
+ * one byte for pulses up to 127 samples, two up to 16383. Every low level of
+ * at least BOUNDARY_MINIMUM_LOW_SEC is indexed as a reset boundary; whether it
+ * is a reset for the controller at hand is for the decoder to decide. Once the
+ * encoded size reaches MAX_BYTES, recording stops and the trace covers the
+ * start of the capture only.
+ */
+class PulseTrace
+{
+  public:
+    static const U64 MAX_BYTES = U64( 256 ) * 1024 * 1024;
+    static constexpr double BOUNDARY_MINIMUM_LOW_SEC = 10e-6;
+
+    /// empty the trace and start recording at this sample
+    void Start( BitState initialState, U64 beginSample, double sampleRateHz );
+    void Clear();
+
+    /// a transition at this sample, after all those recorded so far. Also
+    /// extends the trace up to the sample.
+    void AddTransition( U64 sample );
+
+    /// all transitions up to this sample were recorded
+    void Extend( U64 sample );
+
+    bool IsEmpty() const
+    {
+        return !mIsStarted;
+    }
+
+    bool IsFull() const
+    {
+        return mIsFull;
+    }
+
+    BitState InitialState() const
+    {
+        return mInitialState;
+    }
+
+    U64 BeginSample() const
+    {
+        return mBeginSample;
+    }
+
+    /// the trace is complete up to and including this sample
+    U64 EndSample() const
+    {
+        return mEndSample;
+    }
+
+    double SampleRateHz() const
+    {
+        return mSampleRateHz;
+    }
+
+    U64 TransitionCount() const
+    {
+        return mTransitionCount;
+    }
+
+    size_t ByteCount() const
+    {
+        return mDeltas.size();
+    }
+
+    const std::vector<ResetBoundary>& ResetBoundaries() const
+    {
+        return mBoundaries;
+    }
+
+    /// the last boundary at or before the transition, false if there is none
+    bool FindBoundaryAtOrBefore( U64 transition, ResetBoundary& boundary ) const;
+
+    /// decodes the delta at byteOffset and moves byteOffset past it
+    U64 ReadDelta( U64& byteOffset ) const;
+
+  private:
+    std::vector<U8> mDeltas;
+    std::vector<ResetBoundary> mBoundaries;
+
+    bool mIsStarted = false;
+    bool mIsFull = false;
+    BitState mInitialState = BIT_LOW;
+    BitState mLastState = BIT_LOW;
+    U64 mBeginSample = 0;
+    U64 mEndSample = 0;
+    U64 mLastSample = 0; // of the last transition, or the beginning
+    U64 mTransitionCount = 0;
+    U64 mBoundaryMinimumSamples = 0;
+    double mSampleRateHz = 0.0;
+};
+
+/**
+ * @brief PulseTraceEdgeSource - replays a PulseTrace as an EdgeSource. It ends
+ * at the end of the trace, as it was when Open was called.
+ *
+ * Transitions are decoded in order as the decoder moves along; going back
+ * restarts from the nearest reset boundary.
+ */
+class PulseTraceEdgeSource : public TransitionEdgeSource
+{
+  public:
+    void Open( const PulseTrace& trace );
+
+  protected:
+    U64 TransitionSample( U64 index ) const override;
+
+  private:
+    const PulseTrace* mTrace = nullptr;
+
+    // the last transition decoded. mCursorTransition is one past the index,
+    // so zero means none yet, with mCursorSample at the beginning.
+    mutable U64 mCursorTransition = 0;
+    mutable U64 mCursorSample = 0;
+    mutable U64 mCursorByteOffset = 0;
+};
+
+#endif // ASYNCRGBLED_PULSE_TRACE_H
@@ -0,0 +1,262 @@
+// Benchmark of the results layer: bubble text, tabular text and the pixel
+// CSV export, run against an in-memory stand-in for the analyzer's results
+// so they can be measured without Logic 2. Reports the time per frame for
+// each display base, and the peak memory of the process.
+
+#include <algorithm> // for std::min, std::max
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <sys/resource.h> // for getrusage
+
+#include "AsyncRgbLedHelpers.h"
+#include "AsyncRgbLedResultsText.h"
+
+namespace
+{
+    /**
+     * Serves synthetic pixel frames, laid out like the analyzer's: packets of
+     * a fixed number of LEDs, separated by a reset. Frames are generated on
+     * demand, so the peak memory is that of the code under test rather than
+     * of the stand-in, however many frames are served.
+     */
+    class SyntheticFrameStore : public PixelFrameStore
+    {
+      public:
+        SyntheticFrameStore( U64 frameCount, U32 pixelsPerPacket, U8 bitSize )
+            : mFrameCount( frameCount ), mPixelsPerPacket( pixelsPerPacket ), mChannelMask( ( 1u << bitSize ) - 1 )
+        {
+        }
+
+        U64 FrameCount() override
+        {
+            return mFrameCount;
+        }
+
+        Frame PixelFrame( U64 frameIndex ) override
+        {
+            const U64 packet = frameIndex / mPixelsPerPacket;
+            const U64 led = frameIndex % mPixelsPerPacket;
+
+            // 24 bits at 1.25 us and a 50 us reset, at 100 MHz
+            const U64 pixelSamples = 3000;
+            const U64 packetSamples = mPixelsPerPacket * pixelSamples + 5000;
+
+            // any well-mixed value will do for the colors
+            U64 hash = ( frameIndex + 1 ) * 0x9E3779B97F4A7C15ULL;
+            hash ^= hash >> 29;
+
+            const RGBValue rgb( static_cast<U16>( hash & mChannelMask ), static_cast<U16>( ( hash >> 16 ) & mChannelMask ),
+                                static_cast<U16>( ( hash >> 32 ) & mChannelMask ) );
+
+            Frame frame;
+            frame.mStartingSampleInclusive = static_cast<S64>( packet * packetSamples + led * pixelSamples );
+            frame.mEndingSampleInclusive = frame.mStartingSampleInclusive + pixelSamples - 1;
+            frame.mData1 = rgb.ConvertToU64();
+            PixelFrameData frameData;
+            frameData.mLedIndex = static_cast<U32>( led );
+            frameData.mPacketIndex = packet;
+            frame.mData2 = frameData.ConvertToU64();
+            frame.mType = 0;
+            frame.mFlags = 0;
+            return frame;
+        }
+
+        bool UpdateProgressAndCheckForCancel( U64 /*completedFrames*/, U64 /*totalFrames*/ ) override
+        {
+            return false;
+        }
+
+      private:
+        U64 mFrameCount;
+        U32 mPixelsPerPacket;
+        U32 mChannelMask;
+    };
+
+    struct NamedBase
+    {
+        const char* mName;
+        DisplayBase mBase;
+    };
+
+    const NamedBase DISPLAY_BASES[] = {
+        { "binary", Binary }, { "decimal", Decimal }, { "hex", Hexadecimal }, { "ascii", ASCII }, { "asciihex", AsciiHex },
+    };
+
+    struct ToolOptions
+    {
+        U64 mFrames = 10000000;
+        U64 mExportFrames = 1000000;
+        U32 mPixelsPerPacket = 100;
+        U8 mBitSize = 8;
+        std::string mOutputPath = "/dev/null";
+        std::string mBase; // empty for all of them
+    };
+
+    void PrintUsage()
+    {
+        std::printf( "usage: async_rgb_led_results_bench [options]\n"
+                     "\n"
+                     "Times the bubble text, tabular text and CSV export of pixel frames, for each\n"
+                     "display base, against synthetic frames held in memory.\n"
+                     "\n"
+                     "  --frames N                frames for bubble and tabular text (default 10000000)\n"
+                     "  --export-frames N         frames for each export (default 1000000)\n"
+                     "  --pixels N                LEDs per packet (default 100)\n"
+                     "  --bits N                  bits per channel, 8 to 16 (default 8)\n"
+                     "  --base NAME               only this display base: binary, decimal, hex, ascii\n"
+                     "                            or asciihex\n"
+                     "  --output FILE             where exports are written (default /dev/null)\n" );
+    }
+
+    bool ParseOptions( int argc, char** argv, ToolOptions& options )
+    {
+        for( int i = 1; i < argc; ++i )
+        {
+            const std::string arg = argv[ i ];
+
+            if( arg == "--help" || arg == "-h" )
+            {
+                PrintUsage();
+                std::exit( EXIT_SUCCESS );
+            }
+            else if( ( arg.compare( 0, 2, "--" ) == 0 ) && ( i + 1 < argc ) )
+            {
+                const char* value = argv[ ++i ];
+
+                if( arg == "--frames" )
+                {
+                    options.mFrames = std::strtoull( value, nullptr, 10 );
+                }
+                else if( arg == "--export-frames" )
+                {
+                    options.mExportFrames = std::strtoull( value, nullptr, 10 );
+                }
+                else if( arg == "--pixels" )
+                {
+                    options.mPixelsPerPacket = static_cast<U32>( std::max( 1, std::atoi( value ) ) );
+                }
+                else if( arg == "--bits" )
+                {
+                    options.mBitSize = static_cast<U8>( std::min( 16, std::max( 8, std::atoi( value ) ) ) );
+                }
+                else if( arg == "--base" )
+                {
+                    options.mBase = value;
+                }
+                else if( arg == "--output" )
+                {
+                    options.mOutputPath = value;
+                }
+                else
+                {
+                    std::fprintf( stderr, "unknown option: %s\n", arg.c_str() );
+                    return false;
+                }
+            }
+            else
+            {
+                std::fprintf( stderr, "unknown option: %s\n", arg.c_str() );
+                PrintUsage();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    double PeakMemoryMiB()
+    {
+        struct rusage usage;
+        ::getrusage( RUSAGE_SELF, &usage );
+
+#ifdef __APPLE__
+        return usage.ru_maxrss / ( 1024.0 * 1024.0 ); // bytes
+#else
+        return usage.ru_maxrss / 1024.0; // kilobytes
+#endif
+    }
+
+    void PrintResult( const char* stage, const char* base, U64 frames, double seconds )
+    {
+        std::printf( "%-10s %-9s %10llu %9.3f %9.1f %9.2f %9.1f\n", stage, base, static_cast<unsigned long long>( frames ), seconds,
+                     frames ? seconds * 1e9 / frames : 0.0, seconds > 0.0 ? frames / seconds / 1e6 : 0.0, PeakMemoryMiB() );
+    }
+
+    double SecondsSince( std::chrono::steady_clock::time_point start )
+    {
+        return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    }
+}
+
+int main( int argc, char** argv )
+{
+    ToolOptions options;
+
+    if( !ParseOptions( argc, argv, options ) )
+    {
+        return EXIT_FAILURE;
+    }
+
+    SyntheticFrameStore frames( options.mFrames, options.mPixelsPerPacket, options.mBitSize );
+    SyntheticFrameStore exportFrames( options.mExportFrames, options.mPixelsPerPacket, options.mBitSize );
+
+    // the text lengths are summed and printed, so none of the work can be
+    // optimized away
+    U64 checksum = 0;
+    bool anyBase = false;
+
+    std::printf( "%-10s %-9s %10s %9s %9s %9s %9s\n", "stage", "base", "frames", "seconds", "ns/frame", "Mframe/s", "peak MiB" );
+
+    for( const NamedBase& base : DISPLAY_BASES )
+    {
+        if( !options.mBase.empty() && ( options.mBase != base.mName ) )
+        {
+            continue;
+        }
+
+        anyBase = true;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for( U64 i = 0; i < options.mFrames; ++i )
+        {
+            PixelBubbleText text;
+            FormatPixelBubbleText( frames.PixelFrame( i ), base.mBase, options.mBitSize, text );
+
+            for( const char* variant : text.mVariants )
+            {
+                checksum += std::strlen( variant );
+            }
+        }
+
+        PrintResult( "bubble", base.mName, options.mFrames, SecondsSince( start ) );
+
+        start = std::chrono::steady_clock::now();
+
+        for( U64 i = 0; i < options.mFrames; ++i )
+        {
+            char buf[ 64 ];
+            FormatPixelTabularText( frames.PixelFrame( i ), base.mBase, options.mBitSize, sizeof( buf ), buf );
+            checksum += std::strlen( buf );
+        }
+
+        PrintResult( "tabular", base.mName, options.mFrames, SecondsSince( start ) );
+
+        start = std::chrono::steady_clock::now();
+        ExportPixelsCsv( options.mOutputPath.c_str(), exportFrames, base.mBase, options.mBitSize, 0, 100000000 );
+        PrintResult( "csv", base.mName, options.mExportFrames, SecondsSince( start ) );
+    }
+
+    if( !anyBase )
+    {
+        std::fprintf( stderr, "unknown display base: %s\n", options.mBase.c_str() );
+        return EXIT_FAILURE;
+    }
+
+    std::printf( "text checksum %llu, peak memory %.1f MiB\n", static_cast<unsigned long long>( checksum ), PeakMemoryMiB() );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,53 @@
+#include "AsyncRgbLedResultsBudget.h"
+
+void ResultsBudget::Configure( U64 budgetBytes )
+{
+    mBudgetBytes = budgetBytes;
+    mUsedBytes = 0;
+    mPacketsSinceKept = 0;
+    mHasDecimationStarted = false;
+}
+
+U32 ResultsBudget::DecimationFactor() const
+{
+    if( mBudgetBytes == 0 )
+    {
+        return 1;
+    }
+
+    if( mUsedBytes >= mBudgetBytes )
+    {
+        return 0;
+    }
+
+    // one doubling for each halving of the remaining budget
+    const U64 remaining = mBudgetBytes - mUsedBytes;
+    U32 factor = 1;
+
+    while( ( remaining << 1 ) <= ( mBudgetBytes / factor ) && ( factor < 0x80000000u ) )
+    {
+        factor <<= 1;
+    }
+
+    return factor;
+}
+
+bool ResultsBudget::KeepNextPacket()
+{
+    const U32 factor = DecimationFactor();
+
+    if( factor == 1 )
+    {
+        return true;
+    }
+
+    mHasDecimationStarted = true;
+
+    if( ( factor == 0 ) || ( ++mPacketsSinceKept < factor ) )
+    {
+        return false;
+    }
+
+    mPacketsSinceKept = 0;
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef ASYNCRGBLED_RESULTS_BUDGET_H
+#define ASYNCRGBLED_RESULTS_BUDGET_H
+
+#include <AnalyzerTypes.h>
+
+/**
+ * @brief ResultsBudget - bounds the memory taken by pixel frames in long
+ * captures, by keeping the pixels of only every Nth packet once the budget
+ * runs low.
+ *
+ * Pixels are kept in full until half the budget is used. From then on the
+ * decimation factor N doubles each time half of the remaining budget is used,
+ * so the pixel frames never exceed the budget however long the capture, and
+ * later parts of the capture still get some pixels. Packet records are always
+ * kept and aren't counted, they are a small fraction of the pixel frames.
+ * Other per-pixel records, such as the LED change index, are counted with
+ * AddBytes() and stop being added once the budget is used up.
+ *
+ * Memory use is estimated from the number of records, since the SDK doesn't
+ * report what it allocates.
+ */
+class ResultsBudget
+{
+  public:
+    /// estimated memory of the legacy and FrameV2 records of one pixel
+    static const U64 PIXEL_BYTES = 160;
+
+    /// zero for no limit
+    void Configure( U64 budgetBytes );
+
+    /// called once per packet, before its pixels: whether to keep them
+    bool KeepNextPacket();
+
+    void AddPixel()
+    {
+        mUsedBytes += PIXEL_BYTES;
+    }
+
+    void AddBytes( U64 bytes )
+    {
+        mUsedBytes += bytes;
+    }
+
+    bool IsUsedUp() const
+    {
+        return ( mBudgetBytes != 0 ) && ( mUsedBytes >= mBudgetBytes );
+    }
+
+    /// keep one packet in this many, 0 once the budget is used up
+    U32 DecimationFactor() const;
+
+    /// true from the first packet which was subject to decimation
+    bool HasDecimationStarted() const
+    {
+        return mHasDecimationStarted;
+    }
+
+    U64 UsedBytes() const
+    {
+        return mUsedBytes;
+    }
+
+  private:
+    U64 mBudgetBytes = 0;
+    U64 mUsedBytes = 0;
+    U64 mPacketsSinceKept = 0;
+    bool mHasDecimationStarted = false;
+};
+
+#endif // ASYNCRGBLED_RESULTS_BUDGET_H
@@ -0,0 +1,620 @@
+#include "AsyncRgbLedResultsSidecar.h"
+
+#include <algorithm> // for std::min
+#include <cstring>
+
+namespace
+{
+    const char MAGIC[ 8 ] = { 'A', 'R', 'G', 'B', 'S', 'I', 'D', '1' };
+
+    // far more than any step of a real strip, to reject damaged sizes
+    const U64 MAX_PAYLOAD_BYTES = U64( 256 ) * 1024 * 1024;
+    const U64 MAX_PIXELS = U64( 16 ) * 1024 * 1024;
+
+    void PutVarint( std::vector<U8>& out, U64 value )
+    {
+        while( value >= 0x80 )
+        {
+            out.push_back( static_cast<U8>( value | 0x80 ) );
+            value >>= 7;
+        }
+
+        out.push_back( static_cast<U8>( value ) );
+    }
+
+    void PutSigned( std::vector<U8>& out, S64 value )
+    {
+        // zigzag: small magnitudes of either sign stay short
+        PutVarint( out, ( static_cast<U64>( value ) << 1 ) ^ static_cast<U64>( value >> 63 ) );
+    }
+
+    void PutChannel( std::vector<U8>& out, U16 value, U8 bitSize )
+    {
+        out.push_back( static_cast<U8>( value ) );
+
+        if( bitSize > 8 )
+        {
+            out.push_back( static_cast<U8>( value >> 8 ) );
+        }
+    }
+
+    /// the values as runs of zeros, each but a final one followed by the
+    /// non-zero value ending it
+    void PutZeroRuns( std::vector<U8>& out, const std::vector<S64>& values )
+    {
+        size_t i = 0;
+
+        while( i < values.size() )
+        {
+            const size_t runBegin = i;
+
+            while( ( i < values.size() ) && ( values[ i ] == 0 ) )
+            {
+                ++i;
+            }
+
+            PutVarint( out, i - runBegin );
+
+            if( i < values.size() )
+            {
+                PutSigned( out, values[ i++ ] );
+            }
+        }
+    }
+
+    bool IsSameColor( const RGBValue& a, const RGBValue& b )
+    {
+        return ( a.red == b.red ) && ( a.green == b.green ) && ( a.blue == b.blue );
+    }
+
+    U32 Checksum( const std::vector<U8>& payload )
+    {
+        Fnv1aHash hash;
+        hash.Add( payload.data(), payload.size() );
+        return static_cast<U32>( hash.Value() );
+    }
+
+    /// reads a payload, remembering whether it ever ran past the end
+    class PayloadCursor
+    {
+      public:
+        explicit PayloadCursor( const std::vector<U8>& payload ) : mNext( payload.data() ), mEnd( payload.data() + payload.size() )
+        {
+        }
+
+        bool IsValid() const
+        {
+            return mIsValid;
+        }
+
+        U8 Byte()
+        {
+            if( mNext == mEnd )
+            {
+                mIsValid = false;
+                return 0;
+            }
+
+            return *mNext++;
+        }
+
+        U64 Varint()
+        {
+            U64 value = 0;
+            int shift = 0;
+            U8 byte;
+
+            do
+            {
+                byte = Byte();
+                value |= ( shift < 64 ) ? U64( byte & 0x7F ) << shift : 0;
+                shift += 7;
+            } while( ( byte & 0x80 ) && mIsValid );
+
+            return value;
+        }
+
+        S64 Signed()
+        {
+            const U64 value = Varint();
+            return static_cast<S64>( value >> 1 ) ^ -static_cast<S64>( value & 1 );
+        }
+
+        /// count values written by PutZeroRuns
+        void ZeroRuns( size_t count, std::vector<S64>& values )
+        {
+            values.assign( count, 0 );
+            size_t i = 0;
+
+            while( ( i < count ) && mIsValid )
+            {
+                const U64 zeros = Varint();
+                i += static_cast<size_t>( std::min<U64>( zeros, count - i ) );
+
+                if( i < count )
+                {
+                    values[ i++ ] = Signed();
+                }
+            }
+        }
+
+        U16 Channel( U8 bitSize )
+        {
+            U16 value = Byte();
+
+            if( bitSize > 8 )
+            {
+                value |= static_cast<U16>( Byte() << 8 );
+            }
+
+            return value;
+        }
+
+      private:
+        const U8* mNext;
+        const U8* mEnd;
+        bool mIsValid = true;
+    };
+}
+
+void Fnv1aHash::Add( const void* data, size_t size )
+{
+    const U8* bytes = static_cast<const U8*>( data );
+
+    for( size_t i = 0; i < size; ++i )
+    {
+        mValue = ( mValue ^ bytes[ i ] ) * 0x100000001b3ull;
+    }
+}
+
+U64 HashDecoderSettings( const ControllerTimingTable& timing, U8 bitSize, ColorLayout layout )
+{
+    Fnv1aHash hash;
+
+    for( const bool isHighSpeed : { false, true } )
+    {
+        for( const auto value : { BIT_LOW, BIT_HIGH } )
+        {
+            const BitSampleWindows& windows = timing.Data( value, isHighSpeed );
+
+            for( const SampleWindow* window : { &windows.mPositive, &windows.mNegative } )
+            {
+                hash.Add( window->mMinimum );
+                hash.Add( window->mNominal );
+                hash.Add( window->mMaximum );
+            }
+        }
+    }
+
+    hash.Add( U64( timing.mHasHighSpeed ) );
+    hash.Add( timing.mMinimumResetSamples );
+    hash.Add( timing.mMinimumLowSamples );
+    hash.Add( U64( bitSize ) );
+    hash.Add( U64( layout ) );
+    return hash.Value();
+}
+
+void SidecarStep::Clear()
+{
+    mSpans.clear();
+    mSpansBeforePacket = 0;
+    mPixels.clear();
+    mHighSpeed = false;
+    mIsResyncNeeded = false;
+    mEndSample = 0;
+}
+
+ResultsSidecarReader::~ResultsSidecarReader()
+{
+    Close();
+}
+
+bool ResultsSidecarReader::Open( const std::string& path )
+{
+    Close();
+    mFile = ::fopen( path.c_str(), "rb" );
+
+    if( !mFile )
+    {
+        return false;
+    }
+
+    char magic[ 8 ];
+    U32 bits = 0;
+
+    const bool isSidecar = ( ::fread( magic, sizeof( magic ), 1, mFile ) == 1 ) && ( ::memcmp( magic, MAGIC, sizeof( MAGIC ) ) == 0 ) &&
+                           ( ::fread( &mKey.mSettingsHash, sizeof( mKey.mSettingsHash ), 1, mFile ) == 1 ) &&
+                           ( ::fread( &mKey.mChannelHash, sizeof( mKey.mChannelHash ), 1, mFile ) == 1 ) &&
+                           ( ::fread( &mKey.mChannelTransitions, sizeof( mKey.mChannelTransitions ), 1, mFile ) == 1 ) &&
+                           ( ::fread( &mKey.mSampleRateHz, sizeof( mKey.mSampleRateHz ), 1, mFile ) == 1 ) &&
+                           ( ::fread( &bits, sizeof( bits ), 1, mFile ) == 1 ) && ( bits >= 1 ) && ( bits <= 16 );
+
+    if( !isSidecar )
+    {
+        Close();
+        return false;
+    }
+
+    mKey.mBitSize = static_cast<U8>( bits );
+    mState = SidecarCodecState();
+    mIntactBytes = static_cast<U64>( ::ftell( mFile ) );
+    mIsIntact = true;
+    return true;
+}
+
+bool ResultsSidecarReader::Read( SidecarStep& step )
+{
+    if( !mFile || !mIsIntact )
+    {
+        return false;
+    }
+
+    // the payload size; a clean end of file can only come before it
+    U64 size = 0;
+    int shift = 0;
+    int c;
+
+    while( ( c = ::fgetc( mFile ) ) != EOF )
+    {
+        size |= ( shift < 64 ) ? U64( c & 0x7F ) << shift : 0;
+        shift += 7;
+
+        if( !( c & 0x80 ) )
+        {
+            break;
+        }
+    }
+
+    if( c == EOF )
+    {
+        mIsIntact = ( shift == 0 );
+        return false;
+    }
+
+    U32 checksum = 0;
+    mIsIntact = false;
+
+    if( size > MAX_PAYLOAD_BYTES )
+    {
+        return false;
+    }
+
+    mPayload.resize( static_cast<size_t>( size ) );
+
+    if( ( ::fread( mPayload.data(), 1, mPayload.size(), mFile ) != mPayload.size() ) ||
+        ( ::fread( &checksum, sizeof( checksum ), 1, mFile ) != 1 ) || ( checksum != Checksum( mPayload ) ) )
+    {
+        return false;
+    }
+
+    PayloadCursor cursor( mPayload );
+    step.Clear();
+
+    const U64 flags = cursor.Varint();
+    step.mHighSpeed = ( flags & SIDECAR_STEP_HIGH_SPEED ) != 0;
+    step.mIsResyncNeeded = ( flags & SIDECAR_STEP_RESYNC_NEEDED ) != 0;
+
+    const U64 spanCount = cursor.Varint();
+    step.mSpansBeforePacket = static_cast<size_t>( cursor.Varint() );
+
+    if( ( spanCount > size ) || ( step.mSpansBeforePacket > spanCount ) )
+    {
+        return false;
+    }
+
+    U64 reference = mState.mEndSample;
+
+    for( U64 i = 0; i < spanCount; ++i )
+    {
+        LineSpan span;
+        span.mLevel = cursor.Byte() ? BIT_HIGH : BIT_LOW;
+        span.mBeginSample = reference + cursor.Signed();
+        span.mEndSample = span.mBeginSample + cursor.Varint();
+        step.mSpans.push_back( span );
+        reference = span.mEndSample;
+    }
+
+    const U64 pixelCount = cursor.Varint();
+
+    if( pixelCount > MAX_PIXELS )
+    {
+        return false;
+    }
+
+    step.mPixels.resize( static_cast<size_t>( pixelCount ) );
+
+    if( pixelCount > 0 )
+    {
+        step.mPixels[ 0 ].mBeginSample = mState.mEndSample + cursor.Signed();
+        cursor.ZeroRuns( step.mPixels.size() - 1, mTiming );
+        S64 distance = 0;
+
+        for( size_t i = 1; i < step.mPixels.size(); ++i )
+        {
+            distance += mTiming[ i - 1 ];
+            step.mPixels[ i ].mBeginSample = step.mPixels[ i - 1 ].mBeginSample + distance;
+        }
+
+        cursor.ZeroRuns( step.mPixels.size() - 1, mTiming );
+
+        for( size_t i = 0; i + 1 < step.mPixels.size(); ++i )
+        {
+            step.mPixels[ i ].mEndSample = step.mPixels[ i + 1 ].mBeginSample - 1 - mTiming[ i ];
+        }
+
+        DecodedPixel& last = step.mPixels.back();
+        last.mEndSample = last.mBeginSample + cursor.Varint();
+
+        size_t led = 0;
+
+        while( ( led < step.mPixels.size() ) && cursor.IsValid() )
+        {
+            const U64 unchanged = cursor.Varint();
+
+            for( U64 i = 0; ( i < unchanged ) && ( led < step.mPixels.size() ) && ( led < mState.mColors.size() ); ++i, ++led )
+            {
+                step.mPixels[ led ].mRGB = mState.mColors[ led ];
+            }
+
+            const U64 changed = cursor.Varint();
+
+            for( U64 i = 0; ( i < changed ) && ( led < step.mPixels.size() ); ++i, ++led )
+            {
+                RGBValue& rgb = step.mPixels[ led ].mRGB;
+                rgb.red = cursor.Channel( mKey.mBitSize );
+                rgb.green = cursor.Channel( mKey.mBitSize );
+                rgb.blue = cursor.Channel( mKey.mBitSize );
+            }
+
+            if( ( unchanged == 0 ) && ( changed == 0 ) )
+            {
+                return false;
+            }
+        }
+
+        mState.mColors.resize( step.mPixels.size() );
+
+        for( size_t i = 0; i < step.mPixels.size(); ++i )
+        {
+            mState.mColors[ i ] = step.mPixels[ i ].mRGB;
+        }
+    }
+
+    step.mEndSample = mState.mEndSample + cursor.Signed();
+
+    if( !cursor.IsValid() )
+    {
+        return false;
+    }
+
+    mState.mEndSample = step.mEndSample;
+    mIntactBytes = static_cast<U64>( ::ftell( mFile ) );
+    mIsIntact = true;
+    return true;
+}
+
+void ResultsSidecarReader::Close()
+{
+    if( mFile )
+    {
+        ::fclose( mFile );
+        mFile = nullptr;
+    }
+}
+
+ResultsSidecarWriter::~ResultsSidecarWriter()
+{
+    Close();
+}
+
+bool ResultsSidecarWriter::Open( const std::string& path, const SidecarKey& key )
+{
+    Close();
+    mFile = ::fopen( path.c_str(), "wb" );
+
+    if( !mFile )
+    {
+        return false;
+    }
+
+    WriteHeader( key );
+    ::fflush( mFile );
+
+    mBitSize = key.mBitSize;
+    mState = SidecarCodecState();
+    return true;
+}
+
+bool ResultsSidecarWriter::Append( const std::string& path, const SidecarKey& key, const SidecarCodecState& state )
+{
+    Close();
+
+    // not "ab", which would keep UpdateKey from going back to the header
+    mFile = ::fopen( path.c_str(), "r+b" );
+
+    if( !mFile )
+    {
+        return false;
+    }
+
+    ::fseek( mFile, 0, SEEK_END );
+    mBitSize = key.mBitSize;
+    mState = state;
+    return true;
+}
+
+bool ResultsSidecarWriter::Truncate( const std::string& path, const SidecarKey& key, const SidecarCodecState& state, U64 size )
+{
+    Close();
+
+    // there is no portable way to shorten a file in place, so the bytes kept
+    // are read and written back
+    std::vector<U8> kept( static_cast<size_t>( size ) );
+    FILE* file = ::fopen( path.c_str(), "rb" );
+    const bool isRead = file && ( ::fread( kept.data(), 1, kept.size(), file ) == kept.size() );
+
+    if( file )
+    {
+        ::fclose( file );
+    }
+
+    if( !isRead )
+    {
+        return false;
+    }
+
+    mFile = ::fopen( path.c_str(), "wb" );
+
+    if( !mFile )
+    {
+        return false;
+    }
+
+    ::fwrite( kept.data(), 1, kept.size(), mFile );
+    ::fflush( mFile );
+
+    mBitSize = key.mBitSize;
+    mState = state;
+    return true;
+}
+
+void ResultsSidecarWriter::Write( const SidecarStep& step )
+{
+    if( !mFile )
+    {
+        return;
+    }
+
+    mPayload.clear();
+    PutVarint( mPayload, ( step.mHighSpeed ? SIDECAR_STEP_HIGH_SPEED : 0 ) | ( step.mIsResyncNeeded ? SIDECAR_STEP_RESYNC_NEEDED : 0 ) );
+    PutVarint( mPayload, step.mSpans.size() );
+    PutVarint( mPayload, step.mSpansBeforePacket );
+
+    U64 reference = mState.mEndSample;
+
+    for( const LineSpan& span : step.mSpans )
+    {
+        mPayload.push_back( span.mLevel == BIT_HIGH ? 1 : 0 );
+        PutSigned( mPayload, static_cast<S64>( span.mBeginSample - reference ) );
+        PutVarint( mPayload, span.mEndSample - span.mBeginSample );
+        reference = span.mEndSample;
+    }
+
+    const std::vector<DecodedPixel>& pixels = step.mPixels;
+    PutVarint( mPayload, pixels.size() );
+
+    if( !pixels.empty() )
+    {
+        PutSigned( mPayload, static_cast<S64>( pixels[ 0 ].mBeginSample - mState.mEndSample ) );
+        mTiming.clear();
+        S64 lastDistance = 0;
+
+        for( size_t i = 1; i < pixels.size(); ++i )
+        {
+            const S64 distance = static_cast<S64>( pixels[ i ].mBeginSample - pixels[ i - 1 ].mBeginSample );
+            mTiming.push_back( distance - lastDistance );
+            lastDistance = distance;
+        }
+
+        PutZeroRuns( mPayload, mTiming );
+
+        // a pixel normally ends where the next one begins
+        mTiming.clear();
+
+        for( size_t i = 0; i + 1 < pixels.size(); ++i )
+        {
+            mTiming.push_back( static_cast<S64>( pixels[ i + 1 ].mBeginSample - 1 - pixels[ i ].mEndSample ) );
+        }
+
+        PutZeroRuns( mPayload, mTiming );
+        PutVarint( mPayload, pixels.back().mEndSample - pixels.back().mBeginSample );
+
+        size_t led = 0;
+
+        while( led < pixels.size() )
+        {
+            const size_t unchangedBegin = led;
+
+            while( ( led < pixels.size() ) && ( led < mState.mColors.size() ) && IsSameColor( pixels[ led ].mRGB, mState.mColors[ led ] ) )
+            {
+                ++led;
+            }
+
+            const size_t changedBegin = led;
+
+            while( ( led < pixels.size() ) &&
+                   ( ( led >= mState.mColors.size() ) || !IsSameColor( pixels[ led ].mRGB, mState.mColors[ led ] ) ) )
+            {
+                ++led;
+            }
+
+            PutVarint( mPayload, changedBegin - unchangedBegin );
+            PutVarint( mPayload, led - changedBegin );
+
+            for( size_t i = changedBegin; i < led; ++i )
+            {
+                PutChannel( mPayload, pixels[ i ].mRGB.red, mBitSize );
+                PutChannel( mPayload, pixels[ i ].mRGB.green, mBitSize );
+                PutChannel( mPayload, pixels[ i ].mRGB.blue, mBitSize );
+            }
+        }
+
+        mState.mColors.resize( pixels.size() );
+
+        for( size_t i = 0; i < pixels.size(); ++i )
+        {
+            mState.mColors[ i ] = pixels[ i ].mRGB;
+        }
+    }
+
+    PutSigned( mPayload, static_cast<S64>( step.mEndSample - mState.mEndSample ) );
+    mState.mEndSample = step.mEndSample;
+
+    std::vector<U8> size;
+    PutVarint( size, mPayload.size() );
+    const U32 checksum = Checksum( mPayload );
+
+    ::fwrite( size.data(), 1, size.size(), mFile );
+    ::fwrite( mPayload.data(), 1, mPayload.size(), mFile );
+    ::fwrite( &checksum, sizeof( checksum ), 1, mFile );
+
+    // a step is complete on disk before decoding moves on
+    ::fflush( mFile );
+}
+
+void ResultsSidecarWriter::UpdateKey( const SidecarKey& key )
+{
+    if( !mFile )
+    {
+        return;
+    }
+
+    ::fseek( mFile, 0, SEEK_SET );
+    WriteHeader( key );
+    ::fseek( mFile, 0, SEEK_END );
+    ::fflush( mFile );
+}
+
+void ResultsSidecarWriter::WriteHeader( const SidecarKey& key )
+{
+    const U32 bits = key.mBitSize;
+    ::fwrite( MAGIC, sizeof( MAGIC ), 1, mFile );
+    ::fwrite( &key.mSettingsHash, sizeof( key.mSettingsHash ), 1, mFile );
+    ::fwrite( &key.mChannelHash, sizeof( key.mChannelHash ), 1, mFile );
+    ::fwrite( &key.mChannelTransitions, sizeof( key.mChannelTransitions ), 1, mFile );
+    ::fwrite( &key.mSampleRateHz, sizeof( key.mSampleRateHz ), 1, mFile );
+    ::fwrite( &bits, sizeof( bits ), 1, mFile );
+}
+
+bool ResultsSidecarWriter::Close()
+{
+    if( !mFile )
+    {
+        return true;
+    }
+
+    const bool ok = ( ::ferror( mFile ) == 0 );
+    const bool closed = ( ::fclose( mFile ) == 0 );
+    mFile = nullptr;
+    return ok && closed;
+}
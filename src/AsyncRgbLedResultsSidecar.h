@@ -0,0 +1,205 @@
+#ifndef ASYNCRGBLED_RESULTS_SIDECAR_H
+#define ASYNCRGBLED_RESULTS_SIDECAR_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <AnalyzerTypes.h>
+
+#include "AsyncRgbLedDecoder.h"
+
+/// 64-bit FNV-1a, to key a sidecar to the settings and the channel data
+class Fnv1aHash
+{
+  public:
+    void Add( const void* data, size_t size );
+
+    void Add( U64 value )
+    {
+        Add( &value, sizeof( value ) );
+    }
+
+    U64 Value() const
+    {
+        return mValue;
+    }
+
+  private:
+    U64 mValue = 0xcbf29ce484222325ull;
+};
+
+/// what a sidecar is valid for. Any difference means decoding again.
+struct SidecarKey
+{
+    U64 mSettingsHash = 0;
+    U64 mChannelHash = 0;
+    U64 mChannelTransitions = 0; // how many transitions mChannelHash covers
+    double mSampleRateHz = 0.0;
+    U8 mBitSize = 8;
+
+    bool Matches( const SidecarKey& other ) const
+    {
+        return ( mSettingsHash == other.mSettingsHash ) && ( mChannelHash == other.mChannelHash ) &&
+               ( mChannelTransitions == other.mChannelTransitions ) && ( mSampleRateHz == other.mSampleRateHz ) &&
+               ( mBitSize == other.mBitSize );
+    }
+};
+
+/// hash of everything decoding depends on besides the channel data
+U64 HashDecoderSettings( const ControllerTimingTable& timing, U8 bitSize, ColorLayout layout );
+
+/// what one pass of the analyzer's decoding loop produced: the idle and
+/// stuck spans, the pixels of at most one packet, and where decoding stood
+/// afterwards
+struct SidecarStep
+{
+    std::vector<LineSpan> mSpans;
+    size_t mSpansBeforePacket = 0; // the rest follow the packet
+    std::vector<DecodedPixel> mPixels;
+    bool mHighSpeed = false;
+    bool mIsResyncNeeded = false;
+    U64 mEndSample = 0;
+
+    void Clear();
+
+    /// nothing to replay, apart from the position
+    bool IsEmpty() const
+    {
+        return mSpans.empty() && mPixels.empty() && !mIsResyncNeeded;
+    }
+};
+
+/// the state both ends of the record encoding keep from step to step
+struct SidecarCodecState
+{
+    U64 mEndSample = 0;
+    std::vector<RGBValue> mColors; // of the last packet, by LED index
+};
+
+/**
+ * Compact record of the decoded results, so that reopening a capture can
+ * replay them rather than decode again. In native (little-endian) byte order:
+ *
+ *   header:   char[ 8 ] "ARGBSID1", U64 settings hash, U64 channel hash,
+ *             U64 transitions hashed, double sample rate in Hz,
+ *             U32 bits per channel
+ *   per step: varint payload size, payload, U32 FNV-1a (low half) of the
+ *             payload
+ *
+ * Varints are LEB128; signed values are zigzag encoded first. A payload
+ * holds the flags (SIDECAR_STEP_*), the spans, the pixels and the end
+ * sample of one SidecarStep. Sample numbers are deltas: spans and the first
+ * pixel from the end of the previous step, each further pixel as the change
+ * of its distance to the one before, and each pixel end from the start of
+ * the next pixel. Those are mostly zero, and stored as runs of zeros, so a
+ * steady bit rate takes a few bytes per packet. Colors are runs alternating
+ * between LEDs unchanged since the last packet and LEDs with their new
+ * values, one byte per channel up to 8 bits and two above.
+ *
+ * The writer flushes every step. A capture closed while decoding leaves a
+ * cut-off step at the end at most, which the checksum catches. The channel
+ * hash covers the first transitions of the capture, as many as there were
+ * when it was written; see UpdateKey. Later steps are checked against the
+ * channel as they are replayed, and the file is cut short at the first one
+ * which doesn't match, see Truncate.
+ */
+enum SidecarStepFlags
+{
+    SIDECAR_STEP_HIGH_SPEED = 1 << 0,
+    SIDECAR_STEP_RESYNC_NEEDED = 1 << 1
+};
+
+class ResultsSidecarReader
+{
+  public:
+    ResultsSidecarReader() = default;
+    ~ResultsSidecarReader();
+
+    ResultsSidecarReader( const ResultsSidecarReader& ) = delete;
+    ResultsSidecarReader& operator=( const ResultsSidecarReader& ) = delete;
+
+    /// false if the file is missing or not a sidecar. Whether it is for the
+    /// capture at hand is up to the caller, see Key.
+    bool Open( const std::string& path );
+
+    /// false at the end of the file, or at a damaged step
+    bool Read( SidecarStep& step );
+
+    void Close();
+
+    /// every byte read so far belongs to a complete step
+    bool IsIntact() const
+    {
+        return mIsIntact;
+    }
+
+    const SidecarKey& Key() const
+    {
+        return mKey;
+    }
+
+    const SidecarCodecState& State() const
+    {
+        return mState;
+    }
+
+    /// size of the header and the complete steps read so far
+    U64 IntactBytes() const
+    {
+        return mIntactBytes;
+    }
+
+  private:
+    FILE* mFile = nullptr;
+    SidecarKey mKey;
+    SidecarCodecState mState;
+    U64 mIntactBytes = 0;
+    std::vector<U8> mPayload;
+    std::vector<S64> mTiming;
+    bool mIsIntact = true;
+};
+
+class ResultsSidecarWriter
+{
+  public:
+    ResultsSidecarWriter() = default;
+    ~ResultsSidecarWriter();
+
+    ResultsSidecarWriter( const ResultsSidecarWriter& ) = delete;
+    ResultsSidecarWriter& operator=( const ResultsSidecarWriter& ) = delete;
+
+    /// replaces the file with an empty sidecar for the key
+    bool Open( const std::string& path, const SidecarKey& key );
+
+    /// carries on a sidecar which was read to its intact end
+    bool Append( const std::string& path, const SidecarKey& key, const SidecarCodecState& state );
+
+    /// carries on a sidecar from its first size bytes, as IntactBytes() gave
+    /// them along with the state, dropping the steps after them
+    bool Truncate( const std::string& path, const SidecarKey& key, const SidecarCodecState& state, U64 size );
+
+    bool IsOpen() const
+    {
+        return mFile != nullptr;
+    }
+
+    void Write( const SidecarStep& step );
+
+    /// rewrites the header, for a key covering more of the channel data
+    void UpdateKey( const SidecarKey& key );
+
+    /// returns false if any write failed
+    bool Close();
+
+  private:
+    void WriteHeader( const SidecarKey& key );
+
+    FILE* mFile = nullptr;
+    U8 mBitSize = 8;
+    SidecarCodecState mState;
+    std::vector<U8> mPayload;
+    std::vector<S64> mTiming;
+};
+
+#endif // ASYNCRGBLED_RESULTS_SIDECAR_H
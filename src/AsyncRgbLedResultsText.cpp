@@ -0,0 +1,304 @@
+#include "AsyncRgbLedResultsText.h"
+
+#include <algorithm> // for std::min
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include <AnalyzerHelpers.h>
+
+void FormatPixelChannels( const RGBValue& rgb, DisplayBase base, U8 bitSize, size_t bufSize, char* redBuf, char* greenBuf, char* blueBuf )
+{
+    // generate a numerical representation of each color channel,
+    // respecting the display-base setting
+    AnalyzerHelpers::GetNumberString( rgb.red, base, bitSize, redBuf, static_cast<U32>( bufSize ) );
+    AnalyzerHelpers::GetNumberString( rgb.green, base, bitSize, greenBuf, static_cast<U32>( bufSize ) );
+    AnalyzerHelpers::GetNumberString( rgb.blue, base, bitSize, blueBuf, static_cast<U32>( bufSize ) );
+}
+
+void FormatWebColor( const RGBValue& rgb, U8 bitSize, char ( &webBuf )[ 8 ] )
+{
+    U8 webColor[ 3 ];
+    rgb.ConvertTo8Bit( bitSize, webColor );
+    ::snprintf( webBuf, sizeof( webBuf ), "#%02x%02x%02x", webColor[ 0 ], webColor[ 1 ], webColor[ 2 ] );
+}
+
+void FormatPixelBubbleText( const Frame& frame, DisplayBase base, U8 bitSize, PixelBubbleText& text )
+{
+    const U32 ledIndex = PixelFrameData::CreateFromU64( frame.mData2 ).mLedIndex;
+    const RGBValue rgb = RGBValue::CreateFromU64( frame.mData1 );
+
+    // generate a Web/CSS representation of the color value
+    char webBuf[ 8 ];
+    FormatWebColor( rgb, bitSize, webBuf );
+
+    const int colorNumericBufferLength = 16;
+    char redString[ colorNumericBufferLength ], greenString[ colorNumericBufferLength ], blueString[ colorNumericBufferLength ];
+
+    FormatPixelChannels( rgb, base, bitSize, colorNumericBufferLength, redString, greenString, blueString );
+
+    // generate four different string variants of varying length, starting with
+    // the longest and decreasing in size
+    const size_t length = PixelBubbleText::MAX_LENGTH;
+
+    // example: LED: 13 Red: 0x1A Green: 0x2B Blue: 0x3C #1A2B3C
+    ::snprintf( text.mVariants[ 0 ], length, "LED %d Red: %s Green: %s Blue: %s %s", ledIndex, redString, greenString, blueString, webBuf );
+
+    // example: 13 R:0x1A G:0x2B B:0x3C #1A2B3C
+    ::snprintf( text.mVariants[ 1 ], length, "%d R: %s G: %s B: %s %s", ledIndex, redString, greenString, blueString, webBuf );
+
+    // example: (13) #1A2B3C
+    ::snprintf( text.mVariants[ 2 ], length, "(%d) %s", ledIndex, webBuf );
+
+    // example: #1A2B3C
+    ::snprintf( text.mVariants[ 3 ], length, "%s", webBuf );
+}
+
+void FormatPixelTabularText( const Frame& frame, DisplayBase base, U8 bitSize, size_t bufSize, char* buf )
+{
+    const U32 ledIndex = PixelFrameData::CreateFromU64( frame.mData2 ).mLedIndex;
+    const RGBValue rgb = RGBValue::CreateFromU64( frame.mData1 );
+
+    const int colorNumericBufferLength = 8;
+    char redString[ colorNumericBufferLength ], greenString[ colorNumericBufferLength ], blueString[ colorNumericBufferLength ];
+
+    FormatPixelChannels( rgb, base, bitSize, colorNumericBufferLength, redString, greenString, blueString );
+
+    // target content: [13] 0x1A, 0x2B, 0x3C
+    ::snprintf( buf, bufSize, "[%d] %s, %s, %s", ledIndex, redString, greenString, blueString );
+}
+
+namespace
+{
+    /// the first frame in [ 0, FrameCount() ) for which isBefore is false
+    template <typename Predicate>
+    U64 PartitionPoint( PixelFrameStore& frames, Predicate isBefore )
+    {
+        U64 low = 0;
+        U64 high = frames.FrameCount();
+
+        while( low < high )
+        {
+            const U64 middle = low + ( high - low ) / 2;
+
+            if( isBefore( frames.PixelFrame( middle ) ) )
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        return low;
+    }
+}
+
+bool ParseExportWindow( const char* text, double& beginSec, double& endSec )
+{
+    int consumed = 0;
+
+    if( ( ::sscanf( text, " %lf , %lf %n", &beginSec, &endSec, &consumed ) != 2 ) || ( text[ consumed ] != '\0' ) )
+    {
+        return false;
+    }
+
+    return beginSec <= endSec;
+}
+
+bool ParsePacketRange( const char* text, U64& firstPacket, U64& lastPacket )
+{
+    unsigned long long first, last;
+    int consumed = 0;
+
+    if( ( ::sscanf( text, " %llu , %llu %n", &first, &last, &consumed ) != 2 ) || ( text[ consumed ] != '\0' ) || ( first > last ) )
+    {
+        return false;
+    }
+
+    firstPacket = first;
+    lastPacket = last;
+    return true;
+}
+
+U64 FindFirstFrameAtOrAfterSample( PixelFrameStore& frames, U64 sample )
+{
+    return PartitionPoint( frames, [sample]( const Frame& frame ) { return static_cast<U64>( frame.mStartingSampleInclusive ) < sample; } );
+}
+
+U64 FindFirstFrameOfPacket( PixelFrameStore& frames, U64 packetIndex )
+{
+    return PartitionPoint( frames,
+                           [packetIndex]( const Frame& frame ) { return PixelFrameData::CreateFromU64( frame.mData2 ).mPacketIndex < packetIndex; } );
+}
+
+bool ExportPixelsCsv( const char* file, PixelFrameStore& frames, DisplayBase base, U8 bitSize, U64 triggerSample, U32 sampleRateHz,
+                      U64 beginFrame, U64 endFrame )
+{
+    std::ofstream file_stream( file, std::ios::out );
+
+    file_stream << "Time [s], Packet ID, LED Index, Red, Green, Blue, Web-CSS" << std::endl;
+
+    const U64 num_frames = std::min( endFrame, frames.FrameCount() );
+
+    for( U64 i = beginFrame; i < num_frames; i++ )
+    {
+        const Frame frame = frames.PixelFrame( i );
+        const PixelFrameData frameData = PixelFrameData::CreateFromU64( frame.mData2 );
+
+        char time_str[ 128 ];
+        AnalyzerHelpers::GetTimeString( frame.mStartingSampleInclusive, triggerSample, sampleRateHz, time_str, 128 );
+
+        RGBValue rgb = RGBValue::CreateFromU64( frame.mData1 );
+
+        // RGB numerical value representation
+        const size_t bufSize = 16;
+        char rs[ bufSize ], gs[ bufSize ], bs[ bufSize ];
+        FormatPixelChannels( rgb, base, bitSize, bufSize, rs, gs, bs );
+
+        // CSS representation
+        char webBuf[ 8 ];
+        FormatWebColor( rgb, bitSize, webBuf );
+
+        file_stream << time_str << "," << frameData.mPacketIndex << "," << frameData.mLedIndex << "," << rs << "," << gs << "," << bs << ","
+                    << webBuf << std::endl;
+
+        if( frames.UpdateProgressAndCheckForCancel( i - beginFrame, num_frames - beginFrame ) == true )
+        {
+            file_stream.close();
+            return false;
+        }
+    }
+
+    file_stream.close();
+    return true;
+}
+
+void ExportLedChangesCsv( const char* file, const PixelChangeIndex& changes, DisplayBase base, U8 bitSize, U64 triggerSample,
+                          U32 sampleRateHz )
+{
+    std::ofstream file_stream( file, std::ios::out );
+
+    file_stream << "LED Index, Time [s], Red, Green, Blue, Web-CSS" << std::endl;
+
+    const U32 ledCount = changes.LedCount();
+    std::vector<PixelChange> ledChanges;
+
+    for( U32 led = 0; led < ledCount; ++led )
+    {
+        changes.Changes( led, 0, ~U64( 0 ), ledChanges );
+
+        for( const PixelChange& change : ledChanges )
+        {
+            char time_str[ 128 ];
+            AnalyzerHelpers::GetTimeString( change.mSample, triggerSample, sampleRateHz, time_str, 128 );
+
+            const size_t bufSize = 16;
+            char rs[ bufSize ], gs[ bufSize ], bs[ bufSize ];
+            FormatPixelChannels( change.mRGB, base, bitSize, bufSize, rs, gs, bs );
+
+            char webBuf[ 8 ];
+            FormatWebColor( change.mRGB, bitSize, webBuf );
+
+            file_stream << led << "," << time_str << "," << rs << "," << gs << "," << bs << "," << webBuf << "\n";
+        }
+    }
+
+    file_stream.close();
+}
+
+void ExportTimingMarginsCsv( const char* file, const TimingMargins& margins )
+{
+    std::ofstream file_stream( file, std::ios::out );
+
+    // one row per histogram. Bin counts are semicolon-separated, and the bin start
+    // offsets relative to the nominal width are listed alongside; see
+    // TimingMarginHistogram for the bin layout.
+    file_stream << "Speed, Bit, Phase, Minimum [ns], Nominal [ns], Maximum [ns], Count, Underflow, Overflow, Worst Margin [ns], "
+                   "Worst Sample, Bin Start Offsets [ns], Bins"
+                << std::endl;
+
+    for( const bool isHighSpeed : { false, true } )
+    {
+        if( isHighSpeed && !margins.HasHighSpeed() )
+        {
+            break;
+        }
+
+        for( const auto b : { BIT_LOW, BIT_HIGH } )
+        {
+            for( const auto p : { PULSE_HIGH, PULSE_LOW } )
+            {
+                const TimingMarginHistogram& h = margins.Histogram( isHighSpeed, b, p );
+                const TimingTolerance& t = h.Tolerance();
+
+                file_stream << ( isHighSpeed ? "high" : "low" ) << "," << ( b == BIT_HIGH ? 1 : 0 ) << "," << ( p == PULSE_HIGH ? "high" : "low" )
+                            << "," << t.mMinimumSec * 1e9 << "," << t.mNominalSec * 1e9 << "," << t.mMaximumSec * 1e9 << "," << h.Count()
+                            << "," << h.Underflow() << "," << h.Overflow() << ",";
+
+                if( h.Count() > 0 )
+                {
+                    file_stream << h.WorstMarginSec() * 1e9 << "," << h.WorstSample();
+                }
+                else
+                {
+                    file_stream << ",";
+                }
+
+                file_stream << ",";
+
+                for( int bin = 0; bin < TimingMarginHistogram::BIN_COUNT; ++bin )
+                {
+                    file_stream << ( bin ? ";" : "" ) << h.BinStartOffsetSec( bin ) * 1e9;
+                }
+
+                file_stream << ",";
+
+                for( int bin = 0; bin < TimingMarginHistogram::BIN_COUNT; ++bin )
+                {
+                    file_stream << ( bin ? ";" : "" ) << h.Bin( bin );
+                }
+
+                file_stream << std::endl;
+            }
+        }
+    }
+
+    file_stream.close();
+}
+
+void ExportBitErrorsCsv( const char* file, const BitErrorEstimator& bitErrors )
+{
+    std::ofstream file_stream( file, std::ios::out );
+
+    file_stream << "Kind, Index, Bits Compared, Bits Flipped, Bit Error Rate" << std::endl;
+
+    const char* const channels[ 3 ] = { "red", "green", "blue" };
+
+    for( U32 position = 0; position < BitErrorEstimator::BIT_POSITION_COUNT; ++position )
+    {
+        const BitErrorCount count = bitErrors.BitPosition( position );
+
+        if( count.mComparedBits > 0 )
+        {
+            file_stream << "bit," << channels[ position / BitErrorEstimator::BITS_PER_CHANNEL_SLOT ] << " "
+                        << position % BitErrorEstimator::BITS_PER_CHANNEL_SLOT << "," << count.mComparedBits << "," << count.mFlippedBits
+                        << "," << count.Rate() << "\n";
+        }
+    }
+
+    const U32 ledCount = bitErrors.LedCount();
+
+    for( U32 led = 0; led < ledCount; ++led )
+    {
+        const BitErrorCount count = bitErrors.Led( led );
+
+        if( count.mComparedBits > 0 )
+        {
+            file_stream << "led," << led << "," << count.mComparedBits << "," << count.mFlippedBits << "," << count.Rate() << "\n";
+        }
+    }
+
+    file_stream.close();
+}
@@ -0,0 +1,82 @@
+#ifndef ASYNCRGBLED_RESULTS_TEXT_H
+#define ASYNCRGBLED_RESULTS_TEXT_H
+
+#include <AnalyzerResults.h>
+#include <AnalyzerTypes.h>
+
+#include "AsyncRgbLedBitErrors.h"
+#include "AsyncRgbLedChangeIndex.h"
+#include "AsyncRgbLedTimingMargins.h"
+
+/**
+ * @brief PixelFrameStore - read access to the pixel frames of a capture.
+ *
+ * The export code only goes through this, so it runs the same against the
+ * analyzer's results and against the in-memory store of the benchmark. Each
+ * frame carries its packet and LED index, see PixelFrameData.
+ */
+class PixelFrameStore
+{
+  public:
+    virtual ~PixelFrameStore() = default;
+
+    virtual U64 FrameCount() = 0;
+    virtual Frame PixelFrame( U64 frameIndex ) = 0;
+
+    /// returns true if the user cancelled the export
+    virtual bool UpdateProgressAndCheckForCancel( U64 completedFrames, U64 totalFrames ) = 0;
+};
+
+/// the bubble text of a pixel frame, longest variant first
+struct PixelBubbleText
+{
+    enum
+    {
+        VARIANT_COUNT = 4,
+        MAX_LENGTH = 128
+    };
+
+    char mVariants[ VARIANT_COUNT ][ MAX_LENGTH ];
+};
+
+/// red, green and blue in the display base, as AnalyzerHelpers::GetNumberString
+void FormatPixelChannels( const RGBValue& rgb, DisplayBase base, U8 bitSize, size_t bufSize, char* redBuf, char* greenBuf, char* blueBuf );
+
+/// "#rrggbb", scaled to 8 bits per channel
+void FormatWebColor( const RGBValue& rgb, U8 bitSize, char ( &webBuf )[ 8 ] );
+
+void FormatPixelBubbleText( const Frame& frame, DisplayBase base, U8 bitSize, PixelBubbleText& text );
+
+/// example: [13] 0x1A, 0x2B, 0x3C
+void FormatPixelTabularText( const Frame& frame, DisplayBase base, U8 bitSize, size_t bufSize, char* buf );
+
+/// one row per pixel frame in [ beginFrame, endFrame ). Returns false if the
+/// export was cancelled.
+bool ExportPixelsCsv( const char* file, PixelFrameStore& frames, DisplayBase base, U8 bitSize, U64 triggerSample, U32 sampleRateHz,
+                      U64 beginFrame = 0, U64 endFrame = ~U64( 0 ) );
+
+/// "begin, end" in seconds relative to the trigger, as the export's time column
+bool ParseExportWindow( const char* text, double& beginSec, double& endSec );
+
+/// "first, last" packet numbers, both included
+bool ParsePacketRange( const char* text, U64& firstPacket, U64& lastPacket );
+
+/// index of the first frame starting at or after the sample, by binary search.
+/// Frames are in sample order.
+U64 FindFirstFrameAtOrAfterSample( PixelFrameStore& frames, U64 sample );
+
+/// index of the first frame of the packet or a later one, by binary search.
+/// Packet numbers never decrease along the frames, see PixelFrameData.
+U64 FindFirstFrameOfPacket( PixelFrameStore& frames, U64 packetIndex );
+
+/// one row per change of each LED, ordered by LED index and then time
+void ExportLedChangesCsv( const char* file, const PixelChangeIndex& changes, DisplayBase base, U8 bitSize, U64 triggerSample,
+                          U32 sampleRateHz );
+
+/// one row per histogram, see TimingMarginHistogram for the bin layout
+void ExportTimingMarginsCsv( const char* file, const TimingMargins& margins );
+
+/// one row per bit position in use, then one per LED compared
+void ExportBitErrorsCsv( const char* file, const BitErrorEstimator& bitErrors );
+
+#endif // ASYNCRGBLED_RESULTS_TEXT_H
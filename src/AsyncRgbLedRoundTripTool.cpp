@@ -0,0 +1,499 @@
+// Round-trip check of the decoder: simulates scenarios for every controller,
+// decodes them and compares the pixels with the simulation's ground truth.
+// Decode throughput can be recorded into a JSON baseline, and later runs fail
+// when they are slower than the baseline by more than a threshold.
+
+#include <algorithm> // for std::min, std::max, std::lower_bound
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <strings.h> // for strcasecmp
+
+#include "AsyncRgbLedControllers.h"
+#include "AsyncRgbLedDecoder.h"
+#include "AsyncRgbLedSimulationScenario.h"
+
+namespace
+{
+    /// a simulated capture held in memory, replayed to the decoder
+    class TransitionBuffer : public WaveformSink, public TransitionEdgeSource
+    {
+      public:
+        void WritePulses( const U32* widths, size_t count ) override
+        {
+            for( size_t i = 0; i < count; ++i )
+            {
+                mTransitions.push_back( mEndSample );
+                mEndSample += widths[ i ];
+            }
+        }
+
+        void WriteIdle( U64 samples ) override
+        {
+            mEndSample += samples;
+        }
+
+        void Rewind()
+        {
+            Reset( BIT_LOW, mTransitions.size(), mEndSample );
+        }
+
+      protected:
+        U64 TransitionSample( U64 index ) const override
+        {
+            return mTransitions[ index ];
+        }
+
+      private:
+        std::vector<U64> mTransitions;
+        U64 mEndSample = 0;
+    };
+
+    /// noise is scaled to each controller, so every level means the same
+    /// for tight and loose timing
+    struct NoiseLevel
+    {
+        const char* mName;
+        double mJitterFraction;       // of the tightest timing margin
+        double mImpairedPacketChance; // split between glitches and dropped bits
+        bool mRequireExact;           // otherwise the minimum yield applies
+    };
+
+    const NoiseLevel NOISE_LEVELS[] = {
+        { "clean", 0.0, 0.0, true },
+        { "jitter", 0.0625, 0.0, true },
+        { "impaired", 0.0625, 0.05, false },
+    };
+
+    const double SAMPLE_RATES_HZ[] = { 50e6, 100e6, 500e6 };
+    const U32 PIXEL_COUNTS[] = { 1, 64, 1024 };
+
+    /// sample rates which leave less of the tightest margin than this are
+    /// too coarse for the timing to be checked reliably, and are skipped
+    const double MINIMUM_MARGIN_SAMPLES = 3.0;
+
+    struct ToolOptions
+    {
+        std::string mController; // empty for all of them
+        U32 mPackets = 40;
+        U32 mRepeats = 3;
+        double mMinimumYield = 0.9;
+        double mMaximumRegression = 0.2;
+        std::string mBaselinePath;
+        std::string mWriteBaselinePath;
+        bool mVerbose = false;
+    };
+
+    struct ScenarioResult
+    {
+        std::string mName;
+        U64 mPackets = 0;         // scored packets, without impaired ones
+        U64 mExactPackets = 0;    // decoded with every pixel matching
+        U64 mSpuriousPackets = 0; // decoded where no packet was sent
+        U64 mPixels = 0;          // decoded pixels per pass
+        double mPixelsPerSec = 0.0;
+        bool mOk = false;
+    };
+
+    void PrintUsage()
+    {
+        std::printf( "usage: async_rgb_led_roundtrip [options]\n"
+                     "\n"
+                     "Simulates every controller at several sample rates, strip lengths and noise\n"
+                     "levels, decodes the result and compares it with the simulated pixels.\n"
+                     "\n"
+                     "  --controller NAME         only check this controller\n"
+                     "  --packets N               packets per scenario (default 40)\n"
+                     "  --repeat N                decode passes timed per scenario, best is kept (default 3)\n"
+                     "  --min-yield PCT           packets which must decode exactly with noise (default 90)\n"
+                     "  --baseline FILE           fail when slower than this JSON baseline\n"
+                     "  --max-regression PCT      allowed slowdown against the baseline (default 20)\n"
+                     "  --write-baseline FILE     record the measured throughput as a baseline\n"
+                     "  --verbose                 report every scenario\n" );
+    }
+
+    bool ParseOptions( int argc, char** argv, ToolOptions& options )
+    {
+        for( int i = 1; i < argc; ++i )
+        {
+            const std::string arg = argv[ i ];
+
+            if( arg == "--verbose" )
+            {
+                options.mVerbose = true;
+            }
+            else if( arg == "--help" || arg == "-h" )
+            {
+                PrintUsage();
+                std::exit( EXIT_SUCCESS );
+            }
+            else if( ( arg.compare( 0, 2, "--" ) == 0 ) && ( i + 1 < argc ) )
+            {
+                const char* value = argv[ ++i ];
+
+                if( arg == "--controller" )
+                {
+                    options.mController = value;
+                }
+                else if( arg == "--packets" )
+                {
+                    options.mPackets = static_cast<U32>( std::max( 2, std::atoi( value ) ) );
+                }
+                else if( arg == "--repeat" )
+                {
+                    options.mRepeats = static_cast<U32>( std::max( 1, std::atoi( value ) ) );
+                }
+                else if( arg == "--min-yield" )
+                {
+                    options.mMinimumYield = std::atof( value ) / 100.0;
+                }
+                else if( arg == "--baseline" )
+                {
+                    options.mBaselinePath = value;
+                }
+                else if( arg == "--max-regression" )
+                {
+                    options.mMaximumRegression = std::atof( value ) / 100.0;
+                }
+                else if( arg == "--write-baseline" )
+                {
+                    options.mWriteBaselinePath = value;
+                }
+                else
+                {
+                    std::fprintf( stderr, "unknown option: %s\n", arg.c_str() );
+                    return false;
+                }
+            }
+            else
+            {
+                std::fprintf( stderr, "unknown option: %s\n", arg.c_str() );
+                PrintUsage();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /// reads the "name": number pairs written by WriteBaseline
+    bool ReadBaseline( const std::string& path, std::map<std::string, double>& baseline )
+    {
+        FILE* file = ::fopen( path.c_str(), "r" );
+
+        if( !file )
+        {
+            return false;
+        }
+
+        std::string text;
+        char buffer[ 4096 ];
+        size_t count;
+
+        while( ( count = ::fread( buffer, 1, sizeof( buffer ), file ) ) > 0 )
+        {
+            text.append( buffer, count );
+        }
+
+        ::fclose( file );
+
+        size_t pos = 0;
+
+        while( ( pos = text.find( '"', pos ) ) != std::string::npos )
+        {
+            const size_t end = text.find( '"', pos + 1 );
+
+            if( end == std::string::npos )
+            {
+                break;
+            }
+
+            const std::string name = text.substr( pos + 1, end - pos - 1 );
+            pos = text.find_first_not_of( " \t\r\n", end + 1 );
+
+            if( ( pos != std::string::npos ) && ( text[ pos ] == ':' ) )
+            {
+                char* numberEnd = nullptr;
+                const double value = std::strtod( text.c_str() + pos + 1, &numberEnd );
+
+                if( numberEnd != text.c_str() + pos + 1 )
+                {
+                    baseline[ name ] = value;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool WriteBaseline( const std::string& path, const std::vector<ScenarioResult>& results )
+    {
+        FILE* file = ::fopen( path.c_str(), "w" );
+
+        if( !file )
+        {
+            return false;
+        }
+
+        std::fprintf( file, "{\n  \"pixels_per_second\": {\n" );
+
+        for( size_t i = 0; i < results.size(); ++i )
+        {
+            std::fprintf( file, "    \"%s\": %.0f%s\n", results[ i ].mName.c_str(), results[ i ].mPixelsPerSec,
+                          ( i + 1 < results.size() ) ? "," : "" );
+        }
+
+        std::fprintf( file, "  }\n}\n" );
+        return ( ::fclose( file ) == 0 );
+    }
+
+    bool SamePixels( const DecodedPacket& decoded, const DecodedPacket& truth )
+    {
+        if( decoded.mPixels.size() != truth.mPixels.size() )
+        {
+            return false;
+        }
+
+        for( size_t i = 0; i < truth.mPixels.size(); ++i )
+        {
+            const RGBValue& a = decoded.mPixels[ i ].mRGB;
+            const RGBValue& b = truth.mPixels[ i ].mRGB;
+
+            if( ( a.red != b.red ) || ( a.green != b.green ) || ( a.blue != b.blue ) )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /// smallest distance between a nominal time and its limits
+    double TightestMarginSec( const LedControllerData& controller )
+    {
+        double margin = 1.0;
+
+        for( const BitTiming* timing : { controller.mDataTiming, controller.mDataTimingHighSpeed } )
+        {
+            for( const auto b : { BIT_LOW, BIT_HIGH } )
+            {
+                for( const TimingTolerance* t : { &timing[ b ].mPositiveTiming, &timing[ b ].mNegativeTiming } )
+                {
+                    margin = std::min( margin, std::min( t->mNominalSec - t->mMinimumSec, t->mMaximumSec - t->mNominalSec ) );
+                }
+            }
+
+            if( !controller.mHasHighSpeed )
+            {
+                break;
+            }
+        }
+
+        return margin;
+    }
+
+    ScenarioResult RunScenario( const LedControllerData& controller, double sampleRateHz, U32 pixelCount, const NoiseLevel& noise,
+                                const ToolOptions& options )
+    {
+        ScenarioResult result;
+        char name[ 128 ];
+        std::snprintf( name, sizeof( name ), "%s/%.0fMHz/%upx/%s", controller.mName.c_str(), sampleRateHz / 1e6, pixelCount, noise.mName );
+        result.mName = name;
+
+        SimulationScenario scenario;
+        scenario.mPixelCount = pixelCount;
+        scenario.mJitterSec = noise.mJitterFraction * TightestMarginSec( controller );
+
+        const double bitsPerPacket = pixelCount * 3.0 * controller.mBitsPerChannel;
+        scenario.mGlitchProbability = noise.mImpairedPacketChance / 2 / bitsPerPacket;
+        scenario.mDroppedBitProbability = noise.mImpairedPacketChance / 2 / bitsPerPacket;
+
+        SimulationScenarioGenerator generator;
+        std::string error;
+
+        if( !generator.Configure( controller, scenario, sampleRateHz, error ) )
+        {
+            std::fprintf( stderr, "%s: %s\n", name, error.c_str() );
+            return result;
+        }
+
+        TransitionBuffer capture;
+        std::vector<DecodedPacket> truth;
+        std::vector<bool> impaired;
+
+        for( U32 p = 0; p < options.mPackets; ++p )
+        {
+            generator.WritePacket( capture );
+            truth.push_back( generator.LastPacket() );
+            impaired.push_back( generator.IsLastPacketImpaired() );
+        }
+
+        // the first packet is only preceded by the nominal reset time, which
+        // the decoder doesn't take as a reset, so it isn't scored
+        for( size_t p = 1; p < truth.size(); ++p )
+        {
+            result.mPackets += impaired[ p ] ? 0 : 1;
+        }
+
+        std::vector<U64> truthBegins;
+
+        for( const DecodedPacket& packet : truth )
+        {
+            truthBegins.push_back( packet.mSummary.mBeginSample );
+        }
+
+        const ControllerTimingTable timing = BuildControllerTimingTable( controller, sampleRateHz );
+        double bestSec = 0.0;
+
+        for( U32 pass = 0; pass < options.mRepeats; ++pass )
+        {
+            capture.Rewind();
+            AsyncRgbLedDecoder decoder;
+            decoder.Configure( timing, controller.mBitsPerChannel, controller.mLayout, sampleRateHz );
+            decoder.SetSource( &capture );
+            decoder.SetLogErrors( false );
+
+            DecodedPacket packet;
+            U64 pixels = 0;
+            const auto start = std::chrono::steady_clock::now();
+
+            if( pass > 0 )
+            {
+                // timing only, scoring was done in the first pass
+                while( decoder.DecodePacket( packet ) )
+                {
+                    pixels += packet.mPixels.size();
+                }
+            }
+            else
+            {
+                while( decoder.DecodePacket( packet ) )
+                {
+                    pixels += packet.mPixels.size();
+                    const auto match = std::lower_bound( truthBegins.begin(), truthBegins.end(), packet.mSummary.mBeginSample );
+
+                    if( ( match == truthBegins.end() ) || ( *match != packet.mSummary.mBeginSample ) )
+                    {
+                        ++result.mSpuriousPackets;
+                        continue;
+                    }
+
+                    const size_t index = match - truthBegins.begin();
+
+                    if( ( index > 0 ) && !impaired[ index ] && SamePixels( packet, truth[ index ] ) )
+                    {
+                        ++result.mExactPackets;
+                    }
+                }
+            }
+
+            const double elapsedSec = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+            if( ( pass == 0 ) || ( elapsedSec < bestSec ) )
+            {
+                bestSec = elapsedSec;
+            }
+
+            result.mPixels = pixels;
+        }
+
+        result.mPixelsPerSec = ( bestSec > 0.0 ) ? result.mPixels / bestSec : 0.0;
+
+        if( noise.mRequireExact )
+        {
+            result.mOk = ( result.mExactPackets == result.mPackets ) && ( result.mSpuriousPackets == 0 );
+        }
+        else
+        {
+            const double yield = result.mPackets ? static_cast<double>( result.mExactPackets ) / result.mPackets : 1.0;
+            result.mOk = ( yield >= options.mMinimumYield );
+        }
+
+        return result;
+    }
+}
+
+int main( int argc, char** argv )
+{
+    ToolOptions options;
+
+    if( !ParseOptions( argc, argv, options ) )
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::map<std::string, double> baseline;
+
+    if( !options.mBaselinePath.empty() && !ReadBaseline( options.mBaselinePath, baseline ) )
+    {
+        std::fprintf( stderr, "can't read baseline %s\n", options.mBaselinePath.c_str() );
+        return EXIT_FAILURE;
+    }
+
+    std::vector<ScenarioResult> results;
+    int failures = 0;
+    int regressions = 0;
+    int skipped = 0;
+
+    for( const LedControllerData& controller : CreateControllerData() )
+    {
+        if( !options.mController.empty() && ( ::strcasecmp( options.mController.c_str(), controller.mName.c_str() ) != 0 ) )
+        {
+            continue;
+        }
+
+        for( const double sampleRateHz : SAMPLE_RATES_HZ )
+        {
+            if( TightestMarginSec( controller ) * sampleRateHz < MINIMUM_MARGIN_SAMPLES )
+            {
+                ++skipped;
+                continue;
+            }
+
+            for( const U32 pixelCount : PIXEL_COUNTS )
+            {
+                for( const NoiseLevel& noise : NOISE_LEVELS )
+                {
+                    const ScenarioResult r = RunScenario( controller, sampleRateHz, pixelCount, noise, options );
+                    results.push_back( r );
+
+                    const auto base = baseline.find( r.mName );
+                    const bool regressed =
+                        ( base != baseline.end() ) && ( r.mPixelsPerSec < base->second * ( 1.0 - options.mMaximumRegression ) );
+
+                    failures += r.mOk ? 0 : 1;
+                    regressions += regressed ? 1 : 0;
+
+                    if( options.mVerbose || !r.mOk || regressed )
+                    {
+                        std::printf( "%-40s %s%s %llu/%llu exact, %llu spurious, %.2f Mpixel/s", r.mName.c_str(), r.mOk ? "ok" : "FAILED",
+                                     regressed ? " SLOWER" : "", static_cast<unsigned long long>( r.mExactPackets ),
+                                     static_cast<unsigned long long>( r.mPackets ), static_cast<unsigned long long>( r.mSpuriousPackets ),
+                                     r.mPixelsPerSec / 1e6 );
+
+                        if( base != baseline.end() )
+                        {
+                            std::printf( " (baseline %.2f)", base->second / 1e6 );
+                        }
+
+                        std::printf( "\n" );
+                    }
+                }
+            }
+        }
+    }
+
+    if( !options.mWriteBaselinePath.empty() && !WriteBaseline( options.mWriteBaselinePath, results ) )
+    {
+        std::fprintf( stderr, "can't write baseline %s\n", options.mWriteBaselinePath.c_str() );
+        return EXIT_FAILURE;
+    }
+
+    std::printf( "%zu scenarios, %d failed, %d slower than the baseline, %d sample rates skipped\n", results.size(), failures, regressions,
+                 skipped );
+    return ( failures == 0 && regressions == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -3,11 +3,27 @@
 
 #include <SimulationChannelDescriptor.h>
 #include <AnalyzerHelpers.h>
-#include "AsyncRgbLedHelpers.h"
+#include "AsyncRgbLedSimulationScenario.h"
+#include "AsyncRgbLedWaveform.h"
 #include <string>
 
 class AsyncRgbLedAnalyzerSettings;
 
+/// forwards synthesized pulses to the simulated channel
+class SimulationChannelSink : public WaveformSink
+{
+  public:
+    explicit SimulationChannelSink( SimulationChannelDescriptor& channel ) : mChannel( channel )
+    {
+    }
+
+    void WritePulses( const U32* widths, size_t count ) override;
+    void WriteIdle( U64 samples ) override;
+
+  private:
+    SimulationChannelDescriptor& mChannel;
+};
+
 class AsyncRgbLedSimulationDataGenerator
 {
   public:
@@ -22,28 +38,8 @@ class AsyncRgbLedSimulationDataGenerator
     U32 mSimulationSampleRateHz;
 
   protected:
-    void CreateRGBWord();
-    RGBValue RandomRGBValue() const;
-
-    void WriteRGBTriple( const RGBValue& rgb );
-    void WriteUIntData( U16 data, U8 bit_count );
-    void WriteBit( bool b );
-
-    void WriteReset();
-
-    ClockGenerator mClockGenerator;
     SimulationChannelDescriptor mLEDSimulationData;
-
-    // largest value for a color channel in the selected controller.
-    // this is 2^bitSize - 1
-    U32 mMaximumChannelValue = 255;
-
-    U32 mFrameCount = 0;
-
-    /// do we generate high-speed data for some frames of this controller?
-    /// This depends on both the controller support and the requested
-    /// sample rate, if it's below 18Mhz we won't generate high speed data
-    bool mDoGenerateHighSpeedMode = false;
-    bool mHighSpeedMode = false;
+    SimulationChannelSink mSink{ mLEDSimulationData };
+    SimulationScenarioGenerator mScenario;
 };
 #endif // ASYNCRGBLED_SIMULATION_DATA_GENERATOR
@@ -0,0 +1,332 @@
+#include "AsyncRgbLedSimulationScenario.h"
+
+#include <algorithm> // for std::max
+#include <cmath>     // for llround, sqrt, log, cos
+#include <cstdio>
+
+namespace
+{
+    /// a typical ringing spike, long enough to be seen at any sample rate
+    const double GLITCH_SEC = 30e-9;
+
+    /// decorrelates the noise stream from the color stream of the same seed
+    const U64 NOISE_SEED_MIX = 0x9E3779B97F4A7C15ULL;
+
+    bool ReadWholeFile( const std::string& path, std::vector<U8>& data )
+    {
+        FILE* file = ::fopen( path.c_str(), "rb" );
+
+        if( !file )
+        {
+            return false;
+        }
+
+        data.clear();
+        U8 buffer[ 65536 ];
+        size_t count;
+
+        while( ( count = ::fread( buffer, 1, sizeof( buffer ), file ) ) > 0 )
+        {
+            data.insert( data.end(), buffer, buffer + count );
+        }
+
+        const bool ok = ( ::ferror( file ) == 0 );
+        ::fclose( file );
+        return ok;
+    }
+}
+
+bool SimulationScenarioGenerator::Configure( const LedControllerData& controller, const SimulationScenario& scenario, double sampleRateHz,
+                                             std::string& error )
+{
+    if( scenario.mPixelCount == 0 )
+    {
+        error = "a packet needs at least one pixel";
+        return false;
+    }
+
+    mReplayData.clear();
+    mReplayOffset = 0;
+    mPixels.clear();
+
+    if( scenario.mPattern == PATTERN_REPLAY )
+    {
+        if( !ReadWholeFile( scenario.mReplayPath, mReplayData ) )
+        {
+            error = "can't read replay file " + scenario.mReplayPath;
+            return false;
+        }
+
+        // ignore a trailing partial triple
+        mReplayData.resize( mReplayData.size() - mReplayData.size() % 3 );
+
+        if( mReplayData.empty() )
+        {
+            error = "replay file holds no RGB triples";
+            return false;
+        }
+    }
+
+    mController = controller;
+    mScenario = scenario;
+    mSampleRateHz = sampleRateHz;
+    mMaximumChannelValue = ( 1u << controller.mBitsPerChannel ) - 1;
+    mSynthesizer.Configure( controller, sampleRateHz );
+
+    mColorRandom.Seed( scenario.mSeed );
+    mNoiseRandom.Seed( scenario.mSeed ^ NOISE_SEED_MIX );
+    mGlitchSamples = static_cast<U32>( std::max<S64>( 1, std::llround( GLITCH_SEC * sampleRateHz ) ) );
+
+    mSampleNumber = 0;
+    mNextPacketSample = 0.0;
+    mPacketCount = 0;
+    mHighSpeedMode = false;
+    return true;
+}
+
+bool SimulationScenarioGenerator::OpenTruthFile( const std::string& path )
+{
+    mHasTruth = mTruth.Open( path, mController.mBitsPerChannel, mSampleRateHz );
+    return mHasTruth;
+}
+
+bool SimulationScenarioGenerator::CloseTruthFile()
+{
+    mHasTruth = false;
+    return mTruth.Close();
+}
+
+void SimulationScenarioGenerator::WritePacket( WaveformSink& sink )
+{
+    mSink = &sink;
+    mImpaired = false;
+
+    mSynthesizer.WriteReset( *this );
+    FillPixels();
+    mSynthesizer.WritePixels( mPixels.data(), mPixels.size(), mHighSpeedMode, *this );
+
+    if( mHasTruth )
+    {
+        mTruth.WritePacket( mPacketCount, mLastPacket, mImpaired ? PIXEL_PACKET_IMPAIRED : 0 );
+    }
+
+    ++mPacketCount;
+
+    if( mScenario.mRefreshRateHz > 0.0 )
+    {
+        // a packet longer than the refresh period delays the next one, as a
+        // real controller would, rather than sending the following ones early
+        mNextPacketSample = std::max( mNextPacketSample + mSampleRateHz / mScenario.mRefreshRateHz, static_cast<double>( mSampleNumber ) );
+        const U64 nextPacketSample = static_cast<U64>( std::llround( mNextPacketSample ) );
+
+        if( nextPacketSample > mSampleNumber )
+        {
+            WriteIdle( nextPacketSample - mSampleNumber );
+        }
+    }
+
+    // toggle high-speed mode every seven packets if it's supported
+    if( mScenario.mAlternateSpeedModes && mController.mHasHighSpeed && ( ( mPacketCount % 7 ) == 0 ) )
+    {
+        mHighSpeedMode = !mHighSpeedMode;
+    }
+
+    mSink = nullptr;
+}
+
+void SimulationScenarioGenerator::FillPixels()
+{
+    const U32 pixelCount = mScenario.mPixelCount;
+
+    if( ( mScenario.mPattern == PATTERN_STATIC ) && ( mPixels.size() == pixelCount ) )
+    {
+        return; // chosen for the first packet
+    }
+
+    mPixels.resize( pixelCount );
+
+    switch( mScenario.mPattern )
+    {
+    case PATTERN_RANDOM:
+    case PATTERN_STATIC:
+        for( RGBValue& pixel : mPixels )
+        {
+            // the bound is exclusive, so this covers [0, mMaximumChannelValue]
+            const U16 red = static_cast<U16>( mColorRandom.NextBelow( mMaximumChannelValue + 1 ) );
+            const U16 green = static_cast<U16>( mColorRandom.NextBelow( mMaximumChannelValue + 1 ) );
+            const U16 blue = static_cast<U16>( mColorRandom.NextBelow( mMaximumChannelValue + 1 ) );
+            pixel = RGBValue( red, green, blue );
+        }
+        break;
+
+    case PATTERN_GRADIENT_CHASE:
+        for( U32 i = 0; i < pixelCount; ++i )
+        {
+            // the gradient moves along the strip by one pixel per packet
+            mPixels[ i ] = GradientColor( static_cast<U32>( ( i + mPacketCount ) % pixelCount ) );
+        }
+        break;
+
+    case PATTERN_REPLAY:
+        for( RGBValue& pixel : mPixels )
+        {
+            U16 values[ 3 ];
+
+            for( U16& value : values )
+            {
+                // scale the 8-bit values up to the controller's bit size
+                value = static_cast<U16>( ( mReplayData[ mReplayOffset++ ] * mMaximumChannelValue + 127 ) / 255 );
+            }
+
+            pixel = RGBValue( values[ 0 ], values[ 1 ], values[ 2 ] );
+
+            if( mReplayOffset == mReplayData.size() )
+            {
+                mReplayOffset = 0;
+            }
+        }
+        break;
+    }
+}
+
+RGBValue SimulationScenarioGenerator::GradientColor( U32 position ) const
+{
+    // one full turn of the color wheel along the strip: red to green to blue
+    const double hue = position * 3.0 / mScenario.mPixelCount;
+    const int segment = static_cast<int>( hue );
+    const U16 rising = static_cast<U16>( std::llround( ( hue - segment ) * mMaximumChannelValue ) );
+    const U16 falling = static_cast<U16>( mMaximumChannelValue - rising );
+
+    switch( segment )
+    {
+    case 0:
+        return RGBValue( falling, rising, 0 );
+    case 1:
+        return RGBValue( 0, falling, rising );
+    default:
+        return RGBValue( rising, 0, falling );
+    }
+}
+
+double SimulationScenarioGenerator::NextGaussian()
+{
+    // Box-Muller transform, 1 - u keeps the logarithm finite
+    const double u1 = 1.0 - mNoiseRandom.NextDouble();
+    const double u2 = mNoiseRandom.NextDouble();
+    return std::sqrt( -2.0 * std::log( u1 ) ) * std::cos( 6.283185307179586 * u2 );
+}
+
+void SimulationScenarioGenerator::RecordPacket( const U32* widths, size_t count )
+{
+    const size_t widthsPerPixel = count / mPixels.size();
+    mLastPacket.mPixels.resize( mPixels.size() );
+    U64 sample = mSampleNumber;
+    const U32* width = widths;
+
+    for( size_t p = 0; p < mPixels.size(); ++p )
+    {
+        DecodedPixel& pixel = mLastPacket.mPixels[ p ];
+        pixel.mRGB = mPixels[ p ];
+        pixel.mBeginSample = sample;
+
+        for( size_t i = 0; i < widthsPerPixel; ++i )
+        {
+            sample += *width++;
+        }
+
+        pixel.mEndSample = sample - 1;
+    }
+
+    PacketSummary& summary = mLastPacket.mSummary;
+    summary.mBeginSample = mLastPacket.mPixels.front().mBeginSample;
+    summary.mEndSample = mLastPacket.mPixels.back().mEndSample;
+    summary.mPixelCount = static_cast<U32>( mPixels.size() );
+    summary.mBitCount = static_cast<U32>( count / 2 );
+    summary.mHighSpeed = mHighSpeedMode;
+}
+
+void SimulationScenarioGenerator::WritePulses( const U32* widths, size_t count )
+{
+    RecordPacket( widths, count );
+
+    const double jitterSamples = mScenario.mJitterSec * mSampleRateHz;
+
+    if( ( jitterSamples <= 0.0 ) && ( mScenario.mGlitchProbability <= 0.0 ) && ( mScenario.mDroppedBitProbability <= 0.0 ) )
+    {
+        mSink->WritePulses( widths, count );
+
+        for( size_t i = 0; i < count; ++i )
+        {
+            mSampleNumber += widths[ i ];
+        }
+
+        return;
+    }
+
+    mWidths.clear();
+
+    // widths come in high, low pairs, one per bit
+    for( size_t i = 0; i < count; i += 2 )
+    {
+        if( ( mScenario.mDroppedBitProbability > 0.0 ) && ( mNoiseRandom.NextDouble() < mScenario.mDroppedBitProbability ) )
+        {
+            mImpaired = true;
+            continue;
+        }
+
+        const U32 high = widths[ i ];
+        const U32 low = widths[ i + 1 ];
+        mWidths.push_back( high );
+
+        if( ( mScenario.mGlitchProbability > 0.0 ) && ( mNoiseRandom.NextDouble() < mScenario.mGlitchProbability ) &&
+            ( low >= mGlitchSamples + 2 ) )
+        {
+            // a short spike in the middle of the low period
+            const U32 before = ( low - mGlitchSamples ) / 2;
+            mWidths.push_back( before );
+            mWidths.push_back( mGlitchSamples );
+            mWidths.push_back( low - mGlitchSamples - before );
+            mImpaired = true;
+        }
+        else
+        {
+            mWidths.push_back( low );
+        }
+    }
+
+    if( jitterSamples > 0.0 )
+    {
+        // move every edge after the first independently, keeping them in
+        // order. The end of the final low period isn't an edge, so it stays.
+        U64 exactEdge = 0;
+        S64 previousEdge = 0;
+
+        for( size_t i = 0; i < mWidths.size(); ++i )
+        {
+            exactEdge += mWidths[ i ];
+            S64 edge = static_cast<S64>( exactEdge );
+
+            if( i + 1 < mWidths.size() )
+            {
+                edge = std::llround( exactEdge + jitterSamples * NextGaussian() );
+            }
+
+            edge = std::max( edge, previousEdge + 1 );
+            mWidths[ i ] = static_cast<U32>( edge - previousEdge );
+            previousEdge = edge;
+        }
+    }
+
+    mSink->WritePulses( mWidths.data(), mWidths.size() );
+
+    for( const U32 width : mWidths )
+    {
+        mSampleNumber += width;
+    }
+}
+
+void SimulationScenarioGenerator::WriteIdle( U64 samples )
+{
+    mSink->WriteIdle( samples );
+    mSampleNumber += samples;
+}
@@ -0,0 +1,134 @@
+#ifndef ASYNCRGBLED_SIMULATION_SCENARIO_H
+#define ASYNCRGBLED_SIMULATION_SCENARIO_H
+
+#include <string>
+#include <vector>
+
+#include <AnalyzerTypes.h>
+
+#include "AsyncRgbLedControllers.h"
+#include "AsyncRgbLedDecoder.h"
+#include "AsyncRgbLedPixelFile.h"
+#include "AsyncRgbLedWaveform.h"
+
+enum SimulationPattern
+{
+    PATTERN_RANDOM = 0, // new random colors in every packet
+    PATTERN_STATIC,     // random colors, repeated in every packet
+    PATTERN_GRADIENT_CHASE,
+    PATTERN_REPLAY // 8-bit RGB triples read from a raw file
+};
+
+/// what the simulated strip looks like, and how the signal is degraded
+struct SimulationScenario
+{
+    U32 mSeed = 42;
+    U32 mPixelCount = 6;
+
+    /// packets per second, or zero to send packets back to back
+    double mRefreshRateHz = 0.0;
+
+    SimulationPattern mPattern = PATTERN_RANDOM;
+    std::string mReplayPath;
+
+    /// switch between low and high speed every seven packets, when the
+    /// controller supports it
+    bool mAlternateSpeedModes = true;
+
+    /// standard deviation of the position of each edge
+    double mJitterSec = 0.0;
+
+    /// chance per bit of a short spike in the low period
+    double mGlitchProbability = 0.0;
+
+    /// chance per bit that it's left out entirely
+    double mDroppedBitProbability = 0.0;
+};
+
+/**
+ * @brief SimulationScenarioGenerator - generates packets of a scenario as
+ * waveforms, optionally recording the transmitted pixels as ground truth.
+ *
+ * Colors and noise come from separate random streams, so changing the noise
+ * settings keeps the same colors for the same seed.
+ */
+class SimulationScenarioGenerator : private WaveformSink
+{
+  public:
+    /// returns false and fills in error if the scenario can't be used
+    bool Configure( const LedControllerData& controller, const SimulationScenario& scenario, double sampleRateHz, std::string& error );
+
+    /**
+     * Record every packet into a pixel file, in the format of the command-line
+     * decoder. Packets with injected glitches or dropped bits are flagged with
+     * PIXEL_PACKET_IMPAIRED. Sample numbers are those of the clean waveform:
+     * a packet runs from its first rising edge to the end of its last bit.
+     */
+    bool OpenTruthFile( const std::string& path );
+    bool CloseTruthFile();
+
+    /// reset, one packet of pixels, then idle up to the refresh period
+    void WritePacket( WaveformSink& sink );
+
+    U64 SampleNumber() const
+    {
+        return mSampleNumber;
+    }
+
+    U64 PacketCount() const
+    {
+        return mPacketCount;
+    }
+
+    /// the pixels of the last packet as transmitted, with the same sample
+    /// numbers as in the truth file
+    const DecodedPacket& LastPacket() const
+    {
+        return mLastPacket;
+    }
+
+    /// whether glitches or dropped bits were injected into the last packet
+    bool IsLastPacketImpaired() const
+    {
+        return mImpaired;
+    }
+
+  private:
+    void FillPixels();
+    RGBValue GradientColor( U32 position ) const;
+    double NextGaussian();
+
+    /// fill in mLastPacket from the clean pulse widths of the pixels
+    void RecordPacket( const U32* widths, size_t count );
+
+    void WritePulses( const U32* widths, size_t count ) override;
+    void WriteIdle( U64 samples ) override;
+
+    LedControllerData mController;
+    SimulationScenario mScenario;
+    double mSampleRateHz = 0.0;
+    U32 mMaximumChannelValue = 255;
+
+    WaveformSynthesizer mSynthesizer;
+    Pcg32Random mColorRandom;
+    Pcg32Random mNoiseRandom;
+    std::vector<U8> mReplayData;
+    size_t mReplayOffset = 0;
+
+    WaveformSink* mSink = nullptr;
+    U64 mSampleNumber = 0;
+    double mNextPacketSample = 0.0;
+    U64 mPacketCount = 0;
+    bool mHighSpeedMode = false;
+    bool mImpaired = false;
+
+    U32 mGlitchSamples = 1;
+    std::vector<U32> mWidths;
+    std::vector<RGBValue> mPixels;
+
+    DecodedPacket mLastPacket;
+    PixelFileWriter mTruth;
+    bool mHasTruth = false;
+};
+
+#endif // ASYNCRGBLED_SIMULATION_SCENARIO_H
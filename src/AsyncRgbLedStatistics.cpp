@@ -0,0 +1,239 @@
+#include "AsyncRgbLedStatistics.h"
+
+#include <algorithm> // for std::sort, std::min, std::max
+#include <cmath>     // for std::sqrt
+
+QuantileEstimator::QuantileEstimator( double quantile ) : mQuantile( quantile )
+{
+    for( int i = 0; i < 5; ++i )
+    {
+        mHeights[ i ] = 0.0;
+        mPositions[ i ] = i + 1;
+    }
+
+    mDesiredPositions[ 0 ] = 1.0;
+    mDesiredPositions[ 1 ] = 1.0 + 2.0 * quantile;
+    mDesiredPositions[ 2 ] = 1.0 + 4.0 * quantile;
+    mDesiredPositions[ 3 ] = 3.0 + 2.0 * quantile;
+    mDesiredPositions[ 4 ] = 5.0;
+
+    mIncrements[ 0 ] = 0.0;
+    mIncrements[ 1 ] = quantile / 2.0;
+    mIncrements[ 2 ] = quantile;
+    mIncrements[ 3 ] = ( 1.0 + quantile ) / 2.0;
+    mIncrements[ 4 ] = 1.0;
+}
+
+void QuantileEstimator::Add( double value )
+{
+    // the first five values are simply collected, and become the initial
+    // marker heights once sorted
+    if( mCount < 5 )
+    {
+        mHeights[ mCount++ ] = value;
+
+        if( mCount == 5 )
+        {
+            std::sort( mHeights, mHeights + 5 );
+        }
+
+        return;
+    }
+
+    ++mCount;
+
+    // find the cell containing the new value, extending the extremes if needed
+    int k;
+
+    if( value < mHeights[ 0 ] )
+    {
+        mHeights[ 0 ] = value;
+        k = 0;
+    }
+    else if( value >= mHeights[ 4 ] )
+    {
+        mHeights[ 4 ] = value;
+        k = 3;
+    }
+    else
+    {
+        k = 0;
+
+        while( value >= mHeights[ k + 1 ] )
+        {
+            ++k;
+        }
+    }
+
+    for( int i = k + 1; i < 5; ++i )
+    {
+        mPositions[ i ] += 1.0;
+    }
+
+    for( int i = 0; i < 5; ++i )
+    {
+        mDesiredPositions[ i ] += mIncrements[ i ];
+    }
+
+    // adjust the three middle markers if they drifted from their desired positions
+    for( int i = 1; i < 4; ++i )
+    {
+        const double d = mDesiredPositions[ i ] - mPositions[ i ];
+
+        if( ( ( d >= 1.0 ) && ( mPositions[ i + 1 ] - mPositions[ i ] > 1.0 ) ) ||
+            ( ( d <= -1.0 ) && ( mPositions[ i - 1 ] - mPositions[ i ] < -1.0 ) ) )
+        {
+            const int sign = ( d >= 0.0 ) ? 1 : -1;
+            const double candidate = Parabolic( i, sign );
+
+            if( ( mHeights[ i - 1 ] < candidate ) && ( candidate < mHeights[ i + 1 ] ) )
+            {
+                mHeights[ i ] = candidate;
+            }
+            else
+            {
+                mHeights[ i ] = Linear( i, sign );
+            }
+
+            mPositions[ i ] += sign;
+        }
+    }
+}
+
+double QuantileEstimator::Parabolic( int i, double d ) const
+{
+    const double* q = mHeights;
+    const double* n = mPositions;
+    return q[ i ] + d / ( n[ i + 1 ] - n[ i - 1 ] ) *
+                        ( ( n[ i ] - n[ i - 1 ] + d ) * ( q[ i + 1 ] - q[ i ] ) / ( n[ i + 1 ] - n[ i ] ) +
+                          ( n[ i + 1 ] - n[ i ] - d ) * ( q[ i ] - q[ i - 1 ] ) / ( n[ i ] - n[ i - 1 ] ) );
+}
+
+double QuantileEstimator::Linear( int i, int d ) const
+{
+    return mHeights[ i ] + d * ( mHeights[ i + d ] - mHeights[ i ] ) / ( mPositions[ i + d ] - mPositions[ i ] );
+}
+
+double QuantileEstimator::Value() const
+{
+    if( mCount == 0 )
+    {
+        return 0.0;
+    }
+
+    if( mCount < 5 )
+    {
+        // too few values for the markers, use the exact nearest-rank value
+        double sorted[ 5 ];
+        std::copy( mHeights, mHeights + mCount, sorted );
+        std::sort( sorted, sorted + mCount );
+        const U64 rank = static_cast<U64>( mQuantile * ( mCount - 1 ) + 0.5 );
+        return sorted[ rank ];
+    }
+
+    return mHeights[ 2 ];
+}
+
+RunningStatistic::RunningStatistic() : mMedian( 0.5 ), mPercentile99( 0.99 )
+{
+}
+
+void RunningStatistic::Add( double value )
+{
+    if( mCount == 0 )
+    {
+        mMinimum = value;
+        mMaximum = value;
+    }
+    else
+    {
+        mMinimum = std::min( mMinimum, value );
+        mMaximum = std::max( mMaximum, value );
+    }
+
+    ++mCount;
+    const double delta = value - mMean;
+    mMean += delta / mCount;
+    mSumSquaredDeviations += delta * ( value - mMean );
+
+    mMedian.Add( value );
+    mPercentile99.Add( value );
+}
+
+double RunningStatistic::Minimum() const
+{
+    return mMinimum;
+}
+
+double RunningStatistic::Maximum() const
+{
+    return mMaximum;
+}
+
+double RunningStatistic::Mean() const
+{
+    return mMean;
+}
+
+double RunningStatistic::StandardDeviation() const
+{
+    if( mCount < 2 )
+    {
+        return 0.0;
+    }
+
+    return std::sqrt( mSumSquaredDeviations / ( mCount - 1 ) );
+}
+
+double RunningStatistic::Median() const
+{
+    return mMedian.Value();
+}
+
+double RunningStatistic::Percentile99() const
+{
+    return mPercentile99.Value();
+}
+
+void CaptureStatistics::Reset( double sampleRateHz )
+{
+    *this = CaptureStatistics();
+    mSampleRateHz = sampleRateHz;
+}
+
+PacketMetrics CaptureStatistics::AddPacket( const PacketSummary& packet )
+{
+    PacketMetrics metrics;
+
+    // frame sample ranges are inclusive
+    metrics.mDurationSec = ( packet.mEndSample - packet.mBeginSample + 1 ) / mSampleRateHz;
+
+    if( metrics.mDurationSec > 0.0 )
+    {
+        metrics.mBitrate = packet.mBitCount / metrics.mDurationSec;
+    }
+
+    if( mPacketCount > 0 )
+    {
+        metrics.mHasPrevious = true;
+        metrics.mGapSec = ( packet.mBeginSample - mPrevious.mEndSample ) / mSampleRateHz;
+        metrics.mRefreshIntervalSec = ( packet.mBeginSample - mPrevious.mBeginSample ) / mSampleRateHz;
+        metrics.mSpeedModeChanged = ( packet.mHighSpeed != mPrevious.mHighSpeed );
+
+        mGap.Add( metrics.mGapSec );
+        mRefreshInterval.Add( metrics.mRefreshIntervalSec );
+
+        if( metrics.mSpeedModeChanged )
+        {
+            ++mSpeedModeChanges;
+        }
+    }
+
+    mDuration.Add( metrics.mDurationSec );
+    mBitrate.Add( metrics.mBitrate );
+    mPixelsPerPacket.Add( packet.mPixelCount );
+
+    mPrevious = packet;
+    ++mPacketCount;
+    return metrics;
+}
@@ -0,0 +1,149 @@
+#ifndef ASYNCRGBLED_STATISTICS_H
+#define ASYNCRGBLED_STATISTICS_H
+
+#include <AnalyzerTypes.h>
+
+/**
+ * @brief QuantileEstimator - streaming estimate of a single quantile using the
+ * P-square algorithm (Jain & Chlamtac, 1985). Only five markers are kept, so
+ * memory use is constant no matter how many values are added.
+ */
+class QuantileEstimator
+{
+  public:
+    explicit QuantileEstimator( double quantile );
+
+    void Add( double value );
+    double Value() const;
+
+  private:
+    double Parabolic( int i, double d ) const;
+    double Linear( int i, int d ) const;
+
+    double mQuantile;
+    U64 mCount = 0;
+    double mHeights[ 5 ];
+    double mPositions[ 5 ];
+    double mDesiredPositions[ 5 ];
+    double mIncrements[ 5 ];
+};
+
+/**
+ * @brief RunningStatistic - constant-memory aggregate of a value stream:
+ * count, min, max, mean, standard deviation (Welford) and median / 99th
+ * percentile estimates.
+ */
+class RunningStatistic
+{
+  public:
+    RunningStatistic();
+
+    void Add( double value );
+
+    U64 Count() const
+    {
+        return mCount;
+    }
+
+    double Minimum() const;
+    double Maximum() const;
+    double Mean() const;
+    double StandardDeviation() const;
+    double Median() const;
+    double Percentile99() const;
+
+  private:
+    U64 mCount = 0;
+    double mMinimum = 0.0;
+    double mMaximum = 0.0;
+    double mMean = 0.0;
+    double mSumSquaredDeviations = 0.0;
+    QuantileEstimator mMedian;
+    QuantileEstimator mPercentile99;
+};
+
+/// Everything the statistics need to know about one decoded packet
+struct PacketSummary
+{
+    U64 mBeginSample = 0;
+    U64 mEndSample = 0;
+    U32 mPixelCount = 0;
+    U32 mBitCount = 0;
+    bool mHighSpeed = false;
+};
+
+/// Per-packet values derived by CaptureStatistics::AddPacket
+struct PacketMetrics
+{
+    double mDurationSec = 0.0;
+    double mBitrate = 0.0;
+
+    /// false for the first packet, in which case the gap and refresh
+    /// interval are not meaningful
+    bool mHasPrevious = false;
+    double mGapSec = 0.0;
+    double mRefreshIntervalSec = 0.0;
+    bool mSpeedModeChanged = false;
+};
+
+/**
+ * @brief CaptureStatistics - capture-wide packet timing aggregates: refresh
+ * interval, inter-packet gap, packet duration, effective bitrate, pixels per
+ * packet and speed mode changes.
+ */
+class CaptureStatistics
+{
+  public:
+    void Reset( double sampleRateHz );
+
+    PacketMetrics AddPacket( const PacketSummary& packet );
+
+    U64 PacketCount() const
+    {
+        return mPacketCount;
+    }
+
+    U64 SpeedModeChanges() const
+    {
+        return mSpeedModeChanges;
+    }
+
+    const RunningStatistic& RefreshInterval() const
+    {
+        return mRefreshInterval;
+    }
+
+    const RunningStatistic& Gap() const
+    {
+        return mGap;
+    }
+
+    const RunningStatistic& Duration() const
+    {
+        return mDuration;
+    }
+
+    const RunningStatistic& Bitrate() const
+    {
+        return mBitrate;
+    }
+
+    const RunningStatistic& PixelsPerPacket() const
+    {
+        return mPixelsPerPacket;
+    }
+
+  private:
+    double mSampleRateHz = 0.0;
+    U64 mPacketCount = 0;
+    U64 mSpeedModeChanges = 0;
+    PacketSummary mPrevious;
+
+    RunningStatistic mRefreshInterval;
+    RunningStatistic mGap;
+    RunningStatistic mDuration;
+    RunningStatistic mBitrate;
+    RunningStatistic mPixelsPerPacket;
+};
+
+#endif // ASYNCRGBLED_STATISTICS_H
@@ -0,0 +1,40 @@
+#include "AsyncRgbLedStripLength.h"
+
+void StripLengthModel::Configure( U32 fixedPixels )
+{
+    mIsFixed = fixedPixels > 0;
+    mExpectedPixels = fixedPixels;
+    mCandidatePixels = 0;
+    mCandidateRun = 0;
+}
+
+StripLengthModel::Verdict StripLengthModel::AddPacket( U32 pixels )
+{
+    if( pixels == mCandidatePixels )
+    {
+        ++mCandidateRun;
+    }
+    else
+    {
+        mCandidatePixels = pixels;
+        mCandidateRun = 1;
+    }
+
+    if( pixels == mExpectedPixels )
+    {
+        return STRIP_MATCH;
+    }
+
+    if( !mIsFixed && ( mCandidateRun >= LEARN_PACKETS ) )
+    {
+        mExpectedPixels = pixels;
+        return STRIP_LEARNED;
+    }
+
+    if( !IsKnown() )
+    {
+        return STRIP_LEARNING;
+    }
+
+    return ( pixels < mExpectedPixels ) ? STRIP_TRUNCATED : STRIP_OVERLONG;
+}
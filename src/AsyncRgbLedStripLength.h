@@ -0,0 +1,60 @@
+#ifndef ASYNCRGBLED_STRIP_LENGTH_H
+#define ASYNCRGBLED_STRIP_LENGTH_H
+
+#include <AnalyzerTypes.h>
+
+/**
+ * @brief StripLengthModel - the number of pixels every packet on a channel is
+ * expected to carry, since a strip is refreshed whole.
+ *
+ * The length is either set, or learned once LEARN_PACKETS packets in a row
+ * had the same length. Packets of any other length are then reported as
+ * truncated or overlong. A learned length is replaced when another one holds
+ * for LEARN_PACKETS packets in a row, as after reconfiguring the strip; a
+ * set length never is.
+ */
+class StripLengthModel
+{
+  public:
+    static const U32 LEARN_PACKETS = 8;
+
+    enum Verdict
+    {
+        STRIP_LEARNING = 0, // no length known yet
+        STRIP_MATCH,
+        STRIP_TRUNCATED,
+        STRIP_OVERLONG,
+        STRIP_LEARNED // the length was learned, or learned again, with this packet
+    };
+
+    /// forgets everything. Zero learns the length from the packets.
+    void Configure( U32 fixedPixels );
+
+    Verdict AddPacket( U32 pixels );
+
+    bool IsKnown() const
+    {
+        return mExpectedPixels > 0;
+    }
+
+    /// zero while the length isn't known
+    U32 ExpectedPixels() const
+    {
+        return mExpectedPixels;
+    }
+
+    bool IsFixed() const
+    {
+        return mIsFixed;
+    }
+
+  private:
+    bool mIsFixed = false;
+    U32 mExpectedPixels = 0;
+
+    // the length of the last packet, and how many packets in a row had it
+    U32 mCandidatePixels = 0;
+    U32 mCandidateRun = 0;
+};
+
+#endif // ASYNCRGBLED_STRIP_LENGTH_H
@@ -0,0 +1,113 @@
+#include "AsyncRgbLedTimingMargins.h"
+
+#include <algorithm> // for std::min, std::max
+
+void TimingMarginHistogram::Configure( const TimingTolerance& tolerance, double sampleRateHz )
+{
+    *this = TimingMarginHistogram();
+
+    mTolerance = tolerance;
+    mSampleRateHz = sampleRateHz;
+
+    mMinimumSamples = tolerance.mMinimumSec * sampleRateHz;
+    mNominalSamples = tolerance.mNominalSec * sampleRateHz;
+    mMaximumSamples = tolerance.mMaximumSec * sampleRateHz;
+
+    // half of the bins on either side of the nominal value
+    const double halfBins = BIN_COUNT / 2;
+
+    if( mNominalSamples > mMinimumSamples )
+    {
+        mBinsPerSampleBelow = halfBins / ( mNominalSamples - mMinimumSamples );
+    }
+
+    if( mMaximumSamples > mNominalSamples )
+    {
+        mBinsPerSampleAbove = halfBins / ( mMaximumSamples - mNominalSamples );
+    }
+}
+
+void TimingMarginHistogram::Add( U64 widthSamples, U64 sampleNumber )
+{
+    const double width = static_cast<double>( widthSamples );
+
+    if( width < mMinimumSamples )
+    {
+        ++mUnderflow;
+    }
+    else if( width > mMaximumSamples )
+    {
+        ++mOverflow;
+    }
+    else
+    {
+        const double offset = width - mNominalSamples;
+        int bin = BIN_COUNT / 2;
+        bin += static_cast<int>( ( offset < 0.0 ) ? offset * mBinsPerSampleBelow : offset * mBinsPerSampleAbove );
+        // exactly on the minimum edge stays in the first bin, exactly on the
+        // maximum edge is folded into the last bin
+        ++mBins[ std::max( 0, std::min( bin, BIN_COUNT - 1 ) ) ];
+    }
+
+    const double margin = std::min( width - mMinimumSamples, mMaximumSamples - width );
+
+    if( ( mCount == 0 ) || ( margin < mWorstMarginSamples ) )
+    {
+        mWorstMarginSamples = margin;
+        mWorstMarginSec = margin / mSampleRateHz;
+        mWorstSample = sampleNumber;
+    }
+
+    ++mCount;
+}
+
+double TimingMarginHistogram::BinStartOffsetSec( int bin ) const
+{
+    const int fromCenter = bin - BIN_COUNT / 2;
+
+    if( fromCenter < 0 )
+    {
+        return fromCenter * ( mTolerance.mNominalSec - mTolerance.mMinimumSec ) / ( BIN_COUNT / 2 );
+    }
+
+    return fromCenter * ( mTolerance.mMaximumSec - mTolerance.mNominalSec ) / ( BIN_COUNT / 2 );
+}
+
+void TimingMargins::Configure( const BitTiming lowSpeed[ 2 ], const BitTiming highSpeed[ 2 ], bool hasHighSpeed, double sampleRateHz )
+{
+    mHasHighSpeed = hasHighSpeed;
+
+    for( const auto b : { BIT_LOW, BIT_HIGH } )
+    {
+        mHistograms[ 0 ][ b ][ PULSE_HIGH ].Configure( lowSpeed[ b ].mPositiveTiming, sampleRateHz );
+        mHistograms[ 0 ][ b ][ PULSE_LOW ].Configure( lowSpeed[ b ].mNegativeTiming, sampleRateHz );
+        mHistograms[ 1 ][ b ][ PULSE_HIGH ].Configure( highSpeed[ b ].mPositiveTiming, sampleRateHz );
+        mHistograms[ 1 ][ b ][ PULSE_LOW ].Configure( highSpeed[ b ].mNegativeTiming, sampleRateHz );
+    }
+}
+
+const TimingMarginHistogram* TimingMargins::Worst( bool& isHighSpeed, BitState& value, PulsePhase& phase ) const
+{
+    const TimingMarginHistogram* worst = nullptr;
+
+    for( int speed = 0; speed < 2; ++speed )
+    {
+        for( const auto b : { BIT_LOW, BIT_HIGH } )
+        {
+            for( const auto p : { PULSE_HIGH, PULSE_LOW } )
+            {
+                const TimingMarginHistogram& h = mHistograms[ speed ][ b ][ p ];
+
+                if( ( h.Count() > 0 ) && ( !worst || ( h.WorstMarginSec() < worst->WorstMarginSec() ) ) )
+                {
+                    worst = &h;
+                    isHighSpeed = ( speed == 1 );
+                    value = b;
+                    phase = p;
+                }
+            }
+        }
+    }
+
+    return worst;
+}
@@ -0,0 +1,127 @@
+#ifndef ASYNCRGBLED_TIMING_MARGINS_H
+#define ASYNCRGBLED_TIMING_MARGINS_H
+
+#include <AnalyzerTypes.h>
+
+#include "AsyncRgbLedHelpers.h"
+
+enum PulsePhase
+{
+    PULSE_HIGH = 0,
+    PULSE_LOW
+};
+
+/**
+ * @brief TimingMarginHistogram - fixed-bin histogram of measured pulse widths
+ * for one bit value / speed mode / pulse phase.
+ *
+ * Widths are normalised against the tolerance window: -1.0 is the minimum,
+ * 0.0 the nominal and +1.0 the maximum width, so each side of the nominal
+ * value is scaled to its own tolerance edge. Widths outside the window are
+ * counted in the underflow and overflow bins.
+ */
+class TimingMarginHistogram
+{
+  public:
+    static const int BIN_COUNT = 64;
+
+    void Configure( const TimingTolerance& tolerance, double sampleRateHz );
+    void Add( U64 widthSamples, U64 sampleNumber );
+
+    /// start of a bin, as an offset from the nominal width in seconds
+    double BinStartOffsetSec( int bin ) const;
+
+    const TimingTolerance& Tolerance() const
+    {
+        return mTolerance;
+    }
+
+    U64 Count() const
+    {
+        return mCount;
+    }
+
+    U64 Bin( int bin ) const
+    {
+        return mBins[ bin ];
+    }
+
+    U64 Underflow() const
+    {
+        return mUnderflow;
+    }
+
+    U64 Overflow() const
+    {
+        return mOverflow;
+    }
+
+    /// smallest distance of any measured width to the nearest window edge, in
+    /// seconds. Negative if a width fell outside the window.
+    double WorstMarginSec() const
+    {
+        return mWorstMarginSec;
+    }
+
+    /// sample number at the start of the pulse with the worst margin
+    U64 WorstSample() const
+    {
+        return mWorstSample;
+    }
+
+  private:
+    TimingTolerance mTolerance;
+    double mSampleRateHz = 0.0;
+
+    // window edges and scale factors, in samples, cached to keep Add() cheap
+    double mMinimumSamples = 0.0;
+    double mNominalSamples = 0.0;
+    double mMaximumSamples = 0.0;
+    double mBinsPerSampleBelow = 0.0;
+    double mBinsPerSampleAbove = 0.0;
+
+    U64 mBins[ BIN_COUNT ] = {};
+    U64 mUnderflow = 0;
+    U64 mOverflow = 0;
+    U64 mCount = 0;
+
+    double mWorstMarginSamples = 0.0;
+    double mWorstMarginSec = 0.0;
+    U64 mWorstSample = 0;
+};
+
+/**
+ * @brief TimingMargins - the full set of margin histograms for a controller,
+ * indexed by speed mode, bit value and pulse phase.
+ */
+class TimingMargins
+{
+  public:
+    void Configure( const BitTiming lowSpeed[ 2 ], const BitTiming highSpeed[ 2 ], bool hasHighSpeed, double sampleRateHz );
+
+    void Add( bool isHighSpeed, BitState value, PulsePhase phase, U64 widthSamples, U64 sampleNumber )
+    {
+        mHistograms[ isHighSpeed ][ value ][ phase ].Add( widthSamples, sampleNumber );
+    }
+
+    bool HasHighSpeed() const
+    {
+        return mHasHighSpeed;
+    }
+
+    const TimingMarginHistogram& Histogram( bool isHighSpeed, BitState value, PulsePhase phase ) const
+    {
+        return mHistograms[ isHighSpeed ][ value ][ phase ];
+    }
+
+    /// the histogram holding the overall worst margin, or nullptr if nothing
+    /// was measured yet. The indices of that histogram are written to the
+    /// output arguments.
+    const TimingMarginHistogram* Worst( bool& isHighSpeed, BitState& value, PulsePhase& phase ) const;
+
+  private:
+    bool mHasHighSpeed = false;
+    TimingMarginHistogram mHistograms[ 2 ][ 2 ][ 2 ]; // speed, bit value, phase
+};
+
+#endif // ASYNCRGBLED_TIMING_MARGINS_H
@@ -0,0 +1,118 @@
+#include "AsyncRgbLedWaveform.h"
+
+#include <algorithm> // for std::max, std::copy
+#include <cmath>     // for llround
+
+void WaveformSynthesizer::Configure( const LedControllerData& controller, double sampleRateHz )
+{
+    mBitSize = controller.mBitsPerChannel;
+    mLeadingBits = mBitSize % MAX_TEMPLATE_BITS;
+    mByteCount = mBitSize / MAX_TEMPLATE_BITS;
+    mLayout = controller.mLayout;
+    mResetSamples = controller.mResetTiming.mNominalSec * sampleRateHz;
+    mCarrySamples = 0.0;
+
+    const BitTiming* timings[ 2 ] = { controller.mDataTiming, controller.mDataTimingHighSpeed };
+
+    for( int speed = 0; speed < 2; ++speed )
+    {
+        BuildTemplates( timings[ speed ], sampleRateHz, mLeadingBits, mLeading[ speed ] );
+        BuildTemplates( timings[ speed ], sampleRateHz, MAX_TEMPLATE_BITS, mBytes[ speed ] );
+    }
+}
+
+void WaveformSynthesizer::BuildTemplates( const BitTiming timing[ 2 ], double sampleRateHz, U32 bitCount, TemplateTable& templates )
+{
+    templates.clear();
+
+    if( bitCount == 0 )
+    {
+        return;
+    }
+
+    const U32 valueCount = 1u << bitCount;
+    templates.resize( valueCount * PHASE_COUNT );
+
+    for( U32 phase = 0; phase < PHASE_COUNT; ++phase )
+    {
+        // the exact start of the template relative to its first edge, at the
+        // centre of this phase's slice of [-0.5, 0.5)
+        const double startOffset = ( phase + 0.5 ) / PHASE_COUNT - 0.5;
+
+        for( U32 value = 0; value < valueCount; ++value )
+        {
+            Template& t = templates[ phase * valueCount + value ];
+            double exact = startOffset;
+            S64 previousEdge = 0;
+
+            for( U32 i = 0; i < bitCount * 2; ++i )
+            {
+                const BitState bit = ( ( value >> ( bitCount - 1 - i / 2 ) ) & 1 ) ? BIT_HIGH : BIT_LOW;
+                const TimingTolerance& pulse = ( i % 2 == 0 ) ? timing[ bit ].mPositiveTiming : timing[ bit ].mNegativeTiming;
+
+                // place each edge on the sample nearest its exact position, so
+                // the rounding error doesn't accumulate inside the template
+                exact += pulse.mNominalSec * sampleRateHz;
+                const S64 edge = std::max<S64>( previousEdge + 1, std::llround( exact ) );
+                t.mWidths[ i ] = static_cast<U32>( edge - previousEdge );
+                previousEdge = edge;
+            }
+
+            t.mErrorSamples = ( exact - startOffset ) - previousEdge;
+        }
+    }
+}
+
+U32* WaveformSynthesizer::AppendTemplate( const TemplateTable& templates, U32 bitCount, U32 value, U32* out )
+{
+    const int phase = static_cast<int>( ( mCarrySamples + 0.5 ) * PHASE_COUNT );
+    const U32 valueCount = 1u << bitCount;
+    const Template& t = templates[ std::max( 0, std::min<int>( phase, PHASE_COUNT - 1 ) ) * valueCount + value ];
+
+    mCarrySamples += t.mErrorSamples;
+    return std::copy( t.mWidths, t.mWidths + bitCount * 2, out );
+}
+
+void WaveformSynthesizer::WriteReset( WaveformSink& sink )
+{
+    const double exact = mResetSamples + mCarrySamples;
+    const U64 samples = static_cast<U64>( std::max<S64>( 1, std::llround( exact ) ) );
+    mCarrySamples = exact - samples;
+    sink.WriteIdle( samples );
+}
+
+void WaveformSynthesizer::WritePixels( const RGBValue* pixels, size_t count, bool isHighSpeed, WaveformSink& sink )
+{
+    const size_t widthCount = count * 3 * mBitSize * 2;
+
+    if( mWidths.size() < widthCount )
+    {
+        mWidths.resize( widthCount );
+    }
+
+    U32* out = mWidths.data();
+
+    for( size_t p = 0; p < count; ++p )
+    {
+        U16 values[ 3 ];
+        pixels[ p ].ConvertToControllerOrder( mLayout, values );
+
+        for( const U16 value : values )
+        {
+            U32 shift = mByteCount * MAX_TEMPLATE_BITS;
+
+            if( mLeadingBits > 0 )
+            {
+                out = AppendTemplate( mLeading[ isHighSpeed ], mLeadingBits, ( value >> shift ) & ( ( 1u << mLeadingBits ) - 1 ), out );
+            }
+
+            while( shift > 0 )
+            {
+                shift -= MAX_TEMPLATE_BITS;
+                out = AppendTemplate( mBytes[ isHighSpeed ], MAX_TEMPLATE_BITS, ( value >> shift ) & 0xFF, out );
+            }
+        }
+    }
+
+    sink.WritePulses( mWidths.data(), widthCount );
+}
@@ -0,0 +1,85 @@
+#ifndef ASYNCRGBLED_WAVEFORM_H
+#define ASYNCRGBLED_WAVEFORM_H
+
+#include <vector>
+
+#include <AnalyzerTypes.h>
+
+#include "AsyncRgbLedControllers.h"
+#include "AsyncRgbLedHelpers.h"
+
+/**
+ * @brief WaveformSink - receives a synthesized LED waveform as pulse widths in
+ * samples. The line is low before and after every call.
+ */
+class WaveformSink
+{
+  public:
+    virtual ~WaveformSink() = default;
+
+    /// widths alternate high, low, high, low ... so count is always even
+    virtual void WritePulses( const U32* widths, size_t count ) = 0;
+
+    /// keep the line low for this many samples
+    virtual void WriteIdle( U64 samples ) = 0;
+};
+
+/**
+ * @brief WaveformSynthesizer - turns pixel values into pulse widths using
+ * per-byte templates precomputed in whole samples for each speed mode, so the
+ * per-bit work is a table lookup rather than floating-point timing math.
+ *
+ * Each template is rounded to whole samples once, for a few fractional start
+ * positions. The difference to the exact duration is carried into the next
+ * template and picks its start position, so edges stay within about half a
+ * sample of nominal and long packets don't drift from the nominal bit rate.
+ */
+class WaveformSynthesizer
+{
+  public:
+    void Configure( const LedControllerData& controller, double sampleRateHz );
+
+    /// line low for the nominal reset time
+    void WriteReset( WaveformSink& sink );
+
+    /// all pixels of a packet, emitted with one WritePulses call
+    void WritePixels( const RGBValue* pixels, size_t count, bool isHighSpeed, WaveformSink& sink );
+
+  private:
+    enum
+    {
+        MAX_TEMPLATE_BITS = 8,
+        PHASE_COUNT = 8 // fractional start positions per template
+    };
+
+    struct Template
+    {
+        U32 mWidths[ MAX_TEMPLATE_BITS * 2 ];
+        /// exact duration minus the sum of mWidths
+        double mErrorSamples = 0.0;
+    };
+
+    /// templates of every value of a bit count, for each start position
+    typedef std::vector<Template> TemplateTable;
+
+    static void BuildTemplates( const BitTiming timing[ 2 ], double sampleRateHz, U32 bitCount, TemplateTable& templates );
+
+    U32* AppendTemplate( const TemplateTable& templates, U32 bitCount, U32 value, U32* out );
+
+    /// [ isHighSpeed ], for the most significant (bitSize % 8) bits if any,
+    /// and for each following whole byte
+    TemplateTable mLeading[ 2 ];
+    TemplateTable mBytes[ 2 ];
+    U8 mBitSize = 8;
+    U32 mLeadingBits = 0;
+    U32 mByteCount = 1;
+    ColorLayout mLayout = LAYOUT_RGB;
+    double mResetSamples = 0.0;
+
+    /// rounding error carried from one template to the next, in samples
+    double mCarrySamples = 0.0;
+
+    std::vector<U32> mWidths;
+};
+
+#endif // ASYNCRGBLED_WAVEFORM_H